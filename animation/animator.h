@@ -134,6 +134,9 @@ class Animator {
   bool isAnimated(const T* variable) const
     { return animations_.find(variable) != animations_.end(); }
 
+  /// Check whether any variable is currently being animated.
+  bool hasAnimations() const { return !animations_.empty(); }
+
   /// Delete an animation.
   template <class T>
   void deleteAnimation(const T* variable)
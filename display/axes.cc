@@ -15,14 +15,16 @@ namespace {
 
 static const float eps = 1e-6;
 
-static void drawAxis(const Rectangle& axis, std::vector<GlVertex2>& points)
+static void drawAxis(const Rectangle& axis, const GlColor4& color,
+  std::vector<GlColoredVertex2>& points)
 {
-  points.push_back(axis.start);
-  points.push_back(axis.end);
+  points.push_back(GlColoredVertex2(axis.start.x, axis.start.y, color));
+  points.push_back(GlColoredVertex2(axis.end.x, axis.end.y, color));
 }
 
 static void drawGrid(const std::vector<float>& positions, Direction direction,
-  const Rectangle& axes_box, std::vector<GlVertex2>& points)
+  const Rectangle& axes_box, const GlColor4& color,
+  std::vector<GlColoredVertex2>& points)
 {
   size_t n = positions.size();
   for (size_t i = 0; i < n; ++i) {
@@ -39,15 +41,15 @@ static void drawGrid(const std::vector<float>& positions, Direction direction,
       p1.y = positions[i];
       p2.y = positions[i];
     }
-    points.push_back(p1);
-    points.push_back(p2);
+    points.push_back(GlColoredVertex2(p1.x, p1.y, color));
+    points.push_back(GlColoredVertex2(p2.x, p2.y, color));
   }
 }
 
 // "up" points ccw from axis
 static void drawTicks(const Rectangle& axis,
     const std::vector<float>& positions, float size_up, float size_down,
-    std::vector<GlVertex2>& points)
+    const GlColor4& color, std::vector<GlColoredVertex2>& points)
 {
   Direction dir;
   GlVertex2 tick_up, tick_down;
@@ -76,23 +78,31 @@ static void drawTicks(const Rectangle& axis,
       point.x = axis.start.x;
       point.y = positions[i];
     }
- 
-    points.push_back(point + tick_down);
-    points.push_back(point + tick_up);
+
+    GlVertex2 down = point + tick_down;
+    GlVertex2 up = point + tick_up;
+    points.push_back(GlColoredVertex2(down.x, down.y, color));
+    points.push_back(GlColoredVertex2(up.x, up.y, color));
   }
 }
 
-static void drawBox(const Rectangle& box, Vbo* vbo)
+static void drawBox(const Rectangle& box, const GlColor4& color,
+  std::vector<GlColoredVertex2>& points)
 {
-  std::vector<GlVertex2> points;
-
-  points.push_back(box.start);
-  points.push_back(GlVertex2(box.end.x, box.start.y));
-  points.push_back(box.end);
-  points.push_back(GlVertex2(box.start.x, box.end.y));
-  points.push_back(box.start);
-
-  vbo -> draw(points, GL_LINE_STRIP);
+  GlVertex2 corners[4] = {
+    box.start,
+    GlVertex2(box.end.x, box.start.y),
+    box.end,
+    GlVertex2(box.start.x, box.end.y)
+  };
+
+  // the box is drawn as separate segments, to fit in the GL_LINES batch
+  for (int i = 0; i < 4; ++i) {
+    const GlVertex2& p1 = corners[i];
+    const GlVertex2& p2 = corners[(i + 1) % 4];
+    points.push_back(GlColoredVertex2(p1.x, p1.y, color));
+    points.push_back(GlColoredVertex2(p2.x, p2.y, color));
+  }
 }
 
 std::vector<float> Axes::calculateTicks_(const Rectangle& axis_graph,
@@ -189,10 +199,32 @@ std::vector<float> Axes::calculateTicks_(const Rectangle& axis_graph,
 void Axes::draw()
 {
   if (!vbo_) {
-    const size_t vbo_size = 2048*sizeof(GlVertex2);
+    const size_t vbo_size = 2048*sizeof(GlColoredVertex2);
     vbo_.reset(new Vbo(vbo_size));
   }
 
+  // the geometry only needs to be regenerated when some setting changed, or
+  // during animations
+  if (!geometry_valid_) {
+    buildGeometry_();
+    if (!geometry_.empty())
+      vbo_ -> update(geometry_);
+    geometry_valid_ = true;
+  }
+
+  if (geometry_.empty()) // nothing to do
+    return;
+
+  vbo_ -> drawStored<GlColoredVertex2>(GL_LINES, geometry_.size());
+
+  // leave the current color the way drawing the batches one by one would
+  setGlColor(geometry_color_);
+}
+
+void Axes::buildGeometry_()
+{
+  geometry_.clear();
+
   Type type = type_.target;
   double axis_opacity = visibility_;
 
@@ -208,9 +240,6 @@ void Axes::draw()
   ticks_x_maj_.origin_log = ticks_x_min_.origin_log;
   ticks_y_maj_.origin_log = ticks_y_min_.origin_log;
 
-  // XXX ideally many of these things would be precalculated and remembered
-  // for the case (which is most common) when there is no animation
-
   // positions of axes on screen
   Rectangle x_axis;
   Rectangle y_axis;
@@ -251,40 +280,36 @@ void Axes::draw()
   std::vector<float> maj_ticks_pos_x;
   std::vector<float> maj_ticks_pos_y;
 
-  std::vector<GlVertex2> points;
+  std::vector<GlColoredVertex2>& points = geometry_;
+  GlColor4 color;
 
   float grid_opacity = grid_*axis_opacity;
   if (grid_opacity >= eps) {
     maj_ticks_pos_x = calculateTicks_(x_axis_graph, ticks_x_maj_);
     maj_ticks_pos_y = calculateTicks_(y_axis_graph, ticks_y_maj_);
 
-    setGlColor(cosmetics_.grid_color*grid_opacity);
-    drawGrid(maj_ticks_pos_x, HORIZONTAL, axes_box_, points);
-    drawGrid(maj_ticks_pos_y, VERTICAL, axes_box_, points);
-
-    vbo_ -> draw(points, GL_LINES);
-    points.clear();
+    color = cosmetics_.grid_color*grid_opacity;
+    drawGrid(maj_ticks_pos_x, HORIZONTAL, axes_box_, color, points);
+    drawGrid(maj_ticks_pos_y, VERTICAL, axes_box_, color, points);
   }
 
-  setGlColor(cosmetics_.color*axis_opacity);
+  // XXX hard-coded!
+  float other_axes_opac = (boxiness >= 0.7)?((boxiness - 0.7) / 0.3):0;
+  const GlColor4 axis_color = cosmetics_.color*axis_opacity;
+  const GlColor4 other_color = cosmetics_.color*(axis_opacity*other_axes_opac);
+  const Rectangle other_x_axis(GlVertex2(axes_box_.start.x, axes_box_.end.y),
+    axes_box_.end);
+  const Rectangle other_y_axis(GlVertex2(axes_box_.end.x, axes_box_.start.y),
+    axes_box_.end);
+
+  color = axis_color;
   if (axis_opacity >= eps) {
-    drawAxis(x_axis, points);
-    drawAxis(y_axis, points);
-    // XXX hard-coded!
+    drawAxis(x_axis, axis_color, points);
+    drawAxis(y_axis, axis_color, points);
     if (boxiness >= 0.7) {
-      vbo_ -> draw(points, GL_LINES);
-      points.clear();
-
-      float other_axes_opac = (boxiness - 0.7) / 0.3;
-      setGlColor(cosmetics_.color*(axis_opacity*other_axes_opac));
-      
-      drawAxis(Rectangle(GlVertex2(axes_box_.start.x, axes_box_.end.y),
-        axes_box_.end), points);
-      drawAxis(Rectangle(GlVertex2(axes_box_.end.x, axes_box_.start.y),
-        axes_box_.end), points);
-
-      vbo_ -> draw(points, GL_LINES);
-      points.clear();
+      color = other_color;
+      drawAxis(other_x_axis, other_color, points);
+      drawAxis(other_y_axis, other_color, points);
     }
   }
 
@@ -315,23 +340,17 @@ void Axes::draw()
     min_ticks_pos_y = calculateTicks_(y_axis_graph, ticks_y_min_);
 
     float min_sz = cosmetics_.min_tick_size*min_tick_opacity;
-    setGlColor(cosmetics_.color*axis_opacity);
-    drawTicks(x_axis, min_ticks_pos_x, min_sz, two_sidedness*min_sz, points);
-    drawTicks(y_axis, min_ticks_pos_y, two_sidedness*min_sz, min_sz, points);
+    color = axis_color;
+    drawTicks(x_axis, min_ticks_pos_x, min_sz, two_sidedness*min_sz,
+      axis_color, points);
+    drawTicks(y_axis, min_ticks_pos_y, two_sidedness*min_sz, min_sz,
+      axis_color, points);
     if (boxiness >= 0.7) {
-      vbo_ -> draw(points, GL_LINES);
-      points.clear();
-
-      float other_axes_opac = (boxiness - 0.7) / 0.3;
-      setGlColor(cosmetics_.color*(axis_opacity*other_axes_opac));
-
-      drawTicks(Rectangle(GlVertex2(axes_box_.start.x, axes_box_.end.y),
-        axes_box_.end), min_ticks_pos_x, two_sidedness*min_sz, min_sz, points);
-      drawTicks(Rectangle(GlVertex2(axes_box_.end.x, axes_box_.start.y),
-        axes_box_.end), min_ticks_pos_y, min_sz, two_sidedness*min_sz, points);
-
-      vbo_ -> draw(points, GL_LINES);
-      points.clear();
+      color = other_color;
+      drawTicks(other_x_axis, min_ticks_pos_x, two_sidedness*min_sz, min_sz,
+        other_color, points);
+      drawTicks(other_y_axis, min_ticks_pos_y, min_sz, two_sidedness*min_sz,
+        other_color, points);
     }
   }
   if (maj_tick_opacity >= eps) {
@@ -341,31 +360,27 @@ void Axes::draw()
       maj_ticks_pos_y = calculateTicks_(y_axis_graph, ticks_y_maj_);
 
     float maj_sz = cosmetics_.maj_tick_size*maj_tick_opacity;
-    setGlColor(cosmetics_.color*axis_opacity);
-    drawTicks(x_axis, maj_ticks_pos_x, maj_sz, two_sidedness*maj_sz, points);
-    drawTicks(y_axis, maj_ticks_pos_y, two_sidedness*maj_sz, maj_sz, points);
+    color = axis_color;
+    drawTicks(x_axis, maj_ticks_pos_x, maj_sz, two_sidedness*maj_sz,
+      axis_color, points);
+    drawTicks(y_axis, maj_ticks_pos_y, two_sidedness*maj_sz, maj_sz,
+      axis_color, points);
     if (boxiness >= 0.7) {
-      vbo_ -> draw(points, GL_LINES);
-      points.clear();
-
-      float other_axes_opac = (boxiness - 0.7) / 0.3;
-      setGlColor(cosmetics_.color*(axis_opacity*other_axes_opac));
-
-      drawTicks(Rectangle(GlVertex2(axes_box_.start.x, axes_box_.end.y),
-        axes_box_.end), maj_ticks_pos_x, two_sidedness*maj_sz, maj_sz, points);
-      drawTicks(Rectangle(GlVertex2(axes_box_.end.x, axes_box_.start.y),
-        axes_box_.end), maj_ticks_pos_y, maj_sz, two_sidedness*maj_sz, points);
+      color = other_color;
+      drawTicks(other_x_axis, maj_ticks_pos_x, two_sidedness*maj_sz, maj_sz,
+        other_color, points);
+      drawTicks(other_y_axis, maj_ticks_pos_y, maj_sz, two_sidedness*maj_sz,
+        other_color, points);
     }
   }
 
-  vbo_ -> draw(points, GL_LINES);
-  points.clear();
-
   float box_opacity = box_*(1 - boxiness);
   if (box_opacity >= eps) {
-    setGlColor(cosmetics_.box_color*box_opacity);
-    drawBox(axes_box_, vbo_.get());
+    color = cosmetics_.box_color*box_opacity;
+    drawBox(axes_box_, color, points);
   }
+
+  geometry_color_ = color;
 }
 
 static inline float convert(float x, float b0, float b1, float r0, float r1,
@@ -585,6 +600,7 @@ void Axes::updateProperties()
 void Axes::setProperties(Properties* props)
 {
   properties_ = props;
+  geometry_valid_ = false;
 
   if (properties_ -> count("type") > 0) {
     std::string type = properties_ -> get<std::string>("type");
@@ -650,6 +666,7 @@ void Axes::setProperties(Properties* props)
 
 void Axes::setType(Type type, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this needs to be made better
   type_.initial = type_.target;
   type_.target = type;
@@ -659,12 +676,14 @@ void Axes::setType(Type type, const std::string& trans)
 
 void Axes::setVisibility(bool vis, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&visibility_, vis?1:0,
     getTransition_("fade", trans));
 }
 
 void Axes::setTickType(TicksType type, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this needs to be made better
   ticks_.initial = ticks_.target;
   ticks_.target = type;
@@ -674,78 +693,92 @@ void Axes::setTickType(TicksType type, const std::string& trans)
 
 void Axes::setTickVisibility(bool vis, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&tick_visibility_, vis?1:0,
     getTransition_("fade", trans));
 }
 
 void Axes::setTicksTwoSided(bool two_sided, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&ticks_twosided_, two_sided?1:0,
     getTransition_("tick", trans));
 }
 
 void Axes::setGridVisibility(bool vis, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&grid_, vis?1:0, getTransition_("fade", trans));
 }
 
 void Axes::setBoxVisibility(bool vis, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&box_, vis?1:0, getTransition_("fade", trans));
 }
 
 void Axes::setClippingArea(const Rectangle& r, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&clipping_box_, r, getTransition_("zoom", trans));
 }
 
 void Axes::setExtents(const Rectangle& r, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&axes_box_, r, getTransition_("zoom", trans));
 }
 
 void Axes::setRange(const Rectangle& r, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&range_, r, getTransition_("zoom", trans));
 }
 
 void Axes::setCrossing(const GlVertex2& x, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&crossing_, x, getTransition_("shift", trans));
 }
 
 void Axes::setColor(const GlColor4& color, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&cosmetics_.color, color,
     getTransition_("fade", trans));
 }
 
 void Axes::setMinorTickSize(float sz, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&cosmetics_.min_tick_size, sz,
     getTransition_("fade", trans));
 }
 
 void Axes::setMajorTickSize(float sz, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&cosmetics_.maj_tick_size, sz,
     getTransition_("fade", trans));
 }
 
 void Axes::setGridColor(const GlColor4& color, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&cosmetics_.grid_color, color,
     getTransition_("fade", trans));
 }
 
 void Axes::setBoxColor(const GlColor4& color, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&cosmetics_.box_color, color,
     getTransition_("fade", trans));
 }
 
 void Axes::setScalingX(ScalingType type, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this needs to be done better
   scaling_x_.initial = scaling_x_.target;
   scaling_x_.target = type;
@@ -755,6 +788,7 @@ void Axes::setScalingX(ScalingType type, const std::string& trans)
 
 void Axes::setScalingY(ScalingType type, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this needs to be done better
   scaling_y_.initial = scaling_y_.target;
   scaling_y_.target = type;
@@ -764,24 +798,28 @@ void Axes::setScalingY(ScalingType type, const std::string& trans)
 
 void Axes::setTickOriginLinearX(float orig, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&ticks_x_min_.origin_linear, orig,
     getTransition_("shift", trans));
 }
 
 void Axes::setTickOriginLinearY(float orig, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&ticks_y_min_.origin_linear, orig,
     getTransition_("shift", trans));
 }
 
 void Axes::setTickOriginLogX(float orig, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&ticks_x_min_.origin_log, orig,
     getTransition_("shift", trans));
 }
 
 void Axes::setTickOriginLogY(float orig, const std::string& trans)
 {
+  geometry_valid_ = false;
   animator_.redoTransition(&ticks_y_min_.origin_log, orig,
     getTransition_("shift", trans));
 }
@@ -789,6 +827,7 @@ void Axes::setTickOriginLogY(float orig, const std::string& trans)
 void Axes::setTickSpacingLinearX(TicksType which, float sp,
     const std::string& trans)
 {
+  geometry_valid_ = false;
   TicksInfo& info = (which == MAJOR || which == BOTH)?ticks_x_maj_:ticks_x_min_;
   animator_.redoTransition(&info.spacing_linear, sp,
     getTransition_("zoom", trans));
@@ -797,6 +836,7 @@ void Axes::setTickSpacingLinearX(TicksType which, float sp,
 void Axes::setTickSpacingLinearY(TicksType which, float sp,
     const std::string& trans)
 {
+  geometry_valid_ = false;
   TicksInfo& info = (which == MAJOR || which == BOTH)?ticks_y_maj_:ticks_y_min_;
   animator_.redoTransition(&info.spacing_linear, sp,
     getTransition_("zoom", trans));
@@ -805,6 +845,7 @@ void Axes::setTickSpacingLinearY(TicksType which, float sp,
 void Axes::setTickSpacingLogX(TicksType which, float sp,
     const std::string& trans)
 {
+  geometry_valid_ = false;
   TicksInfo& info = (which == MAJOR || which == BOTH)?ticks_x_maj_:ticks_x_min_;
   animator_.redoTransition(&info.spacing_log, sp,
     getTransition_("zoom", trans));
@@ -813,6 +854,7 @@ void Axes::setTickSpacingLogX(TicksType which, float sp,
 void Axes::setTickSpacingLogY(TicksType which, float sp,
     const std::string& trans)
 {
+  geometry_valid_ = false;
   TicksInfo& info = (which == MAJOR || which == BOTH)?ticks_y_maj_:ticks_y_min_;
   animator_.redoTransition(&info.spacing_log, sp,
     getTransition_("zoom", trans));
@@ -820,6 +862,7 @@ void Axes::setTickSpacingLogY(TicksType which, float sp,
 
 void Axes::setTickSpacingX(ScalingType spacing, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this can be done better
   ticks_x_min_.spacing_type.initial = ticks_x_min_.spacing_type.target;
   ticks_x_min_.spacing_type.target = spacing;
@@ -829,6 +872,7 @@ void Axes::setTickSpacingX(ScalingType spacing, const std::string& trans)
 
 void Axes::setTickSpacingY(ScalingType spacing, const std::string& trans)
 {
+  geometry_valid_ = false;
   // XXX this can be done better
   ticks_y_min_.spacing_type.initial = ticks_y_min_.spacing_type.target;
   ticks_y_min_.spacing_type.target = spacing;
@@ -6,6 +6,8 @@
 #ifndef AXES_H_
 #define AXES_H_
 
+#include <vector>
+
 #include <boost/scoped_ptr.hpp>
 
 #include "animation/animator.h"
@@ -34,9 +36,13 @@ class Axes {
     ticks_twosided_(1), grid_(1), box_(0), clip_(false),
     clipping_box_(0, 0, 1000, 1000), axes_box_(10, 10, 600, 400),
     range_(-1, -1, 1, 1), crossing_(0, 0), scaling_x_(LINEAR),
-    scaling_y_(LINEAR), properties_(0) {}
+    scaling_y_(LINEAR), properties_(0), geometry_valid_(false) {}
 
-  /// Draw the axes.
+  /** @brief Draw the axes.
+   *
+   *  The geometry is cached between calls, and is only recalculated after
+   *  a setting changed, or while an animation is running.
+   */
   void draw();
 
   /// Calculate the screen coordinates of a point in graph space.
@@ -71,7 +77,12 @@ class Axes {
   }
 
   /// Update the animations.
-  void updateAnimations() { animator_.update(); }
+  void updateAnimations() {
+    // anything that is animated is about to change
+    if (animator_.hasAnimations())
+      geometry_valid_ = false;
+    animator_.update();
+  }
 
   /// @name getters
   // @{
@@ -82,6 +93,9 @@ class Axes {
   /// Get the visibility of axes.
   bool isVisible() const { return animator_.getTarget(&visibility_) > 0.5; }
 
+  /// Find out whether any of the axes' properties are being animated.
+  bool hasAnimations() const { return animator_.hasAnimations(); }
+
   /// Get the type of ticks.
   TicksType getTickType() const { return ticks_.target; }
 
@@ -144,6 +158,14 @@ class Axes {
   /// Get the scaling type for the y axis.
   ScalingType getScalingY() const { return scaling_y_.target; }
 
+  /// Get the scaling for the x axis, including the state of its animation.
+  const DiscreteAnimated<ScalingType>& getScalingStateX() const
+    { return scaling_x_; }
+
+  /// Get the scaling for the y axis, including the state of its animation.
+  const DiscreteAnimated<ScalingType>& getScalingStateY() const
+    { return scaling_y_; }
+
   /// Get the origin of x ticks, when using linear spacing.
   float getTickOriginLinearX(bool instantaneous = false) const
     { return animator_.get(&ticks_x_min_.origin_linear, instantaneous); }
@@ -363,6 +385,8 @@ class Axes {
    */
   std::vector<float> calculateTicks_(const Rectangle& axis_graph,
     const TicksInfo& ticks_info);
+  /// Recalculate the cached geometry for the axes, grid, ticks, and box.
+  void buildGeometry_();
   /** @brief Get the transition with the given name, or an abrupt transition if
    *         @a immediate = @a true or the transition store hasn't been set.
    */
@@ -435,6 +459,12 @@ class Axes {
 
   /// The VBO in use by the object.
   boost::scoped_ptr<Vbo>        vbo_;
+  /// Cached geometry (drawn as @a GL_LINES), with colors built in.
+  std::vector<GlColoredVertex2> geometry_;
+  /// The color that drawing the geometry leaves active.
+  GlColor4                      geometry_color_;
+  /// Whether the cached geometry (and its copy in the VBO) is up to date.
+  bool                          geometry_valid_;
 };
 
 #endif
@@ -6,7 +6,7 @@
 #ifndef BASE_DISPLAY_H_
 #define BASE_DISPLAY_H_
 
-#include <boost/scoped_ptr.hpp>
+#include <vector>
 
 #include "processor/base_processor.h"
 #include "glutils/vbo.h"
@@ -26,8 +26,30 @@ class BaseDisplay : public BaseProcessor {
    */
   virtual void draw() = 0;
 
-  /// Let the display know what size of a window it has to draw in.
-  void resize(float w, float h) { w_ = w; h_ = h; }
+  /** @brief Update the display's state from its inputs, without drawing.
+   *
+   *  This is called once per cycle for all the displays, visible or not,
+   *  before any drawing is done. Displays that keep a history should update
+   *  it here, so that it has no gaps when they are shown again. Does nothing
+   *  by default.
+   */
+  virtual void accumulate() {}
+
+  /** @brief Find out whether drawing the display now would give a different
+   *  result than the last time.
+   *
+   *  This is used to reuse cached renderings of the display. By default, it
+   *  always returns @a true. @see inputsChanged_
+   */
+  virtual bool hasChanged() const { return true; }
+
+  /** @brief Let the display know what size of a window it has to draw in.
+   *
+   *  This is called before @a init, and again whenever the window changes
+   *  size. Displays that keep resources of the size of the window should
+   *  override this, and call the base version.
+   */
+  virtual void resize(float w, float h) { w_ = w; h_ = h; }
 
   /** @brief Initialize the module, if necessary.
    *
@@ -54,13 +76,77 @@ class BaseDisplay : public BaseProcessor {
   void setTransitionStore(const TransitionStorePtr& t)
     { transitions_ = t; }
 
+  /** @brief Give the display a VBO to use for its dynamic data.
+   *
+   *  This is meant to be a streaming VBO shared between all the displays. If
+   *  none is set before @a init, the display creates its own.
+   */
+  void setVbo(const VboPtr& vbo) { vbo_ = vbo; }
+
+  /** @brief Give the display a pool from which to get its render targets.
+   *
+   *  This is meant to be shared between all the displays. If none is set
+   *  before @a init, displays that need one create their own.
+   */
+  void setFboPool(const FboPoolPtr& pool) { fbo_pool_ = pool; }
+
+  /** @brief Give the display a shader program that maps graph-space data to
+   *  the screen on the GPU.
+   *
+   *  If no program is set, the displays do the mapping on the CPU.
+   */
+  void setGraphProgram(const GraphProgramPtr& program)
+    { graph_program_ = program; }
+
+  /** @brief Give the display a shader program for drawing markers on the GPU.
+   *
+   *  If no program is set, the displays build the markers on the CPU.
+   */
+  void setMarkerProgram(const MarkerProgramPtr& program)
+    { marker_program_ = program; }
+
  protected:
-  BaseDisplay() : properties_(0), w_(640), h_(480) {}
+  BaseDisplay() : properties_(0), w_(640), h_(480), dirty_(true) {}
 
   // this kind of processor has no output
   int execute() { markValid(); return 0; }
 
-  boost::any getOutput_() const { return boost::any(); }
+  /** @brief Find out whether the inputs changed since @a markDrawn_ was last
+   *  called.
+   *
+   *  This is the case if one of the processors the display reads from has a
+   *  new version, or if @a markDirty_ was called in the meantime. Displays
+   *  can use this to implement @a hasChanged.
+   */
+  bool inputsChanged_() const {
+    if (dirty_)
+      return true;
+
+    const std::vector<BaseProcessor*> sources = getSources();
+    if (sources.size() != drawn_versions_.size())
+      return true;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      if (sources[i] -> getVersion() != drawn_versions_[i])
+        return true;
+    }
+    return false;
+  }
+
+  /// Note that the display has to be drawn again, e.g., because its settings
+  /// changed.
+  void markDirty_() { dirty_ = true; }
+
+  /// Find out whether @a markDirty_ was called since @a markDrawn_.
+  bool isDirty_() const { return dirty_; }
+
+  /// Remember the versions of the inputs that were drawn.
+  void markDrawn_() {
+    const std::vector<BaseProcessor*> sources = getSources();
+    drawn_versions_.resize(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i)
+      drawn_versions_[i] = sources[i] -> getVersion();
+    dirty_ = false;
+  }
 
   /// Access to a transition store.
   TransitionStorePtr    transitions_;
@@ -68,7 +154,17 @@ class BaseDisplay : public BaseProcessor {
   float                 w_;
   float                 h_;
   /// A VBO for the display.
-  boost::scoped_ptr<Vbo>  vbo_;
+  VboPtr                vbo_;
+  /// Pool of render targets.
+  FboPoolPtr            fbo_pool_;
+  /// Shader program for drawing graph-space data, if available.
+  GraphProgramPtr       graph_program_;
+  /// Shader program for drawing markers, if available.
+  MarkerProgramPtr      marker_program_;
+
+ private:
+  bool                        dirty_;
+  std::vector<unsigned long>  drawn_versions_;
 };
 
 #endif
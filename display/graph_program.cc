@@ -0,0 +1,171 @@
+#include "display/graph_program.h"
+
+static const char* vertex_src =
+  "#version 110\n"
+  "\n"
+  "// screen-space extents of the axes\n"
+  "uniform vec4 extents;\n"
+  "// graph-space range of the axes\n"
+  "uniform vec4 range;\n"
+  "// clipping box, in graph space\n"
+  "uniform vec4 clip_box;\n"
+  "// larger than 0.5 if we should clip\n"
+  "uniform float clip;\n"
+  "// scaling for each axis: initial and target (0 = linear, 1 = log), and\n"
+  "// animation progress\n"
+  "uniform vec3 scaling_x;\n"
+  "uniform vec3 scaling_y;\n"
+  "// size of point sprites, when these are used\n"
+  "uniform float point_size;\n"
+  "\n"
+  "float convert(float x, float b0, float b1, float r0, float r1, float lg)\n"
+  "{\n"
+  "  if (lg < 0.5)\n"
+  "    return b0 + (x - r0)*(b1 - b0)/(r1 - r0);\n"
+  "  if ((x > 0.0 && r0 > 0.0 && r1 > 0.0) ||\n"
+  "      (x < 0.0 && r0 < 0.0 && r1 < 0.0))\n"
+  "    return b0 + log(x/r0)*(b1 - b0)/log(r1/r0);\n"
+  "  return 0.0;\n"
+  "}\n"
+  "\n"
+  "float convertAnimated(float x, float b0, float b1, float r0, float r1,\n"
+  "  vec3 scaling)\n"
+  "{\n"
+  "  float x2 = convert(x, b0, b1, r0, r1, scaling.y);\n"
+  "  if (scaling.z >= 1.0)\n"
+  "    return x2;\n"
+  "  float x1 = convert(x, b0, b1, r0, r1, scaling.x);\n"
+  "  return mix(x1, x2, scaling.z);\n"
+  "}\n"
+  "\n"
+  "void main()\n"
+  "{\n"
+  "  vec2 p = gl_Vertex.xy;\n"
+  "  if (clip > 0.5)\n"
+  "    p = clamp(p, clip_box.xy, clip_box.zw);\n"
+  "\n"
+  "  vec2 screen = vec2(\n"
+  "    convertAnimated(p.x, extents.x, extents.z, range.x, range.z,\n"
+  "      scaling_x),\n"
+  "    convertAnimated(p.y, extents.y, extents.w, range.y, range.w,\n"
+  "      scaling_y));\n"
+  "\n"
+  "  gl_Position = gl_ModelViewProjectionMatrix*vec4(screen, 0.0, 1.0);\n"
+  "  gl_FrontColor = gl_Color;\n"
+  "  gl_PointSize = point_size;\n"
+  "}\n";
+
+static const char* fragment_src =
+  "#version 110\n"
+  "\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = gl_Color;\n"
+  "}\n";
+
+static const char* marker_fragment_src =
+  "#version 110\n"
+  "\n"
+  "// marker shape: 0 = diamond, 1 = square, 2 = disc, 3 = cross\n"
+  "uniform float shape;\n"
+  "\n"
+  "void main()\n"
+  "{\n"
+  "  vec2 q = abs(2.0*gl_PointCoord - 1.0);\n"
+  "  if (shape < 0.5) {\n"
+  "    if (q.x + q.y > 1.0)\n"
+  "      discard;\n"
+  "  } else if (shape < 1.5) {\n"
+  "    // the whole sprite is used\n"
+  "  } else if (shape < 2.5) {\n"
+  "    if (dot(q, q) > 1.0)\n"
+  "      discard;\n"
+  "  } else {\n"
+  "    if (min(q.x, q.y) > 0.25)\n"
+  "      discard;\n"
+  "  }\n"
+  "  gl_FragColor = gl_Color;\n"
+  "}\n";
+
+GraphProgram::GraphProgram() : ShaderProgram(vertex_src, fragment_src)
+{
+}
+
+GraphProgram::GraphProgram(const std::string& fragment) :
+    ShaderProgram(vertex_src, fragment)
+{
+}
+
+static void setScaling(ShaderProgram& program, const std::string& name,
+    const DiscreteAnimated<Axes::ScalingType>& scaling)
+{
+  // XXX the CPU version treats progress within 1e-6 of 1 as done
+  const float eps = 1e-6;
+  float progress = (1 - scaling.progress < eps)?1:scaling.progress;
+  program.setUniform(name, (scaling.initial == Axes::LOG)?1:0,
+    (scaling.target == Axes::LOG)?1:0, progress);
+}
+
+void GraphProgram::setAxes(const Axes& axes)
+{
+  const Rectangle& extents = axes.getExtents(true);
+  const Rectangle& range = axes.getRange(true);
+  const Rectangle& clip_box = axes.getClippingArea(true);
+
+  setUniform("extents", extents.start.x, extents.start.y, extents.end.x,
+    extents.end.y);
+  setUniform("range", range.start.x, range.start.y, range.end.x, range.end.y);
+  setUniform("clip_box", clip_box.start.x, clip_box.start.y, clip_box.end.x,
+    clip_box.end.y);
+  setUniform("clip", axes.getClipping()?1:0);
+  setScaling(*this, "scaling_x", axes.getScalingStateX());
+  setScaling(*this, "scaling_y", axes.getScalingStateY());
+}
+
+MarkerProgram::MarkerProgram() : GraphProgram(marker_fragment_src)
+{
+}
+
+void MarkerProgram::begin()
+{
+  use();
+  GlState::enable(GL_VERTEX_PROGRAM_POINT_SIZE);
+  GlState::enable(GL_POINT_SPRITE);
+}
+
+void MarkerProgram::end()
+{
+  GlState::disable(GL_POINT_SPRITE);
+  GlState::disable(GL_VERTEX_PROGRAM_POINT_SIZE);
+  unuse();
+}
+
+MarkerProgram::Shape MarkerProgram::getShape(const std::string& s)
+{
+  if (s == "diamond")
+    return DIAMOND;
+  else if (s == "square")
+    return SQUARE;
+  else if (s == "disc")
+    return DISC;
+  else if (s == "cross")
+    return CROSS;
+  else
+    throw Exception("Unknown marker shape: " + s + ".");
+}
+
+std::string MarkerProgram::getShapeString(Shape shape)
+{
+  switch (shape) {
+    case DIAMOND:
+      return "diamond";
+    case SQUARE:
+      return "square";
+    case DISC:
+      return "disc";
+    case CROSS:
+      return "cross";
+  }
+
+  return "";
+}
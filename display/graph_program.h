@@ -0,0 +1,70 @@
+/** @file graph_program.h
+ *  @brief Defines a shader program that maps graph-space data to the screen.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GRAPH_PROGRAM_H_
+#define GRAPH_PROGRAM_H_
+
+#include "display/axes.h"
+#include "glutils/shader.h"
+
+/** @brief A shader program that does the job of @a Axes::graphToScreen on the
+ *  GPU.
+ *
+ *  Vertices sent while this program is in use are in graph space. The vertex
+ *  shader clips them (if the axes require it), and maps them to the screen
+ *  using the linear or log scaling of the axes, including the blend used while
+ *  the scaling type is animated. Colors are used as in the fixed-function
+ *  pipeline.
+ */
+class GraphProgram : public ShaderProgram {
+ public:
+  /// Compile the program. Throws @a ShaderError upon failure.
+  GraphProgram();
+
+  /** @brief Set the uniforms that describe the mapping performed by the
+   *  given axes. The program must be in use.
+   */
+  void setAxes(const Axes& axes);
+
+ protected:
+  /// Compile the program using a different fragment shader.
+  explicit GraphProgram(const std::string& fragment_src);
+};
+
+/** @brief A version of @a GraphProgram that draws markers.
+ *
+ *  This is meant to be used with @a GL_POINTS: each vertex is expanded into a
+ *  point sprite of the given size, and the fragment shader cuts the marker
+ *  shape out of it. Use @a begin and @a end around the drawing, to turn on
+ *  the point sprite state.
+ */
+class MarkerProgram : public GraphProgram {
+ public:
+  /// Marker shapes.
+  enum Shape { DIAMOND, SQUARE, DISC, CROSS };
+
+  /// Compile the program. Throws @a ShaderError upon failure.
+  MarkerProgram();
+
+  /// Start using the program, and turn on point sprites.
+  void begin();
+
+  /// Turn off point sprites, and go back to the fixed-function pipeline.
+  static void end();
+
+  /// Set the size of the markers, in pixels. The program must be in use.
+  void setMarkerSize(float sz) { setUniform("point_size", sz); }
+
+  /// Set the shape of the markers. The program must be in use.
+  void setMarkerShape(Shape shape) { setUniform("shape", (float)shape); }
+
+  /// Convert a string to a marker shape. Throws if the string is unknown.
+  static Shape getShape(const std::string& s);
+
+  /// Convert a marker shape to a string.
+  static std::string getShapeString(Shape shape);
+};
+
+#endif
@@ -1,46 +1,112 @@
 #include "display/oscilloscope.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "animation/standard_easing.h"
 #include "animation/transition_store.h"
+#include "display/graph_program.h"
 #include "glutils/color.h"
 #include "glutils/geometry.h"
+#include "glutils/gl_state.h"
 #include "input/base_input.h"
 #include "processor/grabber.h"
+#include "processor/vector_ops.h"
 #include "glutils/gl_incs.h"
 #include "utils/exception.h"
 #include "utils/logging.h"
 
+void Oscilloscope::accumulate()
+{
+  // get the data from the input module
+  const std::vector<float>& data = raw_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+
+  const size_t n_new = updateHistory_(data, details);
+
+  // look for trigger events in the new samples only
+  const float rate = details.samplingFrequency;
+  trigger_.setHoldoff(trigger_holdoff_*rate);
+  trigger_.scan(&data[0] + data.size() - n_new, n_new, details.end - n_new);
+  // events that are no longer in the window will not be needed again
+  trigger_.dropEventsBefore((double)details.end - data.size());
+
+  if (phosphor_mode_)
+    feedPhosphor_(data.size());
+}
+
+bool Oscilloscope::hasChanged() const
+{
+  if (isDirty_() || phosphor_mode_ || animator_.hasAnimations() ||
+      axes_.hasAnimations())
+  {
+    return true;
+  }
+
+  // a captured single-shot trace is kept regardless of the new samples
+  if (getZeroFixState() && trigger_mode_ == T_SINGLE && captured_ &&
+      timebase_ == 0)
+  {
+    return false;
+  }
+
+  const std::deque<double>& events = trigger_.getEvents();
+  return history_.getEnd() != drawn_end_ ||
+    events.size() != drawn_events_ ||
+    (!events.empty() && events.back() != drawn_event_);
+}
+
 void Oscilloscope::draw()
 {
   // update the state of the animations
   animator_.update();
   axes_.updateAnimations();
 
-  // get the data from the input module
-  Grabber::Output pdata = boost::any_cast<Grabber::Output>
-    (inputs_["raw"] -> getOutput());
-  const std::vector<float>& data = *pdata;
+  // get the data from the input module; the history and the trigger were
+  // updated in accumulate
+  const std::vector<float>& data = raw_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+  const float rate = details.samplingFrequency;
+
+  // use the history if the time base is longer than the input window
+  const bool long_timebase = (history_.getCapacity() > 0 &&
+    timebase_*rate > data.size());
 
+  const std::vector<float>* trace = &data;
   float shift = 0;
-  unsigned sz2 = data.size()/2;
-  if (max_shift_ > 0) {
-    // find the minimal shift that places a zero in the center of the display
-    // find a zero through which the function is increasing
-    unsigned dist = std::min((unsigned)(max_shift_*sz2), sz2);
-    for (unsigned i = 1; i < dist; ++i) {
-      if (data[sz2 + i] >= 0 && data[sz2 + i - 1] <= 0) {
-        shift = i;
+  if (max_shift_ > 0 && !long_timebase) {
+    const bool found = findTrigger_(data, details, shift);
+    switch (trigger_mode_) {
+      case T_AUTO:
         break;
-      } else if (data[sz2 - i] <= 0 && data[sz2 - i + 1] >= 0) {
-        shift = -(float)i;
+      case T_NORMAL:
+        if (found) {
+          held_ = data;
+          held_shift_ = shift;
+        } else {
+          trace = &held_;
+          shift = held_shift_;
+        }
+        break;
+      case T_SINGLE:
+        if (found && !captured_) {
+          held_ = data;
+          held_shift_ = shift;
+          captured_ = true;
+        }
+        trace = &held_;
+        shift = held_shift_;
         break;
-      }
     }
   }
 
-  glDisable(GL_TEXTURE_2D);
+  // the phosphor shows all the triggered traces, so it is drawn instead of
+  // the current one
+  const bool phosphor = (phosphor_mode_ && !long_timebase);
+  if (phosphor)
+    drawPhosphor_();
+
+  GlState::disable(GL_TEXTURE_2D);
 
   // draw the axes
   axes_.draw();
@@ -62,8 +128,27 @@ void Oscilloscope::draw()
     alpha_lines = fin_lines;
   }
 
-  drawLines_(data, alpha_lines, shift);
-  drawPoints_(data, alpha_points, shift);
+  if (long_timebase) {
+    // the envelope is drawn with whichever style is more visible
+    const double span = timebase_*rate;
+    const double end = history_.getEnd();
+    const unsigned columns = getColumns_();
+    env_min_.resize(columns);
+    env_max_.resize(columns);
+    history_.getEnvelope(end - span, end, columns, &env_min_[0],
+      &env_max_[0]);
+    drawEnvelope_(std::max(alpha_lines, alpha_points));
+  } else if (!phosphor && !trace -> empty()) {
+    drawLines_(*trace, alpha_lines, shift);
+    drawPoints_(*trace, alpha_points, shift);
+  }
+
+  // remember what was drawn, for hasChanged
+  const std::deque<double>& events = trigger_.getEvents();
+  drawn_end_ = history_.getEnd();
+  drawn_events_ = events.size();
+  drawn_event_ = events.empty()?0:events.back();
+  markDrawn_();
 }
 
 bool Oscilloscope::handleEvent(SDL_Event* event)
@@ -99,6 +184,37 @@ bool Oscilloscope::handleEvent(SDL_Event* event)
         if (no_mods) {
           flipZeroFixState();
           handled = true;
+        } else if (just_shift) {
+          rearmTrigger();
+          handled = true;
+        }
+        break;
+      case SDLK_e:
+        if (no_mods) {
+          trigger_.setSlope((trigger_.getSlope() == Trigger::RISING)?
+            Trigger::FALLING:Trigger::RISING);
+          handled = true;
+        }
+        break;
+      case SDLK_m:
+        if (no_mods) {
+          cycleTriggerMode();
+          handled = true;
+        }
+        break;
+      case SDLK_p:
+        if (no_mods) {
+          flipPhosphorMode();
+          handled = true;
+        }
+        break;
+      case SDLK_t:
+        if (no_mods) {
+          increaseTimebase();
+          handled = true;
+        } else if (just_shift) {
+          decreaseTimebase();
+          handled = true;
         }
         break;
       case SDLK_r:
@@ -141,6 +257,8 @@ bool Oscilloscope::handleEvent(SDL_Event* event)
     }
   }
 
+  if (handled)
+    markDirty_();
   return handled;
 }
 
@@ -154,6 +272,26 @@ int Oscilloscope::init()
   max_shift_limit_ = properties_ -> get<float>("maxshift");
   setZeroFixState(properties_ -> get<bool>("zerofix"));
   setStyle(properties_ -> get<std::string>("style"), "none");
+  marker_size_ = properties_ -> get("marker_size", marker_size_);
+  marker_shape_ = MarkerProgram::getShape(properties_ -> get("marker_shape",
+    MarkerProgram::getShapeString(marker_shape_)));
+  setTimebase(properties_ -> get("timebase", timebase_));
+  setTriggerMode(properties_ -> get("trigger_mode", getTriggerModeString()));
+  trigger_.setLevel(properties_ -> get("trigger_level", trigger_.getLevel()));
+  trigger_.setSlope(properties_ -> get("trigger_slope",
+    trigger_.getSlopeString()));
+  trigger_.setHysteresis(properties_ -> get("trigger_hysteresis",
+    trigger_.getHysteresis()));
+  trigger_holdoff_ = properties_ -> get("trigger_holdoff", trigger_holdoff_);
+  setPhosphorMode(properties_ -> get("phosphor", phosphor_mode_));
+  phosphor_.setDecay(properties_ -> get("phosphor_decay",
+    phosphor_.getDecay()));
+  phosphor_.setSaturation(properties_ -> get("phosphor_saturation",
+    phosphor_.getSaturation()));
+  phosphor_palette_ = properties_ -> get("phosphor_palette",
+    std::string("thermal"));
+  phosphor_.setPalette(Palette(phosphor_palette_));
+  history_length_ = properties_ -> get("history", history_length_);
 
   // set up non-configurable properties of the axes
   axes_.setType(Axes::CROSS, "none");
@@ -178,15 +316,26 @@ int Oscilloscope::init()
   // set up the transitions
   axes_.setTransitionStore(transitions_);
 
-  // create the VBO
-  const size_t vbo_size = 8*n_points_*sizeof(GlVertex2);
-  vbo_.reset(new Vbo(vbo_size));
+  // create the VBO, unless we were given one
+  if (!vbo_) {
+    const size_t vbo_size = 8*n_points_*sizeof(GlVertex2);
+    vbo_.reset(new Vbo(vbo_size, true));
+  }
 
   return 0;
 }
 
+void Oscilloscope::resize(float w, float h)
+{
+  BaseSdlDisplay::resize(w, h);
+  markDirty_();
+  axes_.setExtents(Rectangle(0, 0, w_, h_), "none");
+}
+
 void Oscilloscope::done()
 {
+  phosphor_.stop();
+  phosphor_texture_.reset();
 }
 
 void Oscilloscope::setStyle(const std::string& s, const std::string& trans)
@@ -239,6 +388,71 @@ void Oscilloscope::revCycleStyle(const std::string& trans)
   }
 }
 
+void Oscilloscope::setTriggerMode(const std::string& s)
+{
+  if (s == "auto")
+    setTriggerMode(T_AUTO);
+  else if (s == "normal")
+    setTriggerMode(T_NORMAL);
+  else if (s == "single")
+    setTriggerMode(T_SINGLE);
+  else
+    throw Exception("Unknown oscilloscope trigger mode: " + s + ".");
+}
+
+void Oscilloscope::cycleTriggerMode()
+{
+  switch (trigger_mode_) {
+    case T_AUTO:
+      setTriggerMode(T_NORMAL);
+      break;
+    case T_NORMAL:
+      setTriggerMode(T_SINGLE);
+      break;
+    case T_SINGLE:
+      setTriggerMode(T_AUTO);
+      break;
+  }
+}
+
+std::string Oscilloscope::getTriggerModeString() const
+{
+  switch (trigger_mode_) {
+    case T_AUTO:
+      return "auto";
+    case T_NORMAL:
+      return "normal";
+    case T_SINGLE:
+      return "single";
+  }
+
+  return "";
+}
+
+void Oscilloscope::setPhosphorMode(bool b)
+{
+  if (b && !phosphor_mode_) {
+    // start from a clean screen, with the traces that come after this
+    phosphor_.clear();
+    last_phosphor_event_ = last_end_;
+    phosphor_timer_.reset();
+  }
+  phosphor_mode_ = b;
+}
+
+void Oscilloscope::increaseTimebase()
+{
+  setTimebase(std::min(2*std::max(timebase_, window_time_), history_length_));
+}
+
+void Oscilloscope::decreaseTimebase()
+{
+  timebase_ /= 2;
+  // go back to showing the input window once the time base gets too short
+  if (timebase_ <= window_time_)
+    timebase_ = 0;
+}
+
 std::string Oscilloscope::getStyleString() const
 {
   switch (getStyle()) {
@@ -259,6 +473,20 @@ void Oscilloscope::updateProperties()
   properties_ -> put("maxshift", max_shift_limit_);
   properties_ -> put("zerofix", getZeroFixState());
   properties_ -> put("style", getStyleString());
+  properties_ -> put("marker_size", marker_size_);
+  properties_ -> put("marker_shape",
+    MarkerProgram::getShapeString(marker_shape_));
+  properties_ -> put("timebase", timebase_);
+  properties_ -> put("trigger_mode", getTriggerModeString());
+  properties_ -> put("trigger_level", trigger_.getLevel());
+  properties_ -> put("trigger_slope", trigger_.getSlopeString());
+  properties_ -> put("trigger_hysteresis", trigger_.getHysteresis());
+  properties_ -> put("trigger_holdoff", trigger_holdoff_);
+  properties_ -> put("phosphor", phosphor_mode_);
+  properties_ -> put("phosphor_decay", phosphor_.getDecay());
+  properties_ -> put("phosphor_saturation", phosphor_.getSaturation());
+  properties_ -> put("phosphor_palette", phosphor_palette_);
+  properties_ -> put("history", history_length_);
 
   axes_.updateProperties();
 }
@@ -277,10 +505,112 @@ const std::pair<float, BaseEasingPtr>& Oscilloscope::getTransition_
   }
 }
 
+size_t Oscilloscope::updateHistory_(const std::vector<float>& data,
+    const Grabber::DetailsStruct& details)
+{
+  const float rate = details.samplingFrequency;
+  const size_t sz = data.size();
+  window_time_ = sz / rate;
+
+  // start over the first time, or if the sample count went down (the input
+  // was switched)
+  bool reset = (details.end < last_end_ || last_end_ == 0);
+
+  // (re)allocate the history when the sampling frequency changes
+  if (rate != history_rate_) {
+    history_.setCapacity(history_length_*rate);
+    history_rate_ = rate;
+    reset = true;
+  }
+
+  // the history uses the same sample indices as the input
+  if (reset) {
+    history_.clear();
+    trigger_.reset();
+  }
+  last_end_ = details.end;
+
+  return history_.appendWindow(&data[0], sz, details.end);
+}
+
+bool Oscilloscope::findTrigger_(const std::vector<float>& data,
+    const Grabber::DetailsStruct& details, float& shift)
+{
+  const unsigned sz2 = data.size()/2;
+  const double dist = std::min(max_shift_*sz2, (float)sz2);
+
+  const double window_start = (double)details.end - data.size();
+
+  bool found = false;
+  const std::deque<double>& events = trigger_.getEvents();
+  for (std::deque<double>::const_iterator i = events.begin();
+       i != events.end();
+       ++i)
+  {
+    const double offset = *i - window_start - sz2;
+    if (std::fabs(offset) <= dist && (!found || std::fabs(offset) <
+        std::fabs(shift)))
+    {
+      shift = offset;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+unsigned Oscilloscope::getColumns_() const
+{
+  const Rectangle& extents = axes_.getExtents();
+  return std::max((unsigned)std::fabs(extents.end.x - extents.start.x), 2u);
+}
+
+/// Linearly interpolate the data at a position 0 <= t <= data.size() - 1.
+static float interpolate(const std::vector<float>& data, float t)
+{
+  const unsigned k = t;
+  if (k + 1 >= data.size())
+    return data[data.size() - 1];
+
+  const float f = t - k;
+  return data[k] + f*(data[k + 1] - data[k]);
+}
+
 void Oscilloscope::drawLines_(const std::vector<float>& data, float alpha,
     float shift)
 {
-  unsigned sz = data.size();
+  if (alpha <= 0)
+    return;
+
+  const unsigned sz = data.size();
+  const unsigned columns = getColumns_();
+
+  if (sz >= 2*columns) {
+    // with at least two samples per pixel, point sampling would alias; draw
+    // the extent of the data within each pixel column instead
+    env_min_.resize(columns);
+    env_max_.resize(columns);
+
+    const double dt = (double)sz/columns;
+    for (unsigned i = 0; i < columns; ++i) {
+      const double a = std::max(std::floor(i*dt + shift), 0.0);
+      const double b = std::min(std::floor((i + 1)*dt + shift), (double)sz);
+      if (a >= b) {
+        // mark this column as empty
+        env_min_[i] = 1;
+        env_max_[i] = -1;
+        continue;
+      }
+
+      const float* p = &data[(unsigned)a];
+      const unsigned n = b - a;
+      env_min_[i] = vectorMin(p, n, *p);
+      env_max_[i] = vectorMax(p, n, *p);
+    }
+
+    drawEnvelope_(alpha);
+    return;
+  }
 
   // data for the VBO
   std::vector<GlVertex2> points;
@@ -295,25 +625,68 @@ void Oscilloscope::drawLines_(const std::vector<float>& data, float alpha,
 
     if (t < 0)
       continue;
-    if (t > sz)
+    if (t > sz - 1)
       break;
 
-    GlVertex2 p((float)i/(n - 1), data[t]);
+    points.push_back(GlVertex2((float)i/(n - 1), interpolate(data, t)));
+  }
+
+  drawStrip_(points, alpha);
+}
+
+void Oscilloscope::drawEnvelope_(float alpha)
+{
+  if (alpha <= 0)
+    return;
+
+  // the strip zig-zags between the minimum and the maximum in each column,
+  // alternating the order so that consecutive columns join up
+  const unsigned columns = env_min_.size();
+  std::vector<GlVertex2> points;
+  points.reserve(2*columns);
+  for (unsigned i = 0; i < columns; ++i) {
+    if (env_min_[i] > env_max_[i])
+      continue;
 
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)));
+    const float x = (i + 0.5f)/columns;
+    if (i % 2 == 0) {
+      points.push_back(GlVertex2(x, env_min_[i]));
+      points.push_back(GlVertex2(x, env_max_[i]));
+    } else {
+      points.push_back(GlVertex2(x, env_max_[i]));
+      points.push_back(GlVertex2(x, env_min_[i]));
+    }
   }
 
+  drawStrip_(points, alpha);
+}
+
+void Oscilloscope::drawStrip_(const std::vector<GlVertex2>& points,
+    float alpha)
+{
   // XXX make this configurable
   setGlColor(GlColor4(alpha, alpha, alpha, alpha));
 
-  // send the data to OpenGL
-  vbo_ -> draw(points, GL_LINE_STRIP);
+  // with a graph program, the mapping to screen space is done on the GPU
+  if (graph_program_) {
+    graph_program_ -> use();
+    graph_program_ -> setAxes(axes_);
+    vbo_ -> draw(points, GL_LINE_STRIP);
+    ShaderProgram::unuse();
+  } else {
+    std::vector<GlVertex2> screen;
+    screen.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+      screen.push_back(axes_.graphToScreen(axes_.getClipped(points[i])));
+    vbo_ -> draw(screen, GL_LINE_STRIP);
+  }
 }
 
 void Oscilloscope::drawPoints_(const std::vector<float>& data, float alpha,
     float shift)
 {
-  // XXX UGH! so much code duplication!
+  if (alpha <= 0)
+    return;
 
   unsigned sz = data.size();
 
@@ -326,24 +699,52 @@ void Oscilloscope::drawPoints_(const std::vector<float>& data, float alpha,
 
   float dt = (float)sz/n;
 
-  // XXX make this configurable!
-  GlVertex2 cr_horiz(3, 0);
-  GlVertex2 cr_vert(0, 3);
+  // with a marker program, we only send one vertex per sample, and the
+  // markers are drawn on the GPU
+  if (marker_program_) {
+    for (unsigned i = 0; i < n; ++i) {
+      const float t = i*dt + shift;
+
+      if (t < 0)
+        continue;
+      if (t > sz - 1)
+        break;
+
+      points.push_back(GlVertex2((float)i/(n - 1), interpolate(data, t)));
+    }
+
+    // XXX make this configurable
+    setGlColor(GlColor4(alpha, alpha, alpha, alpha));
+
+    marker_program_ -> begin();
+    marker_program_ -> setAxes(axes_);
+    marker_program_ -> setMarkerSize(marker_size_);
+    marker_program_ -> setMarkerShape(marker_shape_);
+    vbo_ -> draw(points, GL_POINTS);
+    MarkerProgram::end();
+
+    return;
+  }
+
+  // otherwise the markers are diamonds built on the CPU
+  GlVertex2 cr_horiz(marker_size_/2, 0);
+  GlVertex2 cr_vert(0, marker_size_/2);
 
   for (unsigned i = 0; i < n; ++i) {
     const float t = i*dt + shift;
 
     if (t < 0)
       continue;
-    if (t > sz)
+    if (t > sz - 1)
       break;
 
-    GlVertex2 p((float)i/(n - 1), data[t]);
+    GlVertex2 p((float)i/(n - 1), interpolate(data, t));
+    GlVertex2 screen = axes_.graphToScreen(axes_.getClipped(p));
 
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)) - cr_horiz);
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)) - cr_vert);
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)) + cr_horiz);
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)) + cr_vert);
+    points.push_back(screen - cr_horiz);
+    points.push_back(screen - cr_vert);
+    points.push_back(screen + cr_horiz);
+    points.push_back(screen + cr_vert);
   }
 
   // XXX make this configurable
@@ -352,3 +753,81 @@ void Oscilloscope::drawPoints_(const std::vector<float>& data, float alpha,
   // send the data to OpenGL
   vbo_ -> draw(points, GL_QUADS);
 }
+
+void Oscilloscope::feedPhosphor_(size_t size)
+{
+  // match the buffer to the graph area
+  const Rectangle& extents = axes_.getExtents();
+  const unsigned width = getColumns_();
+  const unsigned height = std::fabs(extents.end.y - extents.start.y);
+  if (phosphor_.getWidth() != width || phosphor_.getHeight() != height) {
+    phosphor_.setSize(width, height);
+    phosphor_texture_.reset();
+  }
+  const Rectangle& range = axes_.getRange();
+  phosphor_.setRange(range.start.y, range.end.y);
+
+  // each trace is centered on its trigger event; an extra sample on each side
+  // is needed for the sub-sample offset
+  const size_t size2 = size/2;
+  std::vector<float> trace(size + 2);
+  const std::deque<double>& events = trigger_.getEvents();
+  for (std::deque<double>::const_iterator i = events.begin();
+       i != events.end();
+       ++i)
+  {
+    if (*i <= last_phosphor_event_ || *i < size2)
+      continue;
+
+    const unsigned long long first = std::floor(*i) - size2;
+    // wait for the rest of the trace to come in
+    if (first + trace.size() > history_.getEnd())
+      break;
+
+    if (history_.copy(first, trace.size(), &trace[0]))
+      phosphor_.addTrace(&trace[0], trace.size(), *i - std::floor(*i), size);
+    last_phosphor_event_ = *i;
+  }
+}
+
+void Oscilloscope::drawPhosphor_()
+{
+  const float dt = phosphor_timer_.getElapsed();
+  phosphor_timer_.reset();
+  phosphor_.render(dt, phosphor_pixels_);
+
+  const unsigned width = phosphor_.getWidth();
+  const unsigned height = phosphor_.getHeight();
+  if (width == 0 || height == 0)
+    return;
+
+  // upload the buffer once per frame
+  if (!phosphor_texture_) {
+    phosphor_texture_.reset(new Texture(width, height));
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  } else {
+    phosphor_texture_ -> bind();
+  }
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+    GL_UNSIGNED_BYTE, &phosphor_pixels_[0]);
+
+  GlState::enable(GL_TEXTURE_2D);
+  setGlColor(GlColor4(1, 1, 1));
+
+  const Rectangle& e = axes_.getExtents();
+  std::vector<GlVertexTex2> points_tex;
+  points_tex.push_back(GlVertexTex2(e.start.x, e.start.y, 0, 0));
+  points_tex.push_back(GlVertexTex2(e.end.x, e.start.y, 1, 0));
+  points_tex.push_back(GlVertexTex2(e.end.x, e.end.y, 1, 1));
+  points_tex.push_back(GlVertexTex2(e.start.x, e.end.y, 0, 1));
+
+  // select the texture
+  glClientActiveTexture(GL_TEXTURE0);
+
+  // send the data to OpenGL
+  vbo_ -> draw(points_tex, GL_QUADS);
+  GlState::disable(GL_TEXTURE_2D);
+}
@@ -6,12 +6,21 @@
 #ifndef OSCILLOSCOPE_H_
 #define OSCILLOSCOPE_H_
 
+#include <algorithm>
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
+
 #include "animation/animator.h"
 #include "display/axes.h"
 #include "display/base_sdl_display.h"
+#include "display/graph_program.h"
+#include "display/phosphor.h"
 #include "glutils/gl_incs.h"
+#include "glutils/texture.h"
+#include "processor/grabber.h"
+#include "processor/sample_history.h"
+#include "processor/trigger.h"
 #include "utils/misc.h"
 
 /// Oscilloscope display.
@@ -20,31 +29,94 @@ class Oscilloscope : public BaseSdlDisplay {
   /// The style of the display -- lines, points, or both.
   enum Style { S_POINTS, S_LINES, S_BOTH };
 
+  /** @brief What to show when there is no trigger event in the window.
+   *
+   *  In auto mode, the trace runs free; in normal mode, the last triggered
+   *  trace is kept; in single mode, the first triggered trace is kept until
+   *  the trigger is rearmed.
+   */
+  enum TriggerMode { T_AUTO, T_NORMAL, T_SINGLE };
+
   /// Constructor.
   Oscilloscope() : n_points_(500), max_shift_limit_(0.4),
     max_shift_(max_shift_limit_), zero_fix_transition_time_(0.4),
-    style_(S_LINES) {}
+    style_(S_LINES), marker_size_(6), marker_shape_(MarkerProgram::DIAMOND),
+    timebase_(0), history_length_(60), history_rate_(0), last_end_(0),
+    window_time_(0), trigger_mode_(T_AUTO), trigger_holdoff_(0),
+    held_shift_(0), captured_(false), phosphor_mode_(false),
+    last_phosphor_event_(0), drawn_end_(0), drawn_events_(0),
+    drawn_event_(0)
+  {
+    registerInput_("raw", &raw_);
+    registerInput_("details", &details_);
+  }
 
   /// Implement the draw function.
   virtual void draw();
 
+  /// Keep the history, the trigger, and the phosphor up to date.
+  virtual void accumulate();
+
+  /** @brief The trace changes when new samples reach the history, when the
+   *  trigger finds new events, and with the settings and the animations.
+   *
+   *  A captured single-shot trace doesn't change until the trigger is
+   *  rearmed, and the phosphor always changes, since it decays.
+   */
+  virtual bool hasChanged() const;
+
   /// Handle some events.
   virtual bool handleEvent(SDL_Event* event);
 
+  /// Fit the axes to the new size. The phosphor follows the axes.
+  virtual void resize(float w, float h);
+
   /// Initialize the oscilloscope display.
   virtual int init();
   /// Clean up.
   virtual void done();
 
-  /// Set whether to do zero-fixing or not.
+  /// Set whether to align the trace to the trigger events or not.
   void setZeroFixState(bool b) { max_shift_ = b?max_shift_limit_:0; }
   
-  /// Flip zero-fixing state.
+  /// Flip trigger alignment state.
   void flipZeroFixState() { setZeroFixState(!getZeroFixState()); }
 
-  /// Find out whether we're doing zero-fixing.
+  /// Find out whether we're aligning the trace to the trigger events.
   bool getZeroFixState() const { return (max_shift_ > 1e-3); }
 
+  /// Access the trigger.
+  Trigger& getTrigger() { return trigger_; }
+
+  /// Set the trigger mode ("auto", "normal", or "single").
+  void setTriggerMode(const std::string& s);
+
+  /// Set the trigger mode.
+  void setTriggerMode(TriggerMode m) { trigger_mode_ = m; captured_ = false; }
+
+  /// Cycle to the next trigger mode.
+  void cycleTriggerMode();
+
+  /// Get the trigger mode.
+  TriggerMode getTriggerMode() const { return trigger_mode_; }
+
+  /// Get the trigger mode as a string.
+  std::string getTriggerModeString() const;
+
+  /// Wait for a new trigger event in single mode.
+  void rearmTrigger() { captured_ = false; }
+
+  /** @brief Set whether to accumulate all the triggered traces into an
+   *  intensity-graded display, like a phosphor screen.
+   */
+  void setPhosphorMode(bool b);
+
+  /// Flip the phosphor mode.
+  void flipPhosphorMode() { setPhosphorMode(!phosphor_mode_); }
+
+  /// Find out whether the phosphor mode is on.
+  bool getPhosphorMode() const { return phosphor_mode_; }
+
   /// Set the style of the display ("points", "lines", or "both").
   void setStyle(const std::string& s, const std::string& trans = std::string());
 
@@ -63,14 +135,56 @@ class Oscilloscope : public BaseSdlDisplay {
   /// Get the current display style as a string.
   std::string getStyleString() const;
 
+  /** @brief Set the time span covered by the display, in seconds.
+   *
+   *  If this is longer than the input window, the trace is drawn from the
+   *  sample history, as a min/max envelope. Set to zero to always show just
+   *  the current input window.
+   */
+  void setTimebase(float t) { timebase_ = std::max(t, 0.0f); }
+
+  /// Get the time span covered by the display (zero for the input window).
+  float getTimebase() const { return timebase_; }
+
+  /// Double the time span covered by the display.
+  void increaseTimebase();
+
+  /// Halve the time span covered by the display.
+  void decreaseTimebase();
+
   /// Update the settings.
   virtual void updateProperties();
 
  private:
+  InputPort<std::vector<float> >      raw_;
+  InputPort<Grabber::DetailsStruct>   details_;
+
   const std::pair<float, BaseEasingPtr>& getTransition_
       (const std::string& name, const std::string& trans);
   void drawPoints_(const std::vector<float>& data, float alpha, float shift);
   void drawLines_(const std::vector<float>& data, float alpha, float shift);
+  /// Draw the envelope stored in env_min_ and env_max_.
+  void drawEnvelope_(float alpha);
+  /// Draw a line strip, mapping it to the screen if there is no graph program.
+  void drawStrip_(const std::vector<GlVertex2>& points, float alpha);
+  /// Add the new samples from the input window to the history. Returns the
+  /// number of new samples.
+  size_t updateHistory_(const std::vector<float>& data,
+    const Grabber::DetailsStruct& details);
+  /** @brief Find the shift that places the trigger event closest to the
+   *  center of the window there.
+   *
+   *  Returns @a false if no event is close enough to the center.
+   */
+  bool findTrigger_(const std::vector<float>& data,
+    const Grabber::DetailsStruct& details, float& shift);
+  /// Number of pixel columns covered by the graph.
+  unsigned getColumns_() const;
+  /// Send the traces for the trigger events that were not seen yet to the
+  /// phosphor.
+  void feedPhosphor_(size_t size);
+  /// Draw the phosphor's density buffer.
+  void drawPhosphor_();
 
   unsigned                n_points_;
   Animator                animator_;
@@ -79,6 +193,47 @@ class Oscilloscope : public BaseSdlDisplay {
   float                   max_shift_;
   float                   zero_fix_transition_time_;
   DiscreteAnimated<Style> style_;
+  /// Size of the markers used for the points style, in pixels.
+  float                   marker_size_;
+  /// Shape of the markers used for the points style.
+  MarkerProgram::Shape    marker_shape_;
+  /// Time span covered by the display, in seconds; zero for the input window.
+  float                   timebase_;
+  /// Length of the sample history, in seconds.
+  float                   history_length_;
+  /// Sampling frequency for which the history was allocated.
+  float                   history_rate_;
+  SampleHistory           history_;
+  /// Input sample count at the end of the last window added to the history.
+  unsigned long long      last_end_;
+  /// Duration of the last input window, in seconds.
+  float                   window_time_;
+  Trigger                 trigger_;
+  TriggerMode             trigger_mode_;
+  /// Trigger holdoff, in seconds.
+  float                   trigger_holdoff_;
+  /// Trace kept in normal and single trigger modes, and its shift.
+  std::vector<float>      held_;
+  float                   held_shift_;
+  /// Whether a trace was captured in single trigger mode.
+  bool                    captured_;
+  bool                    phosphor_mode_;
+  Phosphor                phosphor_;
+  /// Position of the last trigger event sent to the phosphor.
+  double                  last_phosphor_event_;
+  /// Measures the time between phosphor updates, for the decay.
+  Timer                   phosphor_timer_;
+  std::string             phosphor_palette_;
+  boost::scoped_ptr<Texture>  phosphor_texture_;
+  std::vector<unsigned char>  phosphor_pixels_;
+  /// Per-column minima and maxima for envelope drawing.
+  std::vector<float>      env_min_;
+  std::vector<float>      env_max_;
+  /// End of the history, number of trigger events, and position of the last
+  /// of them, when the trace was last drawn.
+  unsigned long long      drawn_end_;
+  size_t                  drawn_events_;
+  double                  drawn_event_;
 };
 
 #endif
@@ -0,0 +1,201 @@
+#include "display/phosphor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/vector_ops.h"
+
+void Phosphor::setSize(unsigned width, unsigned height)
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  width_ = width;
+  height_ = height;
+  density_.assign(width_*height_, 0);
+  ++generation_;
+}
+
+void Phosphor::setRange(float bottom, float top)
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (bottom == bottom_ && top == top_)
+    return;
+
+  bottom_ = bottom;
+  top_ = top;
+  std::fill(density_.begin(), density_.end(), 0);
+  ++generation_;
+}
+
+void Phosphor::setPalette(const Palette& palette)
+{
+  const std::vector<GlColor4>& colors = palette.getColors();
+  std::vector<unsigned char> lut(4*colors.size());
+  for (size_t i = 0; i < colors.size(); ++i) {
+    lut[4*i] = 255*colors[i].r;
+    lut[4*i + 1] = 255*colors[i].g;
+    lut[4*i + 2] = 255*colors[i].b;
+    lut[4*i + 3] = 255*colors[i].a;
+  }
+
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  lut_.swap(lut);
+}
+
+void Phosphor::addTrace(const float* data, size_t n, float offset, float span)
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (pending_.size() >= max_pending_)
+    return;
+
+  pending_.push_back(Trace());
+  Trace& trace = pending_.back();
+  trace.data.assign(data, data + n);
+  trace.offset = offset;
+  trace.span = span;
+
+  // start the worker the first time it is needed
+  if (!running_) {
+    running_ = true;
+    thread_ = boost::thread(&Phosphor::run_, this);
+  }
+  cond_.notify_one();
+}
+
+void Phosphor::clear()
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  pending_.clear();
+  std::fill(density_.begin(), density_.end(), 0);
+  ++generation_;
+}
+
+void Phosphor::stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+    cond_.notify_one();
+  }
+  thread_.join();
+}
+
+void Phosphor::render(float dt, std::vector<unsigned char>& pixels)
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  pixels.resize(4*width_*height_);
+  if (lut_.empty() || density_.empty()) {
+    std::fill(pixels.begin(), pixels.end(), 0);
+    return;
+  }
+
+  // logarithmic intensity scale, so that rare excursions remain visible
+  const size_t n_colors = lut_.size() / 4;
+  const float scale = (n_colors - 1) / std::log(1 + saturation_);
+  for (unsigned x = 0; x < width_; ++x) {
+    const float* column = &density_[x*height_];
+    for (unsigned y = 0; y < height_; ++y) {
+      size_t idx = 0;
+      if (column[y] > 0)
+        idx = std::min<size_t>(std::log(1 + column[y])*scale, n_colors - 1);
+      std::copy(&lut_[4*idx], &lut_[4*idx] + 4, &pixels[4*(y*width_ + x)]);
+    }
+  }
+
+  // let the phosphor fade
+  const float factor = (decay_ > 0)?std::exp(-dt/decay_):0;
+  const size_t n = density_.size();
+  float* p = &density_[0];
+  for (size_t i = 0; i < n; ++i)
+    p[i] *= factor;
+}
+
+unsigned long Phosphor::takeTraceCount()
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  const unsigned long res = traces_;
+  traces_ = 0;
+  return res;
+}
+
+/// Add one to the hit count of the pixels covered by the trace.
+static void rasterize(const std::vector<float>& data, float offset,
+  float span, unsigned width, unsigned height, float bottom, float top,
+  float* hits)
+{
+  const size_t n = data.size();
+  if (n < 2 || width == 0 || height == 0 || top == bottom)
+    return;
+
+  const double dt = span / width;
+  const float row_scale = height / (top - bottom);
+  for (unsigned x = 0; x < width; ++x) {
+    // use the samples on both sides of the column, so that neighboring
+    // columns join up
+    const double a = offset + x*dt;
+    const size_t ia = std::min<size_t>(std::max(std::floor(a), 0.0), n - 1);
+    const size_t ib = std::min<size_t>(std::max(std::floor(a + dt), 0.0),
+      n - 2) + 1;
+
+    const float* p = &data[ia];
+    const size_t count = (ib >= ia)?(ib - ia + 1):1;
+    const float mn = vectorMin(p, count, *p);
+    const float mx = vectorMax(p, count, *p);
+    if (mx < bottom || mn > top)
+      continue;
+
+    const int r0 = std::max<int>((mn - bottom)*row_scale, 0);
+    const int r1 = std::min<int>((mx - bottom)*row_scale, height - 1);
+    float* column = hits + x*height;
+    for (int r = r0; r <= r1; ++r)
+      column[r] += 1;
+  }
+}
+
+void Phosphor::run_()
+{
+  std::deque<Trace> batch;
+  std::vector<float> hits;
+  for (;;) {
+    unsigned width, height;
+    float bottom, top;
+    unsigned long generation;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (running_ && pending_.empty())
+        cond_.wait(lock);
+      if (!running_)
+        return;
+
+      batch.swap(pending_);
+      width = width_;
+      height = height_;
+      bottom = bottom_;
+      top = top_;
+      generation = generation_;
+    }
+
+    // rasterize without holding the lock, then add everything at once
+    hits.assign(width*height, 0);
+    for (std::deque<Trace>::const_iterator i = batch.begin();
+         i != batch.end();
+         ++i)
+    {
+      rasterize(i -> data, i -> offset, i -> span, width, height, bottom, top,
+        hits.empty()?0:&hits[0]);
+    }
+
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (generation == generation_ && density_.size() == hits.size()) {
+        const size_t n = hits.size();
+        float* p = density_.empty()?0:&density_[0];
+        for (size_t i = 0; i < n; ++i)
+          p[i] += hits[i];
+        traces_ += batch.size();
+      }
+    }
+    batch.clear();
+  }
+}
@@ -0,0 +1,125 @@
+/** @file phosphor.h
+ *  @brief Defines a hit-count density buffer that emulates the phosphor of an
+ *  analog oscilloscope.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef PHOSPHOR_H_
+#define PHOSPHOR_H_
+
+#include <deque>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include "glutils/palette.h"
+
+/** @brief Accumulate many traces into a density buffer, that fades with time.
+ *
+ *  Traces are queued with addTrace, and rasterized on a worker thread; the
+ *  thread starts with the first trace. Once per frame, render makes the
+ *  buffer decay and converts it to colors, using a logarithmic intensity
+ *  scale.
+ */
+class Phosphor : boost::noncopyable {
+ public:
+  /// Constructor.
+  Phosphor() : running_(false), max_pending_(256), width_(0), height_(0),
+    bottom_(-1), top_(1), decay_(0.2), saturation_(100), generation_(0),
+    traces_(0) {}
+
+  /// Destructor. Stops the worker thread.
+  ~Phosphor() { stop(); }
+
+  /// Set the size of the density buffer in pixels. This clears the buffer.
+  void setSize(unsigned width, unsigned height);
+
+  /// Get the width of the density buffer.
+  unsigned getWidth() const { return width_; }
+
+  /// Get the height of the density buffer.
+  unsigned getHeight() const { return height_; }
+
+  /// Set the range of values spanning the height of the buffer. This clears
+  /// the buffer if the range changes.
+  void setRange(float bottom, float top);
+
+  /// Set the time in which the intensity falls by a factor of @a e.
+  void setDecay(float tau) { decay_ = tau; }
+
+  /// Get the decay time.
+  float getDecay() const { return decay_; }
+
+  /// Set the number of hits that corresponds to the top of the palette.
+  void setSaturation(float hits) { saturation_ = (hits > 1)?hits:1; }
+
+  /// Get the number of hits corresponding to the top of the palette.
+  float getSaturation() const { return saturation_; }
+
+  /// Set the number of traces that can wait to be rasterized. Any others are
+  /// dropped.
+  void setMaxPending(size_t n) { max_pending_ = n; }
+
+  /// Set the palette used to render the buffer.
+  void setPalette(const Palette& palette);
+
+  /** @brief Queue a trace for rasterization.
+   *
+   *  The part of the trace covering sample positions [@a offset, @a offset +
+   *  @a span) is stretched over the width of the buffer. Samples up to
+   *  index @a offset + @a span (inclusive) should be available.
+   */
+  void addTrace(const float* data, size_t n, float offset, float span);
+
+  /// Clear the buffer and drop the pending traces.
+  void clear();
+
+  /// Stop the worker thread.
+  void stop();
+
+  /** @brief Convert the buffer to RGBA pixels, and let it decay for @a dt
+   *  seconds.
+   *
+   *  The pixels are stored row by row, starting with the bottom row.
+   */
+  void render(float dt, std::vector<unsigned char>& pixels);
+
+  /// Get the number of traces rasterized since the last call.
+  unsigned long takeTraceCount();
+
+ private:
+  struct Trace {
+    std::vector<float>  data;
+    float               offset;
+    float               span;
+  };
+
+  void run_();
+
+  boost::thread               thread_;
+  boost::mutex                mutex_;
+  boost::condition_variable   cond_;
+  bool                        running_;
+
+  std::deque<Trace>           pending_;
+  size_t                      max_pending_;
+
+  unsigned                    width_;
+  unsigned                    height_;
+  float                       bottom_;
+  float                       top_;
+  float                       decay_;
+  float                       saturation_;
+  /// Incremented every time the buffer is cleared, so that hits rasterized
+  /// with old settings are dropped.
+  unsigned long               generation_;
+  unsigned long               traces_;
+
+  /// Hit counts, stored column by column.
+  std::vector<float>          density_;
+  /// RGBA version of the palette.
+  std::vector<unsigned char>  lut_;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "display/rta_display.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "display/graph_program.h"
+#include "glutils/geometry.h"
+#include "glutils/gl_incs.h"
+#include "glutils/gl_state.h"
+#include "glutils/vbo.h"
+#include "processor/band_levels.h"
+#include "utils/logging.h"
+
+void RtaDisplay::draw()
+{
+  // update the state of the animations
+  animator_.update();
+  axes_.updateAnimations();
+  markDrawn_();
+
+  const std::vector<float>& levels = levels_.get();
+  const std::vector<OctaveBand>& bands = bands_.get();
+
+  GlState::disable(GL_TEXTURE_2D);
+
+  axes_.draw();
+
+  const Rectangle& r = axes_.getRange(true);
+
+  // with a graph program, the mapping to screen space is done on the GPU
+  if (graph_program_) {
+    graph_program_ -> use();
+    graph_program_ -> setAxes(axes_);
+  }
+
+  // all the bars go in one batch
+  std::vector<GlVertex2> points;
+  points.reserve(4*bands.size());
+  const float shrink = bar_gap_/2;
+  for (size_t i = 0; i < bands.size() && i < levels.size(); ++i) {
+    const float level = 10*std::log10(std::max(levels[i], 1e-20f));
+    if (level <= r.start.y)
+      continue;
+
+    // leave a gap on each side, evenly on the logarithmic axis
+    const float ratio = std::pow(bands[i].high/bands[i].low, shrink);
+    const float x0 = bands[i].low*ratio;
+    const float x1 = bands[i].high/ratio;
+
+    GlVertex2 corners[4] = { GlVertex2(x0, r.start.y),
+      GlVertex2(x1, r.start.y), GlVertex2(x1, level), GlVertex2(x0, level) };
+    for (unsigned j = 0; j < 4; ++j) {
+      if (graph_program_)
+        points.push_back(corners[j]);
+      else
+        points.push_back(axes_.graphToScreen(axes_.getClipped(corners[j])));
+    }
+  }
+
+  setGlColor(bar_color_);
+
+  // send the data to OpenGL
+  vbo_ -> draw(points, GL_QUADS);
+
+  if (graph_program_)
+    ShaderProgram::unuse();
+}
+
+bool RtaDisplay::handleEvent(SDL_Event* event)
+{
+  bool handled = false;
+  if (event -> type == SDL_KEYUP) {
+    bool no_mods = (event -> key.keysym.mod == 0);
+    switch (event -> key.keysym.sym) {
+      case SDLK_a:
+        if (no_mods) {
+          axes_.flipVisibility();
+          handled = true;
+        }
+        break;
+      case SDLK_g:
+        if (no_mods) {
+          axes_.flipGridVisibility();
+          handled = true;
+        }
+        break;
+      case SDLK_r:
+        if (no_mods) {
+          resetRange_();
+          handled = true;
+        }
+        break;
+      case SDLK_b:
+        // cycle through octave, third, sixth, and twelfth-octave bands
+        if (no_mods && band_levels_) {
+          const unsigned fraction = band_levels_ -> getFraction();
+          const unsigned next = (fraction >= 12)?1:((fraction < 3)?3:
+            (2*fraction));
+          band_levels_ -> setBands(next, band_levels_ -> getLow(),
+            band_levels_ -> getHigh());
+          handled = true;
+        }
+        break;
+      case SDLK_w:
+        // cycle through the Z, A, and C weightings
+        if (no_mods && band_levels_) {
+          const BandLevels::Weighting w = band_levels_ -> getWeighting();
+          band_levels_ -> setWeighting((w == BandLevels::Z_WEIGHTING)?
+            BandLevels::A_WEIGHTING:((w == BandLevels::A_WEIGHTING)?
+            BandLevels::C_WEIGHTING:BandLevels::Z_WEIGHTING));
+          logger::info << "Using "
+                       << BandLevels::getWeightingName(
+                            band_levels_ -> getWeighting())
+                       << " weighting." << std::endl;
+          handled = true;
+        }
+        break;
+      case SDLK_UP:
+        if (no_mods) {
+          Rectangle r = axes_.getRange();
+          r.start.y += 10;
+          r.end.y += 10;
+
+          axes_.setRange(r);
+          axes_.setClippingArea(r);
+          handled = true;
+        }
+       break;
+      case SDLK_DOWN:
+        if (no_mods) {
+          Rectangle r = axes_.getRange();
+          r.start.y -= 10;
+          r.end.y -= 10;
+
+          axes_.setRange(r);
+          axes_.setClippingArea(r);
+          handled = true;
+        }
+       break;
+      default:;
+    }
+  }
+
+  if (handled)
+    markDirty_();
+  return handled;
+}
+
+int RtaDisplay::init()
+{
+  int err = BaseSdlDisplay::init();
+  if (err)
+    return err;
+
+  bar_gap_ = properties_ -> get("bar_gap", bar_gap_);
+  bar_color_ = properties_ -> get("bar_color", GlColor4(0, 0.7, 0.7, 1));
+
+  // set up non-configurable properties of the axes
+  axes_.setType(Axes::BOX, "none");
+  axes_.setTickType(Axes::BOTH, "none");
+
+  // set up the configurable properties of the axes
+  axes_.setProperties(&properties_ -> get_child("axes"));
+  axes_.setClippingArea(axes_.getRange(), "none");
+  axes_.setExtents(Rectangle(w_/40, h_/40, 39*w_/40, 39*h_/40), "none");
+  axes_.setCrossing(GlVertex2(axes_.getRange().start.x,
+    axes_.getRange().start.y), "none");
+  axes_.setTickOriginLinearX(axes_.getRange().start.x, "none");
+  axes_.setTickOriginLinearY(axes_.getRange().start.y, "none");
+  axes_.setTickOriginLogX(axes_.getRange().start.x, "none");
+  axes_.setTickOriginLogY(axes_.getRange().start.y, "none");
+
+  // set up the transitions
+  axes_.setTransitionStore(transitions_);
+
+  // set up the VBO, unless we were given one; there are four vertices per
+  // band, and 1/12-octave bands over the audible range make about 120 bands
+  if (!vbo_) {
+    vbo_.reset(new Vbo(4*128*sizeof(GlVertex2), true));
+    vbo_ -> setAutoResize(true);
+  }
+
+  return 0;
+}
+
+void RtaDisplay::resize(float w, float h)
+{
+  BaseSdlDisplay::resize(w, h);
+  markDirty_();
+  axes_.setExtents(Rectangle(w_/40, h_/40, 39*w_/40, 39*h_/40), "none");
+}
+
+void RtaDisplay::updateProperties()
+{
+  properties_ -> put("bar_gap", bar_gap_);
+  properties_ -> put("bar_color", bar_color_);
+
+  // the band layout is set for this display, so it is saved with it
+  if (band_levels_) {
+    properties_ -> put("fraction", band_levels_ -> getFraction());
+    properties_ -> put("weighting",
+      BandLevels::getWeightingName(band_levels_ -> getWeighting()));
+  }
+
+  axes_.updateProperties();
+}
+
+void RtaDisplay::resetRange_()
+{
+  float low = 20;
+  float high = 20000;
+  if (band_levels_ && !band_levels_ -> getBands().empty()) {
+    low = band_levels_ -> getBands().front().low;
+    high = band_levels_ -> getBands().back().high;
+  }
+
+  Rectangle r(low, -100, high, 0);
+  axes_.setRange(r);
+  axes_.setClippingArea(r);
+}
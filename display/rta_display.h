@@ -0,0 +1,78 @@
+/** @file rta_display.h
+ *  @brief Define a real-time analyzer display, showing the levels in
+ *  fractional-octave bands as bars.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef RTA_DISPLAY_H_
+#define RTA_DISPLAY_H_
+
+#include <vector>
+
+#include "animation/animator.h"
+#include "display/axes.h"
+#include "display/base_sdl_display.h"
+#include "glutils/color.h"
+#include "processor/octave_bands.h"
+
+class BandLevels;
+
+/** @brief Real-time analyzer display.
+ *
+ *  This draws a bar for every band, from the "levels" and "bands" ports of
+ *  a @a BandLevels processor, on a logarithmic frequency axis, with the
+ *  levels in dB relative to a full-scale signal. All the bars are sent to
+ *  OpenGL in a single draw call.
+ *
+ *  If the display is given the processor with @a setBandLevels, the width
+ *  of the bands and the frequency weighting can be changed from the
+ *  keyboard.
+ */
+class RtaDisplay : public BaseSdlDisplay {
+ public:
+  RtaDisplay() : band_levels_(0), bar_gap_(0.15) {
+    registerInput_("levels", &levels_);
+    registerInput_("bands", &bands_);
+  }
+
+  /// Implement the draw function.
+  virtual void draw();
+
+  /// The display only changes with its inputs, its settings, and the axes.
+  virtual bool hasChanged() const {
+    return inputsChanged_() || animator_.hasAnimations() ||
+      axes_.hasAnimations();
+  }
+
+  /// Handle some events.
+  virtual bool handleEvent(SDL_Event* event);
+
+  /// Fit the axes to the new size.
+  virtual void resize(float w, float h);
+
+  /// Initialize the display.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+  /// Set the processor calculating the levels, so that its settings can be
+  /// changed from the keyboard.
+  void setBandLevels(BandLevels* band_levels) { band_levels_ = band_levels; }
+
+ private:
+  /// Reset the axes to show all the bands, from -100 to 0 dB.
+  void resetRange_();
+
+  InputPort<std::vector<float> >        levels_;
+  InputPort<std::vector<OctaveBand> >   bands_;
+
+  BandLevels*             band_levels_;
+  Animator                animator_;
+  Axes                    axes_;
+  /// Fraction of each band left empty between the bars.
+  float                   bar_gap_;
+  GlColor4                bar_color_;
+};
+
+#endif
@@ -4,12 +4,15 @@
 #include <complex>
 
 #include "animation/standard_easing.h"
+#include "display/graph_program.h"
 #include "glutils/color.h"
 #include "glutils/geometry.h"
+#include "glutils/gl_state.h"
 #include "glutils/vbo.h"
 #include "input/base_input.h"
 #include "processor/fft.h"
 #include "processor/grabber.h"
+#include "processor/zoom_fft.h"
 #include "glutils/gl_incs.h"
 #include "utils/logging.h"
 
@@ -18,17 +21,15 @@ void SpectralEnvelope::draw()
   // update the state of the animations
   animator_.update();
   axes_.updateAnimations();
+  markDrawn_();
 
   // get the data from the fft module
-  FftProcessor::Output fft_output = boost::any_cast<FftProcessor::Output>
-    (inputs_["fft"] -> getOutput());
+  const FftProcessor::OutputStruct& fft_output = fft_.get();
 
-  const Complex* data = fft_output -> fft;
+  const Complex* data = fft_output.fft;
+  const unsigned n_bins = fft_output.n_bins;
 
-  unsigned sz = fft_output -> size;
-  unsigned sz2 = sz / 2;
-
-  glDisable(GL_TEXTURE_2D);
+  GlState::disable(GL_TEXTURE_2D);
 
   axes_.draw();
 
@@ -36,15 +37,32 @@ void SpectralEnvelope::draw()
   std::vector<GlVertex2> points;
 
   unsigned n = n_points_;
-  if (n > sz2) // no point in drawing more points than we have
-    n = sz2;
+  if (n > n_bins) // no point in drawing more points than we have
+    n = n_bins;
 
-  Grabber::Details raw_details = boost::any_cast<Grabber::Details>
-    (inputs_["raw"] -> getDetails());
+  const Grabber::DetailsStruct& raw_details = details_.get();
 
-  float min_freq = (float)(raw_details -> samplingFrequency) / sz;
+  // the bins don't have to start at zero frequency
+  const float rate = raw_details.samplingFrequency;
+  const float first_freq = rate*fft_output.start;
+  const float bin_width = rate*fft_output.step;
   const Rectangle& range = axes_.getRange();
 
+  // ask for one bin per point over the visible band, starting with the next
+  // cycle
+  if (zoom_ && n_points_ > 1) {
+    zoom_ -> setBand(range.start.x, range.end.x,
+      (range.end.x - range.start.x)/(n_points_ - 1));
+  }
+  if (n < 2 || bin_width <= 0)
+    return;
+
+  // with a graph program, the mapping to screen space is done on the GPU
+  if (graph_program_) {
+    graph_program_ -> use();
+    graph_program_ -> setAxes(axes_);
+  }
+
   if (fill_) {
     Rectangle r = axes_.getRange(true);
     
@@ -52,18 +70,24 @@ void SpectralEnvelope::draw()
     for (unsigned i = 0; i < n; ++i) {
       // XXX this needs to be smarter
       float freq = range.start.x+(range.end.x - range.start.x)*(float)i/(n - 1);
-      if (freq < min_freq)
+      const float pos = (freq - first_freq)/bin_width + 0.5;
+      if (pos < 0)
         continue;
 
-      unsigned idx = (freq - min_freq) / min_freq;
-      if (idx >= sz2)
+      unsigned idx = pos;
+      if (idx >= n_bins)
         continue;
 
       GlVertex2 p(freq, std::abs(data[idx]));
       GlVertex2 p_2(freq, r.start.y);
 
-      points.push_back(axes_.graphToScreen(axes_.getClipped(p_2)));
-      points.push_back(axes_.graphToScreen(axes_.getClipped(p)));
+      if (graph_program_) {
+        points.push_back(p_2);
+        points.push_back(p);
+      } else {
+        points.push_back(axes_.graphToScreen(axes_.getClipped(p_2)));
+        points.push_back(axes_.graphToScreen(axes_.getClipped(p)));
+      }
     }
 
     setGlColor(fill_color_);
@@ -76,20 +100,27 @@ void SpectralEnvelope::draw()
   for (unsigned i = 0; i < n; ++i) {
     // XXX this needs to be smarter
     float freq = range.start.x + (range.end.x - range.start.x)*(float)i/(n - 1);
-    if (freq < min_freq)
+    const float pos = (freq - first_freq)/bin_width + 0.5;
+    if (pos < 0)
       continue;
 
-    unsigned idx = (freq - min_freq) / min_freq;
-    if (idx >= sz2)
+    unsigned idx = pos;
+    if (idx >= n_bins)
       continue;
 
     GlVertex2 p(freq, std::abs(data[idx]));
 
-    points.push_back(axes_.graphToScreen(axes_.getClipped(p)));
+    if (graph_program_)
+      points.push_back(p);
+    else
+      points.push_back(axes_.graphToScreen(axes_.getClipped(p)));
   }
 
   // send the data to OpenGL
   vbo_ -> draw(points, GL_LINE_STRIP);
+
+  if (graph_program_)
+    ShaderProgram::unuse();
 }
 
 bool SpectralEnvelope::handleEvent(SDL_Event* event)
@@ -233,6 +264,8 @@ bool SpectralEnvelope::handleEvent(SDL_Event* event)
     }
   }
 
+  if (handled)
+    markDirty_();
   return handled;
 }
 
@@ -268,13 +301,22 @@ int SpectralEnvelope::init()
   // set up the transitions
   axes_.setTransitionStore(transitions_);
 
-  // set up the VBO
-  const size_t vbo_size = 4*n_points_*sizeof(GlVertex2);
-  vbo_.reset(new Vbo(vbo_size));
+  // set up the VBO, unless we were given one
+  if (!vbo_) {
+    const size_t vbo_size = 4*n_points_*sizeof(GlVertex2);
+    vbo_.reset(new Vbo(vbo_size, true));
+  }
 
   return 0;
 }
 
+void SpectralEnvelope::resize(float w, float h)
+{
+  BaseSdlDisplay::resize(w, h);
+  markDirty_();
+  axes_.setExtents(Rectangle(w_/40, h_/40, 39*w_/40, 39*h_/40), "none");
+}
+
 void SpectralEnvelope::done()
 {
 }
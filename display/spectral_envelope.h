@@ -12,19 +12,39 @@
 #include "display/axes.h"
 #include "display/base_sdl_display.h"
 #include "glutils/gl_incs.h"
+#include "processor/fft.h"
+#include "processor/grabber.h"
 #include "utils/misc.h"
 
-/// Spectral envelope display.
+class ZoomFft;
+
+/** @brief Spectral envelope display.
+ *
+ *  If the spectrum comes from a @a ZoomFft, the display tells it which band
+ *  is visible, so that the resolution follows the zoom level.
+ */
 class SpectralEnvelope : public BaseSdlDisplay {
  public:
-  SpectralEnvelope() : n_points_(500) {}
+  SpectralEnvelope() : n_points_(500), zoom_(0) {
+    registerInput_("fft", &fft_);
+    registerInput_("details", &details_);
+  }
 
   /// Implement the draw function.
   virtual void draw();
 
+  /// The display only changes with its inputs, its settings, and the axes.
+  virtual bool hasChanged() const {
+    return inputsChanged_() || animator_.hasAnimations() ||
+      axes_.hasAnimations();
+  }
+
   /// Handle some events.
   virtual bool handleEvent(SDL_Event* event);
 
+  /// Fit the axes to the new size.
+  virtual void resize(float w, float h);
+
   /// Initialize the spectral envelope display.
   virtual int init();
   /// Clean up.
@@ -33,8 +53,16 @@ class SpectralEnvelope : public BaseSdlDisplay {
   /// Update the settings.
   virtual void updateProperties();
 
+  /// Set the processor that calculates the spectrum for the visible band;
+  /// null if the spectrum doesn't depend on what is visible.
+  void setZoomFft(ZoomFft* zoom) { zoom_ = zoom; }
+
  private:
+  InputPort<FftProcessor::OutputStruct>   fft_;
+  InputPort<Grabber::DetailsStruct>       details_;
+
   unsigned                n_points_;
+  ZoomFft*                zoom_;
   Animator                animator_;
   Axes                    axes_;
   bool                    fill_;
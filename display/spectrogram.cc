@@ -3,10 +3,10 @@
 #include <algorithm>
 #include <complex>
 
-#include <boost/lexical_cast.hpp>
-
 #include "animation/standard_easing.h"
+#include "glutils/fbo_pool.h"
 #include "glutils/geometry.h"
+#include "glutils/gl_state.h"
 #include "input/base_input.h"
 #include "processor/fft.h"
 #include "processor/grabber.h"
@@ -14,83 +14,156 @@
 #include "utils/logging.h"
 #include "utils/misc.h"
 
-void Spectrogram::draw()
-{
-  // update the state of animations
-  animator_.update();
-  axes_.updateAnimations();
+namespace {
 
-  // scroll the screen
-  scroll_();
+/** @brief Find the band whose center is nearest to @a freq, on a
+ *  logarithmic scale.
+ *
+ *  Returns -1 if @a freq is more than half a band outside the range of the
+ *  centers.
+ */
+int findBand(const std::vector<float>& centers, float freq)
+{
+  const size_t n = centers.size();
+  if (n == 0 || freq <= 0)
+    return -1;
+  if (n == 1)
+    return 0;
+
+  if (freq*freq < centers[0]*centers[0]*centers[0]/centers[1] ||
+      freq*freq > centers[n - 1]*centers[n - 1]*centers[n - 1]/centers[n - 2])
+  {
+    return -1;
+  }
 
-  // draw in the correct FBO
-  Fbo::push();
-  fbos_[crt_fbo_] -> bind();
+  const size_t i = std::lower_bound(centers.begin(), centers.end(), freq) -
+    centers.begin();
+  if (i == 0)
+    return 0;
+  if (i == n)
+    return n - 1;
+  return (freq*freq < centers[i - 1]*centers[i])?(i - 1):i;
+}
 
-  // get the data from the fft module
-  FftProcessor::Output fft_output = boost::any_cast<FftProcessor::Output>
-    (inputs_["fft"] -> getOutput());
+} // anonymous namespace
 
-  const Complex* data = fft_output -> fft;
+void Spectrogram::accumulate()
+{
+  // get the raw data
+  const std::vector<float>& data = raw_.get();
+  const Grabber::DetailsStruct& raw_details = details_.get();
+
+  const unsigned sz = data.size();
+  const unsigned size = (fft_size_ > 0)?fft_size_:sz;
+  const float rate = raw_details.samplingFrequency;
+  const unsigned long long end = raw_details.end;
+
+  // columns are added at fixed intervals in sample time, independent of the
+  // frame rate
+  const unsigned hop = std::max((unsigned)(column_time_*rate + 0.5), 1u);
+  const unsigned max_columns = w_/shift_ + 1;
+
+  // keep enough history to fill the whole screen, in case we fall behind
+  const size_t capacity = std::max(size, sz) + max_columns*hop;
+  if (rate != history_rate_ || history_.getCapacity() < capacity) {
+    history_.setCapacity(capacity);
+    history_rate_ = rate;
+  }
+  history_.appendWindow(&data[0], sz, end);
+  if (use_filter_bank_) {
+    filter_bank_.setHistoryLength(max_columns*hop);
+    filter_bank_.append(&data[0], sz, end, rate);
+  }
 
-  unsigned sz = fft_output -> size;
-  int sz2 = sz / 2;
+  // restart if this is the first frame, or if the input was switched
+  if (next_column_ == 0 || end + hop < next_column_)
+    next_column_ = end;
+
+  // a new export starts with the columns that are still in the history
+  if (export_backfill_ && !use_filter_bank_) {
+    export_backfill_ = false;
+    unsigned long long first = next_column_;
+    while (first >= hop && first - hop >= history_.getBegin() + size)
+      first -= hop;
+
+    std::vector<float> magnitudes;
+    for (unsigned long long e = first; e < next_column_; e += hop) {
+      calculateColumn_(e, hop, size, magnitudes);
+      export_.addColumn(e, hop, size, rate, magnitudes);
+    }
+  }
 
-  glDisable(GL_TEXTURE_2D);
+  unsigned n_columns = 0;
+  if (next_column_ <= end)
+    n_columns = (end - next_column_)/hop + 1;
+  // columns that would scroll off the screen straight away are skipped
+  if (n_columns > max_columns) {
+    next_column_ += (unsigned long long)(n_columns - max_columns)*hop;
+    n_columns = max_columns;
+  }
 
-  // make a buffer to send to the VBO
-  std::vector<GlColoredVertex2> points;
+  // calculate the new columns; they are drawn the next time the display is
+  // visible
+  for (unsigned i = 0; i < n_columns; ++i) {
+    pending_.push_back(Column());
+    Column& column = pending_.back();
+    calculateColumn_(next_column_, hop, size, column.magnitudes);
+    column.min_freq = rate / size;
+    // the export has one row per FFT bin, so it skips the filter bank's
+    // columns
+    if (use_filter_bank_)
+      column.frequencies = filter_bank_.getFrequencies();
+    else
+      export_.addColumn(next_column_, hop, size, rate, column.magnitudes);
+    next_column_ += hop;
+  }
+  while (pending_.size() > max_columns)
+    pending_.pop_front();
+}
 
-  const Rectangle& extents = axes_.getExtents(true);
+void Spectrogram::draw()
+{
+  // update the state of animations
+  animator_.update();
+  axes_.updateAnimations();
 
-  Grabber::Details raw_details = boost::any_cast<Grabber::Details>
-    (inputs_["raw"] -> getDetails());
+  // scroll the screen to make room for the columns calculated since the
+  // last time we were drawn
+  const unsigned n_columns = pending_.size();
+  if (n_columns > 0)
+    scroll_(n_columns*shift_);
 
-  float min_freq = (float)(raw_details -> samplingFrequency) / sz;
-  for (unsigned i = extents.start.x; i < extents.end.x; ++i) {
-    const float freq = axes_.screenToGraph(GlVertex2(i, extents.start.y)).x;
-    
-    int idx = (freq - min_freq) / min_freq;
-    GlColor4 color(0, 0, 0);
-    if (idx >= 0 || idx < sz2) {
-      const float amplitude = std::abs(data[idx]);
-      GlVertex2 p = axes_.graphToScreen(GlVertex2(freq, amplitude));
-      color = getColor_(p.y);
-    }
-
-    GlColoredVertex2 vertex1(w_ - shift_, i, color);
-    GlColoredVertex2 vertex2(w_, i, color);
-    GlColoredVertex2 vertex3(w_, i + 1, color);
-    GlColoredVertex2 vertex4(w_ - shift_, i + 1, color);
+  // draw in the correct FBO
+  Fbo::push();
+  fbos_[crt_fbo_] -> bind();
 
-    points.push_back(vertex1);
-    points.push_back(vertex2);
-    points.push_back(vertex3);
-    points.push_back(vertex4);
-  }
+  GlState::disable(GL_TEXTURE_2D);
 
-  vbo_ -> draw(points, GL_QUADS);
+  for (unsigned i = 0; i < n_columns; ++i)
+    drawColumn_(w_ - (n_columns - i)*shift_, pending_[i]);
+  pending_.clear();
 
   // go back to the display FBO, and transfer it to screen
   Fbo::pop();
 
   glClear(GL_COLOR_BUFFER_BIT);
-  glEnable(GL_TEXTURE_2D);
+  GlState::enable(GL_TEXTURE_2D);
   fbos_[crt_fbo_] -> getTexture() -> bind();
   setGlColor(GlColor4(1, 1, 1));
 
+  const GlVertex2 corner = getTexCorner_();
   std::vector<GlVertexTex2> points_tex;
   points_tex.push_back(GlVertexTex2(0, 0, 0, 0));
-  points_tex.push_back(GlVertexTex2(w_, 0, 1, 0));
-  points_tex.push_back(GlVertexTex2(w_, h_, 1, 1));
-  points_tex.push_back(GlVertexTex2(0, h_, 0, 1));
+  points_tex.push_back(GlVertexTex2(w_, 0, corner.x, 0));
+  points_tex.push_back(GlVertexTex2(w_, h_, corner.x, corner.y));
+  points_tex.push_back(GlVertexTex2(0, h_, 0, corner.y));
 
   // select the texture
   glClientActiveTexture(GL_TEXTURE0);
 
   // send the data to OpenGL
   vbo_ -> draw(points_tex, GL_QUADS);
-  glDisable(GL_TEXTURE_2D);
+  GlState::disable(GL_TEXTURE_2D);
 }
 
 bool Spectrogram::handleEvent(SDL_Event* event)
@@ -128,6 +201,27 @@ bool Spectrogram::handleEvent(SDL_Event* event)
           handled = true;
         }
         break;
+      case SDLK_x:
+        if (no_mods) {
+          flipExport();
+          handled = true;
+        }
+        break;
+      case SDLK_b:
+        if (no_mods) {
+          use_filter_bank_ = !use_filter_bank_;
+          if (use_filter_bank_) {
+            logger::info << "Spectrogram rows follow the "
+                         << FilterBank::getScaleName(
+                              filter_bank_.getScale())
+                         << " filter bank." << std::endl;
+          } else {
+            logger::info << "Spectrogram rows follow the FFT bins."
+                         << std::endl;
+          }
+          handled = true;
+        }
+        break;
       case SDLK_EQUALS:
         if (just_shift) {
           // XXX make configurable zoom factor
@@ -230,6 +324,28 @@ int Spectrogram::init()
   // set up the palette
   makePalette(properties_ -> get<std::string>("palette"));
 
+  // set up the time scale
+  column_time_ = properties_ -> get("column_time", column_time_);
+  pool_ = properties_ -> get("pool", pool_);
+  fft_size_ = properties_ -> get("fft_size", fft_size_);
+
+  // set up the filter bank
+  use_filter_bank_ = properties_ -> get("filterbank.enabled",
+    use_filter_bank_);
+  boost::optional<Properties&> filter_bank =
+    properties_ -> get_child_optional("filterbank");
+  if (filter_bank) {
+    filter_bank_.setProperties(&(*filter_bank));
+    filter_bank_.init();
+  }
+
+  // set up the export
+  export_.setPath(properties_ -> get("export.path", export_.getPath()));
+  export_.setTileWidth(properties_ -> get("export.tile_width",
+    export_.getTileWidth()));
+  export_.setThreads(properties_ -> get("export.threads",
+    export_.getThreads()));
+
   // set up non-configurable properties of the axes
   axes_.setVisibility(false, "none");
 
@@ -241,75 +357,215 @@ int Spectrogram::init()
   // set up the transitions
   axes_.setTransitionStore(transitions_);
 
-  // set up the VBO
-  const size_t vbo_size = 4*2048*sizeof(GlVertexTex2);
-  vbo_.reset(new Vbo(vbo_size));
-
-  // set up the FBOs
-  // XXX not sure this is the proper size...
-  for (int i = 0; i < 2; ++i) {
-    fbos_[i].reset(new Fbo(w_, h_));
-    glClear(GL_COLOR_BUFFER_BIT);
+  // set up the VBO, unless we were given one
+  if (!vbo_) {
+    const size_t vbo_size = 4*2048*sizeof(GlColoredVertex2);
+    vbo_.reset(new Vbo(vbo_size, true));
   }
 
+  // set up the FBOs, unless we were given a pool to get them from
+  if (!fbo_pool_)
+    fbo_pool_.reset(new FboPool);
+  for (int i = 0; i < 2; ++i)
+    fbos_[i] = fbo_pool_ -> acquire(w_, h_);
+
   return 0;
 }
 
-void Spectrogram::done()
+void Spectrogram::resize(float w, float h)
 {
-}
+  const bool changed = (w != w_ || h != h_);
 
-void Spectrogram::updateProperties()
-{
-  axes_.updateProperties();
+  // the part of the old texture that was used depends on the old size
+  const GlVertex2 corner = fbos_[0]?getTexCorner_():GlVertex2(0, 0);
+  BaseSdlDisplay::resize(w, h);
+  axes_.setExtents(Rectangle(0, 0, h_, 1), "none");
+
+  // nothing else to do before init
+  if (!fbos_[0] || !changed)
+    return;
+
+  // keep the columns drawn so far, stretched to the new size
+  FboPool::FboPtr old_fbos[2] = { fbos_[0], fbos_[1] };
+  for (int i = 0; i < 2; ++i)
+    fbos_[i] = fbo_pool_ -> acquire(w_, h_);
+
+  Fbo::push();
+  fbos_[crt_fbo_] -> bind();
+  glPushAttrib(GL_VIEWPORT_BIT);
+  glViewport(0, 0, w_, h_);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  gluOrtho2D(0, w_, 0, h_);
+  glMatrixMode(GL_MODELVIEW);
+
+  GlState::enable(GL_TEXTURE_2D);
+  old_fbos[crt_fbo_] -> getTexture() -> bind();
+  setGlColor(GlColor4(1, 1, 1));
+
+  std::vector<GlVertexTex2> points_tex;
+  points_tex.push_back(GlVertexTex2(0, 0, 0, 0));
+  points_tex.push_back(GlVertexTex2(w_, 0, corner.x, 0));
+  points_tex.push_back(GlVertexTex2(w_, h_, corner.x, corner.y));
+  points_tex.push_back(GlVertexTex2(0, h_, 0, corner.y));
+
+  glClientActiveTexture(GL_TEXTURE0);
+  vbo_ -> draw(points_tex, GL_QUADS);
+  GlState::disable(GL_TEXTURE_2D);
+
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+  Fbo::pop();
+
+  for (int i = 0; i < 2; ++i)
+    fbo_pool_ -> release(old_fbos[i]);
 }
 
-GlColor4 Spectrogram::getColor_(float a)
+void Spectrogram::done()
 {
-  if (a < 0)
-    a = 0;
-  if (a > 1)
-    a = 1;
+  export_.stop();
 
-  unsigned sz = palette_.size();
-  unsigned idx = a*sz;
-  if (idx >= sz)
-    idx = sz - 1;
+  for (int i = 0; i < 2; ++i) {
+    if (fbo_pool_)
+      fbo_pool_ -> release(fbos_[i]);
+    fbos_[i].reset();
+  }
+}
 
-  return palette_[idx];
+void Spectrogram::updateProperties()
+{
+  properties_ -> put("column_time", column_time_);
+  properties_ -> put("pool", pool_);
+  properties_ -> put("fft_size", fft_size_);
+  properties_ -> put("filterbank.enabled", use_filter_bank_);
+  filter_bank_.updateProperties();
+  properties_ -> put("export.path", export_.getPath());
+  properties_ -> put("export.tile_width", export_.getTileWidth());
+  properties_ -> put("export.threads", export_.getThreads());
+  axes_.updateProperties();
 }
 
-void Spectrogram::scroll_()
+void Spectrogram::scroll_(unsigned pixels)
 {
   Fbo::push();
 
   int old_fbo_ = crt_fbo_;
   crt_fbo_ = (1 - crt_fbo_);
 
-  glEnable(GL_TEXTURE_2D);
+  GlState::enable(GL_TEXTURE_2D);
   fbos_[crt_fbo_] -> bind();
   fbos_[old_fbo_] -> getTexture() -> bind();
   setGlColor(GlColor4(1, 1, 1));
 
   // fill the VBO
-  float shift_tex = (float)(shift_) / w_;
+  const GlVertex2 corner = getTexCorner_();
+  float shift_tex = corner.x * pixels / w_;
 
   std::vector<GlVertexTex2> points_tex;
   points_tex.push_back(GlVertexTex2(0, 0, shift_tex, 0));
-  points_tex.push_back(GlVertexTex2(w_ - shift_, 0, 1, 0));
-  points_tex.push_back(GlVertexTex2(w_ - shift_, h_, 1, 1));
-  points_tex.push_back(GlVertexTex2(0, h_, shift_tex, 1));
+  points_tex.push_back(GlVertexTex2(w_ - pixels, 0, corner.x, 0));
+  points_tex.push_back(GlVertexTex2(w_ - pixels, h_, corner.x, corner.y));
+  points_tex.push_back(GlVertexTex2(0, h_, shift_tex, corner.y));
 
   // select the texture
   glClientActiveTexture(GL_TEXTURE0);
 
   // send the data to OpenGL
   vbo_ -> draw(points_tex, GL_QUADS);
-  glDisable(GL_TEXTURE_2D);
+  GlState::disable(GL_TEXTURE_2D);
 
   Fbo::pop();
 }
 
+void Spectrogram::calculateColumn_(unsigned long long end, unsigned hop,
+    unsigned size, std::vector<float>& magnitudes)
+{
+  const unsigned pool = std::max(std::min(pool_, hop), 1u);
+  if (use_filter_bank_) {
+    magnitudes.assign(filter_bank_.getBandCount(), 0);
+    for (unsigned j = 0; j < pool; ++j) {
+      filter_bank_.calculate(end - (unsigned long long)j*hop/pool, bands_);
+      for (size_t i = 0; i < magnitudes.size(); ++i)
+        magnitudes[i] = std::max(magnitudes[i], bands_[i]);
+    }
+    return;
+  }
+
+  if (fft_.getSize() != size) {
+    fft_.setSize(size);
+    fft_.init();
+  }
+  magnitudes.assign(size/2 + 1, 0);
+
+  const std::vector<float>* window = 0;
+  if (window_function_)
+    window = &window_function_ -> getWindow(size);
+
+  // max-pool the FFTs ending at equally spaced points within the column
+  for (unsigned j = 0; j < pool; ++j) {
+    const unsigned long long fft_end = end - (unsigned long long)j*hop/pool;
+    float* buffer = fft_.getBuffer();
+    if (fft_end < size || !history_.copy(fft_end - size, size, buffer))
+      continue;
+
+    if (window) {
+      for (unsigned i = 0; i < size; ++i)
+        buffer[i] *= (*window)[i];
+    }
+    fft_.exec();
+
+    const Complex* out = fft_.getOutput();
+    for (size_t i = 0; i < magnitudes.size(); ++i)
+      magnitudes[i] = std::max(magnitudes[i], std::abs(out[i]));
+  }
+}
+
+void Spectrogram::drawColumn_(unsigned x, const Column& column)
+{
+  const std::vector<float>& magnitudes = column.magnitudes;
+  const float min_freq = column.min_freq;
+  const std::vector<float>* frequencies = column.frequencies.get();
+
+  // make a buffer to send to the VBO
+  std::vector<GlColoredVertex2> points;
+
+  const Rectangle& extents = axes_.getExtents(true);
+  const int n_bins = magnitudes.size();
+  for (unsigned i = extents.start.x; i < extents.end.x; ++i) {
+    const float freq = axes_.screenToGraph(GlVertex2(i, extents.start.y)).x;
+
+    int idx = frequencies?findBand(*frequencies, freq):
+      (int)((freq - min_freq) / min_freq);
+    GlColor4 color(0, 0, 0);
+    if (idx >= 0 && idx < n_bins) {
+      const float amplitude = magnitudes[idx];
+      GlVertex2 p = axes_.graphToScreen(GlVertex2(freq, amplitude));
+      color = palette_.getColor(p.y);
+    }
+
+    GlColoredVertex2 vertex1(x, i, color);
+    GlColoredVertex2 vertex2(x + shift_, i, color);
+    GlColoredVertex2 vertex3(x + shift_, i + 1, color);
+    GlColoredVertex2 vertex4(x, i + 1, color);
+
+    points.push_back(vertex1);
+    points.push_back(vertex2);
+    points.push_back(vertex3);
+    points.push_back(vertex4);
+  }
+
+  vbo_ -> draw(points, GL_QUADS);
+}
+
+GlVertex2 Spectrogram::getTexCorner_() const
+{
+  const Fbo::TextureConstSharedPtr tex = fbos_[crt_fbo_] -> getTexture();
+  return GlVertex2(w_ / tex -> getWidth(), h_ / tex -> getHeight());
+}
+
 void Spectrogram::resetAxes()
 {
   // XXX get size from sampling frequency
@@ -321,122 +577,25 @@ void Spectrogram::resetAxes()
 
 void Spectrogram::makePalette(const std::string& s)
 {
-  if (s == "grayscale")
-    makePalette_("rgb 0:(0,0,0,1) 1:(1,1,1,1)");
-  else if (s == "thermal")
-    makePalette_("hls 0:(1,0,0.3,1) 0.9:(0,0.6,1,1) 1:(0,1,0,1)");
-  else
-    makePalette_(s);
+  palette_.set(s);
 }
 
-static GlColor4 hlsToRgb(const GlColor4& col)
+void Spectrogram::flipExport()
 {
-  float hue = col.r;
-  float lum = col.g;
-  float sat = col.b;
-
-  GlColor4 res;
-  res.a = col.a;
-
-  if (hue < 1.0/6) {
-    res.r = 1;
-    res.g = hue*6;
-    res.b = 0;
-  } else if (hue < 2.0/6) {
-    res.r = (2.0/6 - hue)*6;
-    res.g = 1;
-    res.b = 0;
-  } else if (hue < 3.0/6) {
-    res.r = 0;
-    res.g = 1;
-    res.b = (hue - 2.0/6)*6;
-  } else if (hue < 4.0/6) {
-    res.r = 0;
-    res.g = (4.0/6 - hue)*6;
-    res.b = 1;
-  } else if (hue < 5.0/6) {
-    res.r = (hue - 4.0/6)*6;
-    res.g = 0;
-    res.b = 1;
-  } else {
-    res.r = 1;
-    res.g = 0;
-    res.b = (1 - hue)*6;
+  if (export_.isRunning()) {
+    export_.stop();
+    return;
   }
 
-  float min = 0.5 - sat/2;
-  float max = 0.5 + sat/2;
-
-  res.r = min + res.r*(max - min);
-  res.g = min + res.g*(max - min);
-  res.b = min + res.b*(max - min);
-
-  if (lum <= 0.5) {
-    float f = 2*lum;
-    res.r = res.r*f;
-    res.g = res.g*f;
-    res.b = res.b*f;
-  } else {
-    float f = 2*lum - 1;
-    res.r = res.r + (1 - res.r)*f;
-    res.g = res.g + (1 - res.g)*f;
-    res.b = res.b + (1 - res.b)*f;
+  if (use_filter_bank_) {
+    logger::info << "The export has one row per FFT bin; switch off the "
+                 << "filter bank to start it." << std::endl;
+    return;
   }
 
-  return res;
-}
-
-void Spectrogram::makePalette_(const std::string& s)
-{
-  if (s.length() < 4)
-    throw Exception("Bad palette string: " + s);
-
-  std::string type = s.substr(0, 3);
-  if (type != "hls" && type != "rgb")
-    throw Exception("Bad palette string: " + s);
-
-  std::vector<std::string> points = splitString(s.substr(4));
-  const size_t n_points = points.size();
-
-  const size_t n = 256;
-  palette_.resize(n, GlColor4(0, 0, 0));
-
-  if (n_points > 0) {
-    for (size_t i = 0; i < n_points - 1; ++i) {
-      std::string s1 = points[i];
-      std::string s2 = points[i + 1];
-
-      size_t p1 = s1.find(':');
-      size_t p2 = s2.find(':');
-      if (p1 == std::string::npos || p2 == std::string::npos)
-        continue;
-
-      size_t idx1 = boost::lexical_cast<float>(s1.substr(0, p1))*n;
-      size_t idx2 = boost::lexical_cast<float>(s2.substr(0, p2))*n;
-
-      std::string scol1 = s1.substr(p1 + 1);
-      std::string scol2 = s2.substr(p2 + 1);
-      if (scol1.length() < 3 || scol1[0] != '(' ||
-          scol1[scol1.length() - 1] != ')')
-        throw Exception("Bad palette string: " + s);
-      if (scol2.length() < 3 || scol2[0] != '(' ||
-          scol2[scol2.length() - 1] != ')')
-        throw Exception("Bad palette string: " + s);
-
-      scol1 = scol1.substr(1, scol1.length() - 2);
-      scol2 = scol2.substr(1, scol2.length() - 2);
-      GlColor4 col1 = boost::lexical_cast<GlColor4>(scol1);
-      GlColor4 col2 = boost::lexical_cast<GlColor4>(scol2);
-
-      for (size_t j = idx1; j < idx2; ++j) {
-        float alpha = (float)(j - idx1) / (idx2 - idx1);
-        GlColor4 col = (1 - alpha)*col1 + alpha*col2;
-
-        if (type == "hls")
-          col = hlsToRgb(col);
-
-        palette_[j] = col;
-      }
-    }
-  }
+  const Rectangle& range = axes_.getRange();
+  export_.setColorMap(palette_, axes_.getScalingY() == Axes::LOG,
+    range.start.y, range.end.y);
+  if (export_.start())
+    export_backfill_ = true;
 }
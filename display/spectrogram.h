@@ -6,29 +6,59 @@
 #ifndef SPECTROGRAM_H_
 #define SPECTROGRAM_H_
 
+#include <deque>
 #include <vector>
 
-#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "animation/animator.h"
 #include "display/axes.h"
 #include "display/base_sdl_display.h"
+#include "display/spectrogram_export.h"
 #include "glutils/color.h"
 #include "glutils/fbo.h"
+#include "glutils/fbo_pool.h"
 #include "glutils/gl_incs.h"
+#include "glutils/palette.h"
 #include "glutils/vbo.h"
+#include "processor/fftwrapper.h"
+#include "processor/filter_bank.h"
+#include "processor/grabber.h"
+#include "processor/sample_history.h"
+#include "processor/window_functions.h"
 
-/// Spectrogram display.
+/** @brief Spectrogram display.
+ *
+ *  The rows normally follow the bins of an FFT. With the filter bank turned
+ *  on, they are bands on a mel or a constant-Q scale instead, calculated by
+ *  a @a FilterBank that is fed the same samples.
+ */
 class Spectrogram : public BaseSdlDisplay {
  public:
-  Spectrogram() : crt_fbo_(0), shift_(2) {}
+  Spectrogram() : crt_fbo_(0), shift_(2), column_time_(1.0/60), pool_(1),
+    window_function_(0), fft_size_(0), use_filter_bank_(false),
+    history_rate_(0), next_column_(0), export_backfill_(false)
+  {
+    registerInput_("raw", &raw_);
+    registerInput_("details", &details_);
+  }
 
   /// Implement the draw function.
   virtual void draw();
 
+  /// Calculate the columns that came due since the last cycle.
+  virtual void accumulate();
+
+  /// The spectrogram only changes when there are new columns to draw.
+  virtual bool hasChanged() const
+    { return !pending_.empty() || animator_.hasAnimations(); }
+
   /// Handle some events.
   virtual bool handleEvent(SDL_Event* event);
 
+  /// Resize the FBOs, stretching the columns drawn so far to the new size.
+  virtual void resize(float w, float h);
+
   /// Initialize the spectrogram display.
   virtual int init();
   /// Clean up.
@@ -43,18 +73,98 @@ class Spectrogram : public BaseSdlDisplay {
   /// Generate the palette.
   void makePalette(const std::string& s);
 
+  /** @brief Start or stop exporting the spectrogram to disk, at full
+   *  resolution.
+   *
+   *  The export starts with the columns that can still be calculated from
+   *  the sample history, and uses the current palette and intensity range.
+   */
+  void flipExport();
+
+  /** @brief Set the window function applied before each FFT.
+   *
+   *  The spectrogram runs its own FFTs, at fixed intervals in sample time,
+   *  and only takes the coefficients from the window function, so the window
+   *  doesn't need to be run by the processing graph. The window is not owned
+   *  by the spectrogram.
+   */
+  void setWindowFunction(GenericWindow* w) { window_function_ = w; }
+
+  /// Set the size of the FFTs; zero to use the size of the input buffer.
+  void setFftSize(unsigned n) { fft_size_ = n; }
+  /// Get the size of the FFTs, or zero if the input size is used.
+  unsigned getFftSize() const { return fft_size_; }
+
+  /// Take the FFT plans from a shared cache.
+  void setPlanCache(const FftPlanCachePtr& cache) {
+    plan_cache_ = cache;
+    fft_.setPlanCache(cache.get());
+    filter_bank_.setPlanCache(cache);
+  }
+
+  /// Use the filter bank for the rows, instead of the FFT bins.
+  void setFilterBankUse(bool b) { use_filter_bank_ = b; }
+  /// Find out whether the rows come from the filter bank.
+  bool getFilterBankUse() const { return use_filter_bank_; }
+
  private:
-  void makePalette_(const std::string& s);
-  GlColor4 getColor_(float a);
-  void scroll_();
+  InputPort<std::vector<float> >      raw_;
+  InputPort<Grabber::DetailsStruct>   details_;
+
+  /// A column that was calculated but not drawn yet.
+  struct Column {
+    /// Magnitudes of the spectrum.
+    std::vector<float>  magnitudes;
+    /// Frequency of the first bin above zero, which is also the spacing
+    /// between the bins.
+    float               min_freq;
+    /// Center frequencies of the bands, if the magnitudes come from the
+    /// filter bank; null for FFT bins.
+    boost::shared_ptr<const std::vector<float> >  frequencies;
+  };
+
+  /// Scroll the spectrogram to the left by the given number of pixels.
+  void scroll_(unsigned pixels);
+  /// Calculate the magnitudes of the spectrum for the column ending at the
+  /// absolute sample index @a end, max-pooling the FFTs within the column.
+  void calculateColumn_(unsigned long long end, unsigned hop, unsigned size,
+    std::vector<float>& magnitudes);
+  /// Draw the column whose left edge is at @a x.
+  void drawColumn_(unsigned x, const Column& column);
+  /// Get the texture coordinates of the top-right corner of the FBOs; the
+  /// pooled FBOs can be larger than the display.
+  GlVertex2 getTexCorner_() const;
 
   Animator                animator_;
-  boost::scoped_ptr<Vbo>  vbo_;
-  boost::scoped_ptr<Fbo>  fbos_[2];
+  FboPool::FboPtr         fbos_[2];
   int                     crt_fbo_;
   Axes                    axes_;
+  /// Width of a column, in pixels.
   unsigned                shift_;
-  std::vector<GlColor4>   palette_;
+  /// Time covered by a column, in seconds.
+  float                   column_time_;
+  /// Number of FFTs that are max-pooled into each column.
+  unsigned                pool_;
+  Palette                 palette_;
+
+  GenericWindow*          window_function_;
+  unsigned                fft_size_;
+  FftPlanCachePtr         plan_cache_;
+  RealFft                 fft_;
+  FilterBank              filter_bank_;
+  bool                    use_filter_bank_;
+  std::vector<float>      bands_;
+  /// Samples from the input, enough to fill a screen's worth of columns.
+  SampleHistory           history_;
+  float                   history_rate_;
+  /// Sample index at which the next column ends.
+  unsigned long long      next_column_;
+  /// Columns waiting to be drawn.
+  std::deque<Column>      pending_;
+
+  SpectrogramExport       export_;
+  /// Whether the export still has to be fed the columns from the history.
+  bool                    export_backfill_;
 };
 
 #endif
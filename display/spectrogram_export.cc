@@ -0,0 +1,218 @@
+#include "display/spectrogram_export.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/bind.hpp>
+
+#include "utils/logging.h"
+#include "utils/png_writer.h"
+
+void SpectrogramExport::setColorMap(const Palette& palette, bool log_scale,
+  float low, float high)
+{
+  const std::vector<GlColor4>& colors = palette.getColors();
+  lut_.resize(3*colors.size());
+  for (size_t i = 0; i < colors.size(); ++i) {
+    lut_[3*i] = 255*colors[i].r;
+    lut_[3*i + 1] = 255*colors[i].g;
+    lut_[3*i + 2] = 255*colors[i].b;
+  }
+
+  log_scale_ = log_scale;
+  low_ = low;
+  high_ = high;
+}
+
+bool SpectrogramExport::start()
+{
+  stop();
+
+  const std::string fname = path_ + ".txt";
+  index_.open(fname.c_str());
+  if (!index_) {
+    logger::error << "Can't open " << fname << " for the spectrogram export."
+                  << std::endl;
+    return false;
+  }
+  index_ << "# file first_sample columns hop fft_size rate bins bin_width "
+         << "start_time" << std::endl;
+
+  if (lut_.empty())
+    setColorMap(Palette("grayscale"), log_scale_, low_, high_);
+
+  n_tiles_ = 0;
+  n_columns_ = 0;
+  current_.columns = 0;
+  current_.data.clear();
+
+  running_ = true;
+  for (unsigned i = 0; i < n_threads_; ++i)
+    workers_.create_thread(boost::bind(&SpectrogramExport::run_, this));
+
+  logger::info << "Exporting the spectrogram to " << fname << "."
+               << std::endl;
+  return true;
+}
+
+void SpectrogramExport::stop()
+{
+  if (!running_)
+    return;
+
+  flush_();
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    running_ = false;
+    work_cond_.notify_all();
+  }
+  workers_.join_all();
+  index_.close();
+
+  logger::info << "Spectrogram export stopped after " << n_columns_
+               << " columns, in " << n_tiles_ << " tiles." << std::endl;
+}
+
+void SpectrogramExport::addColumn(unsigned long long end, unsigned hop,
+  unsigned size, float rate, const std::vector<float>& magnitudes)
+{
+  if (!running_ || magnitudes.empty())
+    return;
+
+  // start a new tile if the column doesn't follow the previous ones
+  if (current_.columns > 0) {
+    const unsigned long long expected = current_.first_end +
+      (unsigned long long)current_.columns*current_.hop;
+    if (end != expected || hop != current_.hop || size != current_.size ||
+        rate != current_.rate || magnitudes.size() != current_.bins)
+    {
+      flush_();
+    }
+  }
+
+  if (current_.columns == 0) {
+    current_.first_end = end;
+    current_.hop = hop;
+    current_.size = size;
+    current_.rate = rate;
+    current_.bins = magnitudes.size();
+    current_.data.reserve((size_t)tile_width_*current_.bins);
+  }
+
+  current_.data.insert(current_.data.end(), magnitudes.begin(),
+    magnitudes.end());
+  ++current_.columns;
+  ++n_columns_;
+
+  if (current_.columns >= tile_width_)
+    flush_();
+}
+
+void SpectrogramExport::flush_()
+{
+  if (current_.columns == 0)
+    return;
+
+  current_.index = n_tiles_++;
+
+  // the first column covers the samples before its end
+  const double start = ((double)current_.first_end - current_.size) /
+    current_.rate;
+  index_ << getTileName_(current_.index) << " " << current_.first_end << " "
+         << current_.columns << " " << current_.hop << " " << current_.size
+         << " " << current_.rate << " " << current_.bins << " "
+         << current_.rate / current_.size << " " << start << std::endl;
+
+  {
+    // keep the memory bounded by waiting for the workers if they fall behind
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (queue_.size() >= 2*n_threads_)
+      space_cond_.wait(lock);
+
+    queue_.push_back(Tile());
+    Tile& tile = queue_.back();
+    tile.index = current_.index;
+    tile.first_end = current_.first_end;
+    tile.hop = current_.hop;
+    tile.size = current_.size;
+    tile.rate = current_.rate;
+    tile.bins = current_.bins;
+    tile.columns = current_.columns;
+    tile.data.swap(current_.data);
+    work_cond_.notify_one();
+  }
+
+  current_.columns = 0;
+  current_.data.clear();
+}
+
+void SpectrogramExport::run_()
+{
+  Tile tile;
+  for (;;) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (running_ && queue_.empty())
+        work_cond_.wait(lock);
+      // the queue is drained before stopping
+      if (queue_.empty())
+        return;
+
+      // take the tile without copying its data
+      std::vector<float> data;
+      data.swap(queue_.front().data);
+      tile = queue_.front();
+      tile.data.swap(data);
+      queue_.pop_front();
+      space_cond_.notify_one();
+    }
+
+    writeTile_(tile);
+  }
+}
+
+void SpectrogramExport::writeTile_(const Tile& tile) const
+{
+  const size_t n_colors = lut_.size() / 3;
+  const bool log_scale = log_scale_ && low_ > 0 && high_ > 0;
+  const float offset = log_scale?std::log(low_):low_;
+  const float span = log_scale?(std::log(high_) - offset):(high_ - offset);
+  const float scale = (span != 0)?(n_colors / span):0;
+
+  try {
+    PngWriter writer;
+    writer.open(getTileName_(tile.index), tile.columns, tile.bins);
+
+    // the highest frequencies go at the top
+    std::vector<unsigned char> row(3*tile.columns);
+    for (unsigned r = 0; r < tile.bins; ++r) {
+      const unsigned bin = tile.bins - 1 - r;
+      for (unsigned c = 0; c < tile.columns; ++c) {
+        const float m = tile.data[(size_t)c*tile.bins + bin];
+        float x;
+        if (log_scale)
+          x = (m > 0)?(std::log(m) - offset)*scale:0;
+        else
+          x = (m - offset)*scale;
+
+        const size_t idx = std::min<float>(std::max<float>(x, 0),
+          n_colors - 1);
+        std::copy(&lut_[3*idx], &lut_[3*idx] + 3, &row[3*c]);
+      }
+      writer.writeRow(&row[0]);
+    }
+    writer.close();
+  }
+  catch (const PngError& e) {
+    logger::error << e.what() << std::endl;
+  }
+}
+
+std::string SpectrogramExport::getTileName_(unsigned index) const
+{
+  std::ostringstream res;
+  res << path_ << "_" << std::setw(6) << std::setfill('0') << index << ".png";
+  return res.str();
+}
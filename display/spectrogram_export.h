@@ -0,0 +1,131 @@
+/** @file spectrogram_export.h
+ *  @brief Defines a class that saves spectrogram columns at full resolution,
+ *  as a set of image tiles.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef SPECTROGRAM_EXPORT_H_
+#define SPECTROGRAM_EXPORT_H_
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include "glutils/palette.h"
+
+/** @brief Write spectrogram columns to disk, at the resolution of the FFT.
+ *
+ *  Columns are collected into tiles of a fixed number of columns, with one
+ *  pixel per frequency bin, and time going from left to right. Full tiles
+ *  are colored and written as PNG files by a few worker threads. Only a
+ *  bounded number of tiles is kept in memory: if the workers fall behind,
+ *  @a addColumn waits for them.
+ *
+ *  An index file lists the tiles, together with the sample positions and the
+ *  frequency resolution that they cover, so that they can be put together
+ *  afterwards. A new tile is started whenever the columns stop being
+ *  contiguous, or the parameters of the FFT change.
+ */
+class SpectrogramExport : boost::noncopyable {
+ public:
+  /// Constructor.
+  SpectrogramExport() : path_("spectrogram"), tile_width_(1024),
+    n_threads_(2), log_scale_(true), low_(0.01), high_(100), running_(false),
+    n_tiles_(0), n_columns_(0) {}
+
+  /// Destructor. Stops the export.
+  ~SpectrogramExport() { stop(); }
+
+  /// Set the prefix for the tiles and the index file.
+  void setPath(const std::string& p) { path_ = p; }
+  /// Get the prefix for the output files.
+  const std::string& getPath() const { return path_; }
+
+  /// Set the number of columns in each tile.
+  void setTileWidth(unsigned w) { tile_width_ = (w > 0)?w:1; }
+  /// Get the number of columns in each tile.
+  unsigned getTileWidth() const { return tile_width_; }
+
+  /// Set the number of worker threads.
+  void setThreads(unsigned n) { n_threads_ = (n > 0)?n:1; }
+  /// Get the number of worker threads.
+  unsigned getThreads() const { return n_threads_; }
+
+  /** @brief Set the mapping from magnitudes to colors.
+   *
+   *  Magnitudes between @a low and @a high are spread over the palette,
+   *  either linearly or logarithmically. This takes effect at the next
+   *  @a start.
+   */
+  void setColorMap(const Palette& palette, bool log_scale, float low,
+    float high);
+
+  /// Start the export. Returns @a false if the index file can't be opened.
+  bool start();
+
+  /// Write the tile that is being filled, wait for the workers to finish,
+  /// and close the index.
+  void stop();
+
+  /// Find out whether the export is running.
+  bool isRunning() const { return running_; }
+
+  /** @brief Add a column, obtained from an FFT of @a size samples ending at
+   *  the absolute sample index @a end.
+   *
+   *  @a hop is the number of samples between columns.
+   */
+  void addColumn(unsigned long long end, unsigned hop, unsigned size,
+    float rate, const std::vector<float>& magnitudes);
+
+ private:
+  /// A tile waiting to be written.
+  struct Tile {
+    unsigned            index;
+    /// Absolute sample index at which the first column ends.
+    unsigned long long  first_end;
+    unsigned            hop;
+    unsigned            size;
+    float               rate;
+    unsigned            bins;
+    unsigned            columns;
+    /// Magnitudes, stored column by column.
+    std::vector<float>  data;
+  };
+
+  /// Hand the current tile to the workers.
+  void flush_();
+  void run_();
+  void writeTile_(const Tile& tile) const;
+  std::string getTileName_(unsigned index) const;
+
+  std::string                 path_;
+  unsigned                    tile_width_;
+  unsigned                    n_threads_;
+
+  /// RGB version of the palette.
+  std::vector<unsigned char>  lut_;
+  bool                        log_scale_;
+  float                       low_;
+  float                       high_;
+
+  boost::thread_group         workers_;
+  boost::mutex                mutex_;
+  /// Signaled when tiles are added to the queue, or the export stops.
+  boost::condition_variable   work_cond_;
+  /// Signaled when a tile is taken off the queue.
+  boost::condition_variable   space_cond_;
+  bool                        running_;
+  std::deque<Tile>            queue_;
+
+  Tile                        current_;
+  unsigned                    n_tiles_;
+  unsigned long long          n_columns_;
+  std::ofstream               index_;
+};
+
+#endif
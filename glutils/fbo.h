@@ -13,6 +13,7 @@
 
 #include "glutils/texture.h"
 #include "glutils/gl_incs.h"
+#include "glutils/gl_state.h"
 
 // XXX check that the FBO extension is present!
 /** @brief An RAII wrapper for FBOs.
@@ -56,7 +57,7 @@ class Fbo : boost::noncopyable {
 
   /// Bind the FBO. Does nothing if the FBO is on the top of the stack.
   void bind()
-    { glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, label_); current_ = this; }
+    { GlState::bindFramebuffer(label_); current_ = this; }
 
   /// Push the current FBO to the stack.
   static void push() { stack_.push_back(current_); }
@@ -70,7 +71,7 @@ class Fbo : boost::noncopyable {
 
   /// Unbind any FBO.
   static void unbind()
-    { glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0); current_ = 0; }
+    { GlState::bindFramebuffer(0); current_ = 0; }
 
   /// Get the integer label for this FBO.
   GLuint getLabel() const { return label_; }
@@ -0,0 +1,52 @@
+#include "glutils/fbo_pool.h"
+
+FboPool::FboPtr FboPool::acquire(unsigned width, unsigned height)
+{
+  const unsigned w = roundUp(width);
+  const unsigned h = roundUp(height);
+
+  // look for a recently used FBO of the right size
+  FboPtr res;
+  for (std::deque<FboPtr>::iterator i = free_.end(); i != free_.begin(); ) {
+    --i;
+    const Fbo::TextureSharedPtr& tex = (*i) -> getTexture();
+    if (tex -> getWidth() == w && tex -> getHeight() == h) {
+      res = *i;
+      free_.erase(i);
+      break;
+    }
+  }
+
+  // creating the FBO binds it; make sure the old binding is restored
+  Fbo::push();
+  if (!res)
+    res.reset(new Fbo(w, h));
+  else
+    res -> bind();
+  glClear(GL_COLOR_BUFFER_BIT);
+  Fbo::pop();
+
+  return res;
+}
+
+void FboPool::release(const FboPtr& fbo)
+{
+  if (!fbo)
+    return;
+
+  free_.push_back(fbo);
+  if (free_.size() > max_free_) {
+    // deleting an FBO unbinds whatever FBO was bound
+    Fbo::push();
+    while (free_.size() > max_free_)
+      free_.pop_front();
+    Fbo::pop();
+  }
+}
+
+void FboPool::clear()
+{
+  Fbo::push();
+  free_.clear();
+  Fbo::pop();
+}
@@ -0,0 +1,61 @@
+/** @file fbo_pool.h
+ *  @brief Defines a pool of framebuffer objects, grouped in size classes.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GLUTILS_FBO_POOL_H_
+#define GLUTILS_FBO_POOL_H_
+
+#include <deque>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "glutils/fbo.h"
+
+/** @brief A pool of FBOs that can be reused as render targets change size.
+ *
+ *  The sizes of the FBOs are rounded up to multiples of @a kGranularity, so
+ *  that render targets whose size changes a little, as happens when the
+ *  window is being resized, can reuse the same FBOs. Users draw in the
+ *  bottom-left corner of the FBO, and should scale their texture coordinates
+ *  accordingly. FBOs that are released are kept for reuse, up to a maximum
+ *  number; older ones are deleted.
+ */
+class FboPool : boost::noncopyable {
+ public:
+  typedef boost::shared_ptr<Fbo> FboPtr;
+
+  /// The sizes of the FBOs are multiples of this.
+  static const unsigned kGranularity = 64;
+
+  /// Constructor.
+  explicit FboPool(size_t max_free = 4) : max_free_(max_free) {}
+
+  /** @brief Get an FBO that is at least @a width by @a height pixels.
+   *
+   *  The FBO is cleared. This does not change the FBO that is bound.
+   */
+  FboPtr acquire(unsigned width, unsigned height);
+
+  /// Give an FBO back to the pool, once it is no longer used.
+  void release(const FboPtr& fbo);
+
+  /// Delete all the FBOs that are not in use.
+  void clear();
+
+  /// Get the number of FBOs that are waiting to be reused.
+  size_t getFreeCount() const { return free_.size(); }
+
+  /// Round a size up to the size class it belongs to.
+  static unsigned roundUp(unsigned x)
+    { return (x > 0)?((x + kGranularity - 1)/kGranularity*kGranularity):
+                     kGranularity; }
+
+ private:
+  size_t              max_free_;
+  /// FBOs that can be reused, oldest first.
+  std::deque<FboPtr>  free_;
+};
+
+#endif
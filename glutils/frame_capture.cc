@@ -0,0 +1,272 @@
+#include "glutils/frame_capture.h"
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "utils/exception.h"
+#include "utils/logging.h"
+#include "utils/png_writer.h"
+
+void FrameCapture::setFormat(const std::string& s)
+{
+  if (s == "raw")
+    setFormat(RAW);
+  else if (s == "y4m")
+    setFormat(Y4M);
+  else if (s == "png")
+    setFormat(PNG);
+  else
+    throw Exception("Unknown capture format: " + s + ".");
+}
+
+std::string FrameCapture::getFormatString() const
+{
+  switch (format_) {
+    case RAW: return "raw";
+    case PNG: return "png";
+    default:  return "y4m";
+  }
+}
+
+bool FrameCapture::start(unsigned width, unsigned height)
+{
+  stop();
+
+  width_ = width;
+  height_ = height;
+  frames_ = 0;
+  dropped_ = 0;
+  sequence_ = 0;
+  failed_ = false;
+  if (!openOutput_())
+    return false;
+
+  // the PBOs that the frames are read into
+  glGenBuffers(2, pbos_);
+  for (int i = 0; i < 2; ++i) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos_[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, 4*width_*height_, 0, GL_STREAM_READ);
+    repeats_[i] = 0;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  crt_pbo_ = 0;
+
+  timer_.reset();
+  running_ = true;
+  capturing_ = true;
+  thread_ = boost::thread(&FrameCapture::run_, this);
+
+  return true;
+}
+
+void FrameCapture::stop()
+{
+  if (!capturing_)
+    return;
+
+  // the last frame that was read back is still in its PBO
+  if (repeats_[1 - crt_pbo_] > 0)
+    collect_(1 - crt_pbo_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  // let the writer finish the frames it has
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    running_ = false;
+    cond_.notify_one();
+  }
+  thread_.join();
+
+  glDeleteBuffers(2, pbos_);
+  pbos_[0] = pbos_[1] = 0;
+  out_.close();
+  capturing_ = false;
+
+  logger::info << "Capture stopped after " << frames_ << " frames, "
+               << dropped_ << " of which were dropped." << std::endl;
+}
+
+void FrameCapture::capture()
+{
+  if (!capturing_)
+    return;
+
+  // find out how many frames should have been emitted by now
+  const unsigned long due = std::floor(timer_.getElapsed()*rate_) + 1;
+  const int other = 1 - crt_pbo_;
+  if (due > frames_) {
+    // this returns straight away; the data is collected next time
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos_[crt_pbo_]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    repeats_[crt_pbo_] = due - frames_;
+    frames_ = due;
+    crt_pbo_ = other;
+  }
+
+  // the frame read in the previous cycle is ready by now
+  if (repeats_[other] > 0)
+    collect_(other);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+unsigned long FrameCapture::getDroppedCount() const
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void FrameCapture::collect_(int pbo)
+{
+  const unsigned repeat = repeats_[pbo];
+  repeats_[pbo] = 0;
+
+  Frame frame;
+  frame.repeat = repeat;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (pending_.size() >= max_pending_) {
+      dropped_ += repeat;
+      return;
+    }
+    // reuse an old buffer, to avoid allocating memory in every frame
+    if (!free_.empty()) {
+      frame.pixels.swap(free_.back().pixels);
+      free_.pop_back();
+    }
+  }
+
+  const size_t size = 4*width_*height_;
+  frame.pixels.resize(size);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos_[pbo]);
+  const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (!data) {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    dropped_ += repeat;
+    return;
+  }
+  std::memcpy(&frame.pixels[0], data, size);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  pending_.push_back(Frame());
+  pending_.back().pixels.swap(frame.pixels);
+  pending_.back().repeat = repeat;
+  cond_.notify_one();
+}
+
+void FrameCapture::run_()
+{
+  Frame frame;
+  for (;;) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (running_ && pending_.empty())
+        cond_.wait(lock);
+      // the queue is drained before stopping
+      if (pending_.empty())
+        return;
+
+      frame.pixels.swap(pending_.front().pixels);
+      frame.repeat = pending_.front().repeat;
+      pending_.pop_front();
+    }
+
+    write_(frame);
+
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    free_.push_back(Frame());
+    free_.back().pixels.swap(frame.pixels);
+  }
+}
+
+bool FrameCapture::openOutput_()
+{
+  std::string fname;
+  if (format_ == RAW)
+    fname = path_ + ".rgb";
+  else if (format_ == Y4M)
+    fname = path_ + ".y4m";
+  else
+    return true;
+
+  out_.open(fname.c_str(), std::ios::out | std::ios::binary);
+  if (!out_) {
+    logger::error << "Can't open " << fname << " for capturing." << std::endl;
+    return false;
+  }
+
+  if (format_ == Y4M) {
+    out_ << "YUV4MPEG2 W" << width_ << " H" << height_ << " F" << rate_
+         << ":1 Ip A1:1 C444\n";
+  }
+
+  logger::info << "Capturing " << width_ << "x" << height_ << " frames at "
+               << rate_ << " fps to " << fname << "." << std::endl;
+  return true;
+}
+
+void FrameCapture::write_(const Frame& frame)
+{
+  if (failed_)
+    return;
+
+  // flip the image, and drop the alpha channel
+  const size_t n = (size_t)width_*height_;
+  image_.resize(3*n);
+  if (format_ == Y4M) {
+    // full-resolution planes, with BT.601 studio-range coefficients
+    unsigned char* y = &image_[0];
+    unsigned char* u = y + n;
+    unsigned char* v = u + n;
+    for (unsigned row = 0; row < height_; ++row) {
+      const unsigned char* src = &frame.pixels[4*(height_ - 1 - row)*width_];
+      const size_t base = (size_t)row*width_;
+      for (unsigned i = 0; i < width_; ++i, src += 4) {
+        const int r = src[0], g = src[1], b = src[2];
+        y[base + i] = ((66*r + 129*g + 25*b + 128) >> 8) + 16;
+        u[base + i] = ((-38*r - 74*g + 112*b + 128) >> 8) + 128;
+        v[base + i] = ((112*r - 94*g - 18*b + 128) >> 8) + 128;
+      }
+    }
+  } else {
+    for (unsigned row = 0; row < height_; ++row) {
+      const unsigned char* src = &frame.pixels[4*(height_ - 1 - row)*width_];
+      unsigned char* dest = &image_[3*(size_t)row*width_];
+      for (unsigned i = 0; i < width_; ++i, src += 4, dest += 3) {
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
+      }
+    }
+  }
+
+  for (unsigned k = 0; k < frame.repeat; ++k) {
+    if (format_ == PNG) {
+      std::ostringstream fname;
+      fname << path_ << "_" << std::setw(6) << std::setfill('0')
+            << sequence_ << ".png";
+      try {
+        PngWriter::write(fname.str(), width_, height_, &image_[0]);
+      }
+      catch (const PngError& e) {
+        logger::error << e.what() << std::endl;
+        failed_ = true;
+        return;
+      }
+    } else {
+      if (format_ == Y4M)
+        out_ << "FRAME\n";
+      out_.write(reinterpret_cast<const char*>(&image_[0]), image_.size());
+      if (!out_) {
+        logger::error << "Error writing the capture." << std::endl;
+        failed_ = true;
+        return;
+      }
+    }
+    ++sequence_;
+  }
+}
@@ -0,0 +1,146 @@
+/** @file frame_capture.h
+ *  @brief Defines a class that records the frames drawn on screen to disk.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GLUTILS_FRAME_CAPTURE_H_
+#define GLUTILS_FRAME_CAPTURE_H_
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include "glutils/gl_incs.h"
+#include "utils/misc.h"
+
+/** @brief Record the contents of the window, without stalling the rendering.
+ *
+ *  Each frame is read back into one of two pixel buffer objects, in turns,
+ *  so that @a glReadPixels returns straight away; the frame is only copied
+ *  out of its PBO one frame later, when the transfer has finished. The
+ *  copies are handed to a writer thread. If the writer falls behind, frames
+ *  are dropped instead of making the render loop wait.
+ *
+ *  Frames are captured at a fixed rate. When rendering is slower than that,
+ *  frames are repeated, so that the recording keeps in step with real time.
+ *  The output is either raw RGB data, a Y4M (YUV4MPEG2) video in 4:4:4
+ *  format, or a sequence of PNG files.
+ */
+class FrameCapture : boost::noncopyable {
+ public:
+  /// The output formats.
+  enum Format { RAW, Y4M, PNG };
+
+  /// Constructor.
+  FrameCapture() : format_(Y4M), path_("capture"), rate_(60),
+    max_pending_(8), running_(false), capturing_(false), width_(0),
+    height_(0), crt_pbo_(0), frames_(0), dropped_(0), failed_(false),
+    sequence_(0)
+    { pbos_[0] = pbos_[1] = 0; repeats_[0] = repeats_[1] = 0; }
+
+  /// Destructor. Stops the capture.
+  ~FrameCapture() { stop(); }
+
+  /// Set the output format ("raw", "y4m", or "png").
+  void setFormat(const std::string& s);
+  /// Set the output format. This takes effect at the next @a start.
+  void setFormat(Format f) { format_ = f; }
+  /// Get the output format.
+  Format getFormat() const { return format_; }
+  /// Get the output format as a string.
+  std::string getFormatString() const;
+
+  /** @brief Set the prefix for the output files.
+   *
+   *  The extension is added depending on the format; PNG files also get a
+   *  frame number.
+   */
+  void setPath(const std::string& p) { path_ = p; }
+  /// Get the prefix for the output files.
+  const std::string& getPath() const { return path_; }
+
+  /// Set the number of frames captured per second.
+  void setFrameRate(unsigned r) { rate_ = (r > 0)?r:1; }
+  /// Get the number of frames captured per second.
+  unsigned getFrameRate() const { return rate_; }
+
+  /// Set the number of frames that can wait for the writer before frames
+  /// start being dropped.
+  void setMaxPending(size_t n) { max_pending_ = (n > 0)?n:1; }
+
+  /** @brief Start capturing frames of the given size.
+   *
+   *  This needs a current OpenGL context. Returns @a false if the output
+   *  can't be opened.
+   */
+  bool start(unsigned width, unsigned height);
+
+  /// Stop capturing, and wait for the writer to finish.
+  void stop();
+
+  /// Find out whether frames are being captured.
+  bool isCapturing() const { return capturing_; }
+
+  /// Read back the current frame. Call this after drawing, before swapping
+  /// the buffers.
+  void capture();
+
+  /// Get the number of frames dropped since the capture started.
+  unsigned long getDroppedCount() const;
+
+ private:
+  /// A frame waiting to be written.
+  struct Frame {
+    /// RGBA pixels, starting with the bottom row.
+    std::vector<unsigned char>  pixels;
+    /// Number of times the frame should be written.
+    unsigned                    repeat;
+  };
+
+  /// Copy the frame in the given PBO and hand it to the writer.
+  void collect_(int pbo);
+  void run_();
+  /// Write a frame in the chosen format.
+  void write_(const Frame& frame);
+  /// Open the output file for formats that write a single file.
+  bool openOutput_();
+
+  Format                      format_;
+  std::string                 path_;
+  unsigned                    rate_;
+  size_t                      max_pending_;
+
+  boost::thread               thread_;
+  mutable boost::mutex        mutex_;
+  boost::condition_variable   cond_;
+  bool                        running_;
+
+  bool                        capturing_;
+  unsigned                    width_;
+  unsigned                    height_;
+  GLuint                      pbos_[2];
+  int                         crt_pbo_;
+  /// Number of times the frame in each PBO has to be written; zero if the
+  /// PBO holds no frame.
+  unsigned                    repeats_[2];
+  Timer                       timer_;
+  /// Number of frames emitted so far, including repeats.
+  unsigned long               frames_;
+  unsigned long               dropped_;
+
+  std::deque<Frame>           pending_;
+  /// Frame buffers that can be reused.
+  std::vector<Frame>          free_;
+
+  /// Used by the writer thread only.
+  bool                        failed_;
+  std::ofstream               out_;
+  unsigned long               sequence_;
+  std::vector<unsigned char>  image_;
+};
+
+#endif
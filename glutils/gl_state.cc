@@ -0,0 +1,97 @@
+#include "gl_state.h"
+
+GlState::Switches GlState::capabilities_;
+GlState::Switches GlState::client_states_;
+GlState::Binding  GlState::array_buffer_;
+GlState::Binding  GlState::texture_;
+GlState::Binding  GlState::framebuffer_;
+GlState::Binding  GlState::program_;
+
+GlState::Stats    GlState::current_;
+GlState::Stats    GlState::last_;
+
+void GlState::setCapability(GLenum cap, bool state)
+{
+  Switches::iterator i = capabilities_.find(cap);
+  if (i != capabilities_.end() && i -> second == state) {
+    ++current_.redundant;
+    return;
+  }
+
+  if (state)
+    glEnable(cap);
+  else
+    glDisable(cap);
+  capabilities_[cap] = state;
+  ++current_.state_changes;
+}
+
+void GlState::setClientState(GLenum array, bool state)
+{
+  Switches::iterator i = client_states_.find(array);
+  if (i != client_states_.end() && i -> second == state) {
+    ++current_.redundant;
+    return;
+  }
+
+  if (state)
+    glEnableClientState(array);
+  else
+    glDisableClientState(array);
+  client_states_[array] = state;
+  ++current_.state_changes;
+}
+
+void GlState::bindArrayBuffer(GLuint buffer)
+{
+  if (change_(array_buffer_, buffer))
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void GlState::bindTexture(GLuint texture)
+{
+  if (change_(texture_, texture))
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlState::bindFramebuffer(GLuint fbo)
+{
+  if (change_(framebuffer_, fbo))
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+}
+
+void GlState::useProgram(GLuint program)
+{
+  if (change_(program_, program))
+    glUseProgram(program);
+}
+
+void GlState::textureDeleted(GLuint texture)
+{
+  // deleting a bound texture reverts the binding to zero
+  if (texture_.known && texture_.label == texture)
+    texture_.label = 0;
+}
+
+void GlState::invalidate()
+{
+  capabilities_.clear();
+  client_states_.clear();
+  array_buffer_ = Binding();
+  texture_ = Binding();
+  framebuffer_ = Binding();
+  program_ = Binding();
+}
+
+bool GlState::change_(Binding& binding, GLuint label)
+{
+  if (binding.known && binding.label == label) {
+    ++current_.redundant;
+    return false;
+  }
+
+  binding.known = true;
+  binding.label = label;
+  ++current_.state_changes;
+  return true;
+}
@@ -0,0 +1,111 @@
+/** @file gl_state.h
+ *  @brief Defines a cache for OpenGL state that filters out redundant state
+ *  changes, and keeps track of the number of draw calls and state changes.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GLUTILS_GL_STATE_H_
+#define GLUTILS_GL_STATE_H_
+
+#include <map>
+
+#include "glutils/gl_incs.h"
+
+/** @brief A tracker for OpenGL state.
+ *
+ *  All the functions in this class mirror the corresponding OpenGL calls, but
+ *  they only reach OpenGL if the state actually changes. This only works if
+ *  all the changes to the tracked state go through this class; if you change
+ *  the state directly, call @a invalidate to make the tracker forget what it
+ *  knows.
+ *
+ *  The class also counts the number of draw calls and the number of state
+ *  changes (issued and filtered out) in each frame. Call @a newFrame at the
+ *  end of every frame to start a new count.
+ */
+class GlState {
+ public:
+  /// Statistics for one frame.
+  struct Stats {
+    /// Number of draw calls.
+    unsigned  draw_calls;
+    /// Number of state changes that were sent to OpenGL.
+    unsigned  state_changes;
+    /// Number of redundant state changes that were filtered out.
+    unsigned  redundant;
+
+    /// Empty constructor.
+    Stats() : draw_calls(0), state_changes(0), redundant(0) {}
+  };
+
+  /// Enable an OpenGL capability (as in @a glEnable).
+  static void enable(GLenum cap) { setCapability(cap, true); }
+  /// Disable an OpenGL capability (as in @a glDisable).
+  static void disable(GLenum cap) { setCapability(cap, false); }
+  /// Enable or disable an OpenGL capability.
+  static void setCapability(GLenum cap, bool state);
+
+  /// Enable or disable a client-side array (as in @a glEnableClientState).
+  static void setClientState(GLenum array, bool state);
+
+  /// Bind a buffer object to @a GL_ARRAY_BUFFER.
+  static void bindArrayBuffer(GLuint buffer);
+  /// Bind a texture to @a GL_TEXTURE_2D.
+  static void bindTexture(GLuint texture);
+  /// Bind a framebuffer object.
+  static void bindFramebuffer(GLuint fbo);
+  /// Select the GLSL program to use (zero for the fixed-function pipeline).
+  static void useProgram(GLuint program);
+
+  /// Let the tracker know that a texture was deleted.
+  static void textureDeleted(GLuint texture);
+
+  /// Draw from the enabled arrays, and count the draw call.
+  static void drawArrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+    ++current_.draw_calls;
+  }
+
+  /// Forget all the cached state.
+  static void invalidate();
+
+  /// Start a new frame for the statistics.
+  static void newFrame() { last_ = current_; current_ = Stats(); }
+
+  /// Get the statistics for the current (unfinished) frame.
+  static const Stats& getCurrentStats() { return current_; }
+
+  /// Get the statistics for the last complete frame.
+  static const Stats& getLastFrameStats() { return last_; }
+
+ private:
+  typedef std::map<GLenum, bool> Switches;
+
+  /// A cached binding.
+  struct Binding {
+    /// Whether the value is known.
+    bool    known;
+    /// The object that is bound.
+    GLuint  label;
+
+    /// Empty constructor.
+    Binding() : known(false), label(0) {}
+  };
+
+  /** @brief Update a cached binding. Return @a true if OpenGL needs to be
+   *  called.
+   */
+  static bool change_(Binding& binding, GLuint label);
+
+  static Switches   capabilities_;
+  static Switches   client_states_;
+  static Binding    array_buffer_;
+  static Binding    texture_;
+  static Binding    framebuffer_;
+  static Binding    program_;
+
+  static Stats      current_;
+  static Stats      last_;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "glutils/palette.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include "utils/exception.h"
+#include "utils/misc.h"
+
+const size_t Palette::kSize;
+
+void Palette::set(const std::string& s)
+{
+  if (s == "grayscale")
+    make_("rgb 0:(0,0,0,1) 1:(1,1,1,1)");
+  else if (s == "thermal")
+    make_("hls 0:(1,0,0.3,1) 0.9:(0,0.6,1,1) 1:(0,1,0,1)");
+  else
+    make_(s);
+}
+
+static GlColor4 hlsToRgb(const GlColor4& col)
+{
+  float hue = col.r;
+  float lum = col.g;
+  float sat = col.b;
+
+  GlColor4 res;
+  res.a = col.a;
+
+  if (hue < 1.0/6) {
+    res.r = 1;
+    res.g = hue*6;
+    res.b = 0;
+  } else if (hue < 2.0/6) {
+    res.r = (2.0/6 - hue)*6;
+    res.g = 1;
+    res.b = 0;
+  } else if (hue < 3.0/6) {
+    res.r = 0;
+    res.g = 1;
+    res.b = (hue - 2.0/6)*6;
+  } else if (hue < 4.0/6) {
+    res.r = 0;
+    res.g = (4.0/6 - hue)*6;
+    res.b = 1;
+  } else if (hue < 5.0/6) {
+    res.r = (hue - 4.0/6)*6;
+    res.g = 0;
+    res.b = 1;
+  } else {
+    res.r = 1;
+    res.g = 0;
+    res.b = (1 - hue)*6;
+  }
+
+  float min = 0.5 - sat/2;
+  float max = 0.5 + sat/2;
+
+  res.r = min + res.r*(max - min);
+  res.g = min + res.g*(max - min);
+  res.b = min + res.b*(max - min);
+
+  if (lum <= 0.5) {
+    float f = 2*lum;
+    res.r = res.r*f;
+    res.g = res.g*f;
+    res.b = res.b*f;
+  } else {
+    float f = 2*lum - 1;
+    res.r = res.r + (1 - res.r)*f;
+    res.g = res.g + (1 - res.g)*f;
+    res.b = res.b + (1 - res.b)*f;
+  }
+
+  return res;
+}
+
+void Palette::make_(const std::string& s)
+{
+  if (s.length() < 4)
+    throw Exception("Bad palette string: " + s);
+
+  std::string type = s.substr(0, 3);
+  if (type != "hls" && type != "rgb")
+    throw Exception("Bad palette string: " + s);
+
+  std::vector<std::string> points = splitString(s.substr(4));
+  const size_t n_points = points.size();
+
+  const size_t n = kSize;
+  colors_.assign(n, GlColor4(0, 0, 0));
+
+  if (n_points > 0) {
+    for (size_t i = 0; i < n_points - 1; ++i) {
+      std::string s1 = points[i];
+      std::string s2 = points[i + 1];
+
+      size_t p1 = s1.find(':');
+      size_t p2 = s2.find(':');
+      if (p1 == std::string::npos || p2 == std::string::npos)
+        continue;
+
+      size_t idx1 = boost::lexical_cast<float>(s1.substr(0, p1))*n;
+      size_t idx2 = boost::lexical_cast<float>(s2.substr(0, p2))*n;
+
+      std::string scol1 = s1.substr(p1 + 1);
+      std::string scol2 = s2.substr(p2 + 1);
+      if (scol1.length() < 3 || scol1[0] != '(' ||
+          scol1[scol1.length() - 1] != ')')
+        throw Exception("Bad palette string: " + s);
+      if (scol2.length() < 3 || scol2[0] != '(' ||
+          scol2[scol2.length() - 1] != ')')
+        throw Exception("Bad palette string: " + s);
+
+      scol1 = scol1.substr(1, scol1.length() - 2);
+      scol2 = scol2.substr(1, scol2.length() - 2);
+      GlColor4 col1 = boost::lexical_cast<GlColor4>(scol1);
+      GlColor4 col2 = boost::lexical_cast<GlColor4>(scol2);
+
+      for (size_t j = idx1; j < idx2; ++j) {
+        float alpha = (float)(j - idx1) / (idx2 - idx1);
+        GlColor4 col = (1 - alpha)*col1 + alpha*col2;
+
+        if (type == "hls")
+          col = hlsToRgb(col);
+
+        colors_[j] = col;
+      }
+    }
+  }
+}
@@ -0,0 +1,59 @@
+/** @file palette.h
+ *  @brief Defines a class that maps numbers between 0 and 1 to colors.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GLUTILS_PALETTE_H_
+#define GLUTILS_PALETTE_H_
+
+#include <string>
+#include <vector>
+
+#include "glutils/color.h"
+
+/** @brief A color palette, obtained by interpolating between a set of
+ *  colors.
+ *
+ *  Palettes are described by strings of the form
+ *  "rgb 0:(r,g,b,a) x1:(r,g,b,a) ... 1:(r,g,b,a)", where the interpolation can
+ *  also be done in hue-luminance-saturation space by using "hls" instead of
+ *  "rgb". There are also the named palettes "grayscale" and "thermal".
+ */
+class Palette {
+ public:
+  /// Number of entries in the palette.
+  static const size_t kSize = 256;
+
+  /// Make a black palette.
+  Palette() : colors_(kSize, GlColor4(0, 0, 0)) {}
+
+  /// Make a palette from a description string.
+  explicit Palette(const std::string& s) { set(s); }
+
+  /// Generate the palette from a description string, or a palette name.
+  void set(const std::string& s);
+
+  /// Get the color corresponding to the value @a a between 0 and 1.
+  const GlColor4& getColor(float a) const {
+    if (a < 0)
+      a = 0;
+    if (a > 1)
+      a = 1;
+
+    unsigned idx = a*kSize;
+    if (idx >= kSize)
+      idx = kSize - 1;
+
+    return colors_[idx];
+  }
+
+  /// Get the palette entries.
+  const std::vector<GlColor4>& getColors() const { return colors_; }
+
+ private:
+  void make_(const std::string& s);
+
+  std::vector<GlColor4> colors_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "shader.h"
+
+#include <vector>
+
+static std::string getInfoLog(GLuint label, bool is_program)
+{
+  GLint length = 0;
+  if (is_program)
+    glGetProgramiv(label, GL_INFO_LOG_LENGTH, &length);
+  else
+    glGetShaderiv(label, GL_INFO_LOG_LENGTH, &length);
+
+  if (length <= 0)
+    return std::string();
+
+  std::vector<GLchar> log(length);
+  if (is_program)
+    glGetProgramInfoLog(label, length, 0, &log[0]);
+  else
+    glGetShaderInfoLog(label, length, 0, &log[0]);
+
+  return std::string(&log[0]);
+}
+
+ShaderProgram::ShaderProgram(const std::string& vertex_src,
+    const std::string& fragment_src) : label_(0)
+{
+  GLuint vertex = compile_(GL_VERTEX_SHADER, vertex_src);
+  GLuint fragment;
+  try {
+    fragment = compile_(GL_FRAGMENT_SHADER, fragment_src);
+  }
+  catch (...) {
+    glDeleteShader(vertex);
+    throw;
+  }
+
+  label_ = glCreateProgram();
+  glAttachShader(label_, vertex);
+  glAttachShader(label_, fragment);
+  glLinkProgram(label_);
+
+  // the shaders are only needed until linking is done
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(label_, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    std::string log = getInfoLog(label_, true);
+    glDeleteProgram(label_);
+    throw ShaderError("link failed: " + log);
+  }
+}
+
+ShaderProgram::~ShaderProgram()
+{
+  unuse();
+  glDeleteProgram(label_);
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name)
+{
+  Locations::const_iterator i = locations_.find(name);
+  if (i != locations_.end())
+    return i -> second;
+
+  GLint location = glGetUniformLocation(label_, name.c_str());
+  locations_[name] = location;
+
+  return location;
+}
+
+GLuint ShaderProgram::compile_(GLenum type, const std::string& src)
+{
+  GLuint label = glCreateShader(type);
+  const GLchar* src_ptr = src.c_str();
+  glShaderSource(label, 1, &src_ptr, 0);
+  glCompileShader(label);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(label, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    std::string log = getInfoLog(label, false);
+    glDeleteShader(label);
+    throw ShaderError("compilation failed: " + log);
+  }
+
+  return label;
+}
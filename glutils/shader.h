@@ -0,0 +1,89 @@
+/** @file shader.h
+ *  @brief Defines an RAII wrapper class for GLSL shader programs.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef GLUTILS_SHADER_H_
+#define GLUTILS_SHADER_H_
+
+#include <map>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "glutils/gl_incs.h"
+#include "glutils/gl_state.h"
+#include "utils/exception.h"
+
+/// Exception thrown when a shader fails to compile or link.
+class ShaderError : public Exception {
+ public:
+  /// Constructor.
+  ShaderError(const std::string& arg = std::string()) : Exception(
+    "Shader error" + (arg.empty()?arg:(" (" + arg + ")")) + ".") {}
+};
+
+/** @brief An RAII wrapper for GLSL programs made of a vertex and a fragment
+ *  shader.
+ *
+ *  Uniform locations are looked up once, and then cached.
+ */
+class ShaderProgram : boost::noncopyable {
+ public:
+  /** @brief Compile and link a program from the given sources.
+   *
+   *  Throws @a ShaderError if this fails.
+   */
+  ShaderProgram(const std::string& vertex_src,
+    const std::string& fragment_src);
+
+  /// Destroy the program. This also stops using any program.
+  ~ShaderProgram();
+
+  /// Start using the program.
+  void use() { GlState::useProgram(label_); }
+
+  /// Go back to the fixed-function pipeline.
+  static void unuse() { GlState::useProgram(0); }
+
+  /// Get the location of a uniform, or -1 if the uniform is not active.
+  GLint getUniformLocation(const std::string& name);
+
+  /// @name uniform setters
+  /// These assume the program is in use.
+  // @{
+
+  /// Set a @a float uniform.
+  void setUniform(const std::string& name, float a)
+    { glUniform1f(getUniformLocation(name), a); }
+
+  /// Set a @a vec2 uniform.
+  void setUniform(const std::string& name, float a, float b)
+    { glUniform2f(getUniformLocation(name), a, b); }
+
+  /// Set a @a vec3 uniform.
+  void setUniform(const std::string& name, float a, float b, float c)
+    { glUniform3f(getUniformLocation(name), a, b, c); }
+
+  /// Set a @a vec4 uniform.
+  void setUniform(const std::string& name, float a, float b, float c,
+      float d)
+    { glUniform4f(getUniformLocation(name), a, b, c, d); }
+
+  // @}
+  // (uniform setters)
+
+  /// Get the integer label for the program.
+  GLuint getLabel() const { return label_; }
+
+ protected:
+  typedef std::map<std::string, GLint> Locations;
+
+  /// Compile a shader of the given type, returning its label.
+  static GLuint compile_(GLenum type, const std::string& src);
+
+  GLuint      label_;
+  Locations   locations_;
+};
+
+#endif
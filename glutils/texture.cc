@@ -1,6 +1,7 @@
 #include "texture.h"
 
-Texture::Texture(unsigned width, unsigned height)
+Texture::Texture(unsigned width, unsigned height) : width_(width),
+  height_(height)
 {
   generate_();
   bind();
@@ -9,32 +9,41 @@
 #include <boost/noncopyable.hpp>
 
 #include "glutils/gl_incs.h"
+#include "glutils/gl_state.h"
 
 class Texture : boost::noncopyable {
  public:
   /// Make a new texture.
-  Texture() { generate_(); }
+  Texture() : width_(0), height_(0) { generate_(); }
 
   // XXX this probably needs a lot more options..
   /// Make a new texture of the given size. This binds the texture.
   Texture(unsigned width, unsigned height);
 
   /// Destroy the texture.
-  ~Texture() { glDeleteTextures(1, &label_); }
+  ~Texture()
+    { glDeleteTextures(1, &label_); GlState::textureDeleted(label_); }
 
   /// Bind the texture.
-  void bind() { glBindTexture(GL_TEXTURE_2D, label_); }
+  void bind() { GlState::bindTexture(label_); }
 
   /// Unbind any texture.
-  static void unbind() { glBindTexture(GL_TEXTURE_2D, 0); }
+  static void unbind() { GlState::bindTexture(0); }
 
   /// Get the integer label for this texture.
   GLuint getLabel() const { return label_; }
 
+  /// Get the width the texture was created with.
+  unsigned getWidth() const { return width_; }
+  /// Get the height the texture was created with.
+  unsigned getHeight() const { return height_; }
+
  protected:
   void generate_() { glGenTextures(1, &label_); }
 
   GLuint      label_;
+  unsigned    width_;
+  unsigned    height_;
 };
 
 #endif
@@ -1,6 +1,43 @@
 #include "vbo.h"
 
-Vbo::Vbo(unsigned size) : label_(0), size_(0), auto_resize_(1)
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// glMapBufferRange is part of OpenGL 3.0; older drivers might still have it
+// through ARB_map_buffer_range. Having the entry point in the headers says
+// nothing about the driver, so this has to be checked at run time.
+bool hasMapBufferRange()
+{
+  const char* version = (const char*)glGetString(GL_VERSION);
+  if (version && std::atoi(version) >= 3)
+    return true;
+
+  const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+  if (!extensions)
+    return false;
+
+  // the extension names are separated by spaces, and some of them are
+  // prefixes of others
+  const char* name = "GL_ARB_map_buffer_range";
+  const size_t length = std::strlen(name);
+  for (const char* p = std::strstr(extensions, name); p;
+       p = std::strstr(p + length, name))
+  {
+    if ((p == extensions || p[-1] == ' ') &&
+        (p[length] == ' ' || p[length] == 0))
+      return true;
+  }
+
+  return false;
+}
+
+} // anonymous namespace
+
+Vbo::Vbo(unsigned size, bool streaming) : label_(0), size_(0),
+    auto_resize_(1), streaming_(streaming), can_map_(hasMapBufferRange()),
+    cursor_(0)
 {
   glGenBuffers(1, &label_);
   bind();
@@ -17,6 +54,35 @@ void Vbo::resize(size_t size)
 {
   bind();
   // XXX make GL_DYNAMIC_DRAW configurable?
-  glBufferData(GL_ARRAY_BUFFER, size, 0, GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, size, 0,
+    streaming_?GL_STREAM_DRAW:GL_DYNAMIC_DRAW);
   size_ = size;
+  cursor_ = 0;
+}
+
+void Vbo::orphan()
+{
+  // giving the driver a null pointer lets it hand us new storage while the
+  // GPU is still using the old one
+  resize(size_);
+}
+
+void Vbo::write_(size_t offset, size_t size, const void* data)
+{
+#ifdef GL_MAP_UNSYNCHRONIZED_BIT
+  // we never write over data that might still be in use (we orphan instead),
+  // so there's no need for the driver to synchronize
+  if (can_map_) {
+    void* dest = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+      GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dest) {
+      std::memcpy(dest, data, size);
+      if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE)
+        return;
+    }
+  }
+#endif
+  // fall back to the regular upload path
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
 }
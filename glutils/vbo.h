@@ -6,27 +6,41 @@
 #ifndef GLUTILS_VBO_H_
 #define GLUTILS_VBO_H_
 
+#include <iterator>
+
 #include <boost/noncopyable.hpp>
 
 #include "glutils/gl_incs.h"
+#include "glutils/gl_state.h"
 #include "utils/exception.h"
 
 /** @brief An RAII wrapper for vertex buffer objects (VBOs).
  *
  *  You can enable auto-resizing, when the VBO grows automatically if more
  *  data needs to be sent to it. @see setAutoResize()
+ *
+ *  A VBO can also be created in streaming mode. In this case @a draw does not
+ *  overwrite the beginning of the buffer every time; instead, each batch of
+ *  data is appended after the previous one, using unsynchronized writes. When
+ *  the buffer fills up, its storage is orphaned, and writing starts again from
+ *  the beginning of a fresh allocation. This way uploads never have to wait
+ *  for the GPU to finish using earlier data, and a single streaming VBO can be
+ *  shared by all the objects that draw dynamic data. @see stream()
  */
 class Vbo : boost::noncopyable {
  public:
-  /// Create new VBO of given size (in bytes). This also binds the VBO.
-  explicit Vbo(unsigned size);
+  /** @brief Create new VBO of given size (in bytes). This also binds the VBO.
+   *
+   *  Set @a streaming to @a true to create a streaming VBO.
+   */
+  explicit Vbo(unsigned size, bool streaming = false);
   /// Destroy the VBO. This also unbinds any VBO.
   ~Vbo();
 
   /// Bind the VBO.
-  void bind() { glBindBuffer(GL_ARRAY_BUFFER, label_); }
+  void bind() { GlState::bindArrayBuffer(label_); }
   /// Unbind any VBO.
-  static void unbind() { glBindBuffer(GL_ARRAY_BUFFER, 0); }
+  static void unbind() { GlState::bindArrayBuffer(0); }
 
   /// Send the data to the VBO. This binds the VBO.
   template <class Iterator>
@@ -48,63 +62,78 @@ class Vbo : boost::noncopyable {
   void update(const Container& data, size_t offset = 0)
     { update(data.begin(), data.end(), offset); }
 
+  /** @brief Append the data to the VBO, without waiting for the GPU. This
+   *  binds the VBO.
+   *
+   *  Returns the offset (in bytes) where the data was stored. If there isn't
+   *  enough space left after the data that was sent previously, the buffer's
+   *  storage is orphaned and the data is written at the beginning. This is
+   *  what @a draw uses for streaming VBOs, but it can be used for any VBO.
+   */
+  template <class Iterator>
+  size_t stream(Iterator begin, Iterator end) {
+    bind();
+    size_t content_size = (end - begin)*sizeof(*begin);
+    if (content_size > size_) {
+      if (auto_resize_) {
+        resize(content_size);
+      } else {
+        throw Exception("VBO stream too large for the buffer.");
+      }
+    } else if (cursor_ + content_size > size_) {
+      orphan();
+    }
+
+    size_t offset = cursor_;
+    if (content_size > 0) {
+      write_(offset, content_size, &(*begin));
+      cursor_ += content_size;
+    }
+
+    return offset;
+  }
+
   /// Get the integer label for the VBO.
   GLuint getLabel() const { return label_; }
 
   /** @brief Update the VBO, and draw it in the given @a mode.
    *
    *  Use a non-zero @a offset to start writing at a different position in the
-   *  buffer than the beginning.
+   *  buffer than the beginning. The @a offset is ignored for streaming VBOs,
+   *  which always append the data after what was sent previously.
    *
-   *  The object pointed to by the iterator should have two member structs,
-   *  @a vertexInfo, and @a textureInfo; each of these should have
-   *  members @a n, @a size, and @a type. @a n is the number of components for
-   *  either vertices or texture coordinates; @a size is the size of all the
-   *  components, in bytes; and @a type is the OpenGL typedef for the data
-   *  type of the components. See the @a VboInfo template for an easy way
-   *  to create the @a vertexInfo and @a textureInfo members.
+   *  The object pointed to by the iterator should have three static member
+   *  structs, @a vertexInfo, @a textureInfo, and @a colorInfo; each of these
+   *  should have members @a n, @a size, and @a type. @a n is the number of
+   *  components for vertices, texture coordinates, or colors; @a size is the
+   *  size of all the components, in bytes; and @a type is the OpenGL typedef
+   *  for the data type of the components. See the @a VboInfo template for an
+   *  easy way to create these members.
    */
   template <class Iterator>
   void draw(Iterator begin, Iterator end, GLenum mode, GLint offset = 0)
   {
-    bind();
-    update(begin, end, offset);
-
-    GLsizei stride = begin -> vertexInfo.size +
-      begin -> textureInfo.size + begin -> colorInfo.size;
-    size_t vertexOffset = 0;
-    size_t textureOffset = begin -> vertexInfo.size;
-    size_t colorOffset = textureOffset + begin -> textureInfo.size;
-
-    if (begin -> vertexInfo.n > 0) {
-      glVertexPointer(begin -> vertexInfo.n, begin -> vertexInfo.type,
-        stride, (char*)0 + vertexOffset);
-      glEnableClientState(GL_VERTEX_ARRAY);
-    }
-    if (begin -> textureInfo.n > 0) {
-      glTexCoordPointer(begin -> textureInfo.n, begin -> textureInfo.type,
-        stride, (char*)0 + textureOffset);
-      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    }
-    if (begin -> colorInfo.n > 0) {
-      glColorPointer(begin -> colorInfo.n, begin -> colorInfo.type,
-        stride, (char*)0 + colorOffset);
-      glEnableClientState(GL_COLOR_ARRAY);
-    }
-
-    glDrawArrays(mode, offset, (end - begin));
-
-    if (begin -> colorInfo.n > 0) {
-      glDisableClientState(GL_COLOR_ARRAY);
-    }
-    if (begin -> textureInfo.n > 0) {
-      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    }
-    if (begin -> vertexInfo.n > 0) {
-      glDisableClientState(GL_VERTEX_ARRAY);
+    typedef typename std::iterator_traits<Iterator>::value_type Vertex;
+
+    if (streaming_) {
+      size_t base = stream(begin, end);
+      drawAt_<Vertex>(mode, end - begin, 0, base);
+    } else {
+      update(begin, end, offset);
+      drawStored<Vertex>(mode, end - begin, offset);
     }
   }
 
+  /** @brief Draw data that was already sent to the VBO, in the given @a mode.
+   *
+   *  This does not upload anything; it draws @a count vertices of type
+   *  @a Vertex, starting with vertex number @a first. Use this together with
+   *  @a update to draw geometry that does not change from frame to frame.
+   */
+  template <class Vertex>
+  void drawStored(GLenum mode, GLsizei count, GLint first = 0)
+    { drawAt_<Vertex>(mode, count, first, 0); }
+
   /** @brief Update the VBO, and draw it in the given @a mode.
    *
    *  See the other @a draw function for details.
@@ -124,10 +153,64 @@ class Vbo : boost::noncopyable {
   /// Set whether the VBO auto-resizes upon an update that would overflow.
   void setAutoResize(bool b) { auto_resize_ = b; }
 
+  /// Return whether this is a streaming VBO.
+  bool isStreaming() const { return streaming_; }
+
+  /** @brief Orphan the storage of the VBO, replacing it with a fresh one of
+   *  the same size. Data that was sent before is lost.
+   */
+  void orphan();
+
  protected:
+  /** @brief Write data at the given offset without synchronizing with the
+   *  GPU, if the driver supports @a glMapBufferRange.
+   */
+  void write_(size_t offset, size_t size, const void* data);
+
+  /** @brief Draw @a count vertices starting with vertex number @a first, with
+   *  the data starting at byte offset @a base in the buffer.
+   */
+  template <class Vertex>
+  void drawAt_(GLenum mode, GLsizei count, GLint first, size_t base)
+  {
+    bind();
+
+    GLsizei stride = Vertex::vertexInfo.size + Vertex::textureInfo.size +
+      Vertex::colorInfo.size;
+    size_t vertexOffset = 0;
+    size_t textureOffset = Vertex::vertexInfo.size;
+    size_t colorOffset = textureOffset + Vertex::textureInfo.size;
+
+    // the client arrays are left in the state needed for this vertex type;
+    // the state tracker filters out the toggles between similar draws
+    if (Vertex::vertexInfo.n > 0) {
+      glVertexPointer(Vertex::vertexInfo.n, Vertex::vertexInfo.type,
+        stride, (char*)0 + base + vertexOffset);
+    }
+    if (Vertex::textureInfo.n > 0) {
+      glTexCoordPointer(Vertex::textureInfo.n, Vertex::textureInfo.type,
+        stride, (char*)0 + base + textureOffset);
+    }
+    if (Vertex::colorInfo.n > 0) {
+      glColorPointer(Vertex::colorInfo.n, Vertex::colorInfo.type,
+        stride, (char*)0 + base + colorOffset);
+    }
+    GlState::setClientState(GL_VERTEX_ARRAY, Vertex::vertexInfo.n > 0);
+    GlState::setClientState(GL_TEXTURE_COORD_ARRAY,
+      Vertex::textureInfo.n > 0);
+    GlState::setClientState(GL_COLOR_ARRAY, Vertex::colorInfo.n > 0);
+
+    GlState::drawArrays(mode, first, count);
+  }
+
   GLuint          label_;
   size_t          size_;
   bool            auto_resize_;
+  bool            streaming_;
+  /// Whether the driver has @a glMapBufferRange.
+  bool            can_map_;
+  /// Position in the buffer where streaming continues.
+  size_t          cursor_;
 };
 
 #endif
@@ -20,13 +20,24 @@ class BaseInput {
 
   /** @brief Copies the current window into @a dest.
    *
-   *  Should return 0 for success. To be implemented by descendants.
+   *  The total number of samples that went through the window up to its end
+   *  is stored in @a count; this is taken together with the samples, so the
+   *  two always match. Should return 0 for success. To be implemented by
+   *  descendants.
    */
-  virtual int copyWindow(float* dest) const = 0;
+  virtual int copyWindow(float* dest, unsigned long long& count) const = 0;
 
   /// Get window size.
   unsigned getWindowSize() const { return win_size_; }
 
+  /** @brief Get the total number of samples that went through the window
+   *  since the input was initialized.
+   *
+   *  This is used to find out how many of the samples in the window are new
+   *  since the last time it was copied. To be implemented by descendants.
+   */
+  virtual unsigned long long getSampleCount() const = 0;
+
   /** @brief Initialize the sound input.
    *
    *  Return @a true for success.
@@ -2,13 +2,14 @@
 
 #include <cmath>
 
-int FakeInput::copyWindow(float* dest) const
+int FakeInput::copyWindow(float* dest, unsigned long long& count) const
 {
   const float omega = 2*M_PI*freq_;
 
   unsigned sz = getWindowSize();
   const float dt = 1.0/getSamplingFrequency();
   const float t = timer_.getElapsed();
+  count = t*getSamplingFrequency();
   phi_ += omega*t;
   phi_ = phi_ - 2*M_PI*std::floor(phi_/(2*M_PI));
   for (unsigned i = 0; i < sz; ++i) {
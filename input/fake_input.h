@@ -17,7 +17,11 @@ class FakeInput : public BaseInput {
     amp_(1), phi_(0) {}
 
   /// Implement the function that copies the current window into @a dest.
-  virtual int copyWindow(float* dest) const;
+  virtual int copyWindow(float* dest, unsigned long long& count) const;
+
+  /// The fake input generates samples in real time.
+  virtual unsigned long long getSampleCount() const
+    { return timer_.getElapsed()*getSamplingFrequency(); }
 
   /// Set the wave's frequency.
   void setFrequency(float f) { freq_ = f; }
@@ -4,11 +4,16 @@
 
 #include <cmath>
 
-int PaInput::copyWindow(float* dest) const
+#include <boost/thread/locks.hpp>
+
+int PaInput::copyWindow(float* dest, unsigned long long& count) const
 {
   const unsigned size = getWindowSize();
-  // just in case the portaudio callback runs in a different thread...
-  unsigned pointer = pointer_;
+  // the portaudio callback runs in a different thread, so the samples and
+  // their count have to be taken together
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  const unsigned pointer = pointer_;
+  count = count_;
 
   unsigned s_dest;
   unsigned s_src;
@@ -28,6 +33,12 @@ int PaInput::copyWindow(float* dest) const
   return 0;
 }
 
+unsigned long long PaInput::getSampleCount() const
+{
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  return count_;
+}
+
 bool PaInput::init()
 {
   // resize the buffer, and fill it with zeros
@@ -83,6 +94,7 @@ void PaInput::prepareData()
   data_.resize(buf_size, 0);
 
   pointer_ = 0;
+  count_ = 0;
 }
 
 int PaInput::callback(const void* buffer_v, void*, unsigned long frames,
@@ -91,6 +103,7 @@ int PaInput::callback(const void* buffer_v, void*, unsigned long frames,
   PaInput* obj = (PaInput*)obj_v;
   const float* buffer = (const float*)buffer_v;
 
+  boost::lock_guard<boost::mutex> lock(obj -> mutex_);
   if (buffer) {
     std::copy(buffer, buffer + frames, obj -> data_.begin() + obj -> pointer_);
   } else {
@@ -102,6 +115,7 @@ int PaInput::callback(const void* buffer_v, void*, unsigned long frames,
   const size_t sz = obj -> data_.size();
   if (obj -> pointer_ >= sz)
     obj -> pointer_ -= sz;
+  obj -> count_ += frames;
 
   return paContinue;
 }
@@ -8,6 +8,7 @@
 
 #include <vector>
 
+#include <boost/thread/mutex.hpp>
 #include <portaudio.h>
 
 #include "input/base_input.h"
@@ -57,11 +58,14 @@ class PaInput : public BaseInput {
    *  callback.
    */
   explicit PaInput(unsigned size, unsigned resolution = 512) : BaseInput(size),
-    res_(resolution), pointer_(0), stream_(0) { }
+    res_(resolution), pointer_(0), count_(0), stream_(0) { }
 
   /// Implement the function that copies the current window into @a dest.
-  virtual int copyWindow(float* dest) const;
-  
+  virtual int copyWindow(float* dest, unsigned long long& count) const;
+
+  /// Get the number of samples received from PortAudio.
+  virtual unsigned long long getSampleCount() const;
+
   /// Implement the initialization code.
   virtual bool init();
 
@@ -76,7 +80,11 @@ class PaInput : public BaseInput {
   unsigned            res_;
   std::vector<float>  data_;
   unsigned            pointer_;
+  unsigned long long  count_;
   PaStream*           stream_;
+  /// Guards the buffer, @a pointer_, and @a count_, which the PortAudio
+  /// callback changes from its own thread.
+  mutable boost::mutex  mutex_;
 };
 
 #endif
@@ -1,22 +1,53 @@
 #include "interface/spectrum.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
 #include "animation/transition_store.h"
 #include "display/base_display.h"
+#include "display/graph_program.h"
 #include "display/oscilloscope.h"
+#include "display/rta_display.h"
 #include "display/spectral_envelope.h"
 #include "display/spectrogram.h"
 #include "glutils/color.h"
 #include "glutils/geometry.h"
+#include "glutils/gl_state.h"
 #include "input/base_input.h"
 #include "input/fake_input.h"
 #include "input/pa_input.h"
+#include "processor/band_levels.h"
 #include "processor/base_processor.h"
 #include "processor/fft.h"
+#include "processor/fft_plan_cache.h"
+#include "processor/filter_bank.h"
 #include "processor/grabber.h"
+#include "processor/processor_factory.h"
+#include "processor/spectral_average.h"
 #include "processor/window_functions.h"
+#include "processor/zoom_fft.h"
 #include "utils/logging.h"
 #include "utils/forward_defs.h"
 
+namespace {
+
+/// Get the name of the processor giving a display its samples.
+std::string getSourceName(const Properties& display_params,
+  const std::string& name)
+{
+  return display_params.get(name + ".source", std::string("input"));
+}
+
+/// Get the name of the ring keeping the samples from a source.
+std::string getRingName(const std::string& source)
+{
+  return (source == "input")?std::string("sample_ring"):(source + "_ring");
+}
+
+} // anonymous namespace
+
 bool SpectrumApp::init()
 {
   if (!properties_)
@@ -24,6 +55,15 @@ bool SpectrumApp::init()
 
   setWidth(properties_ -> get<unsigned>("display.width"));
   setHeight(properties_ -> get<unsigned>("display.height"));
+  setResizable(properties_ -> get("display.resizable", true));
+
+  // set up the frame capture
+  capture_.setFormat(properties_ -> get("capture.format",
+    capture_.getFormatString()));
+  capture_.setPath(properties_ -> get("capture.path", capture_.getPath()));
+  capture_.setFrameRate(properties_ -> get("capture.fps",
+    capture_.getFrameRate()));
+  capture_.setMaxPending(properties_ -> get("capture.max_pending", 8));
 
   Properties& input_params = properties_ -> get_child("input");
   Properties& display_params = properties_ -> get_child("display");
@@ -55,24 +95,12 @@ bool SpectrumApp::init()
   }
   selectInput(input_params.get<std::string>("current"));
 
-  // add the FFT processor
-  FftProcessor* fft = new FftProcessor;
-  addProcessor("fft", BaseProcessorPtr(fft));
-
-  // add a window function
-  // XXX should allow creating of several window functions
-  std::string window_type = properties_->get<std::string>("processors.window");
-  if (window_type == "gaussian") {
-    GaussianWindow* window = new GaussianWindow;
-    window -> setProperties(&(properties_->get_child("processors.gaussian")));
-    window -> addInput("input", &input_);
-    addProcessor("window", BaseProcessorPtr(window));
-  } else {
-    throw Exception("Unrecognized window function (" + window_type + ").");
-  }
-
-  // set the input for the FFT processor
-  fft -> addInput("input", &(*processors_["window"]));
+  // build the processing chain described in the settings; the grabber is
+  // available to it as "input", but it is owned by us
+  Processors processors;
+  processors["input"] = BaseProcessorPtr(&input_, NullDeleter());
+  ProcessorFactory factory;
+  factory.build(properties_ -> get_child("processors.graph"), processors);
 
   // create the transition store
   transitions_ = boost::make_shared<TransitionStore>();
@@ -93,25 +121,104 @@ bool SpectrumApp::init()
       display = BaseSdlDisplayPtr(oscilloscope);
     } else if (*i == "spectral") {
       SpectralEnvelope* spectral_envelope = new SpectralEnvelope;
-      spectral_envelope -> addInput("fft", fft);
 
        display = BaseSdlDisplayPtr(spectral_envelope);
     } else if (*i == "spectrogram") {
       Spectrogram* spectrogram = new Spectrogram;
-      spectrogram -> addInput("fft", fft);
 
        display = BaseSdlDisplayPtr(spectrogram);
+    } else if (*i == "rta") {
+      RtaDisplay* rta = new RtaDisplay;
+
+      display = BaseSdlDisplayPtr(rta);
     } else {
       throw Exception("Unknown display module (" + (*i) + ").");
     }
 
     display -> setProperties(&(display_params.get_child(*i)));
     display -> setTransitionStore(transitions_);
-    display -> addInput("raw", &input_);
     addDisplay(*i, display);
   }
+
+  // add the windows, FFTs, and band levels that the displays asked for;
+  // identical requests share the same processors
+  makeFftRequests_(display_params);
+  factory.build(fft_requests_, processors);
+  processors.erase("input");
+  for (Processors::const_iterator i = processors.begin();
+        i != processors.end();
+        ++i)
+  {
+    addProcessor(i -> first, i -> second);
+  }
+
+  // all the FFTs share their plans
+  fft_plans_ = boost::make_shared<FftPlanCache>();
+  for (Processors::const_iterator i = processors_.begin();
+        i != processors_.end();
+        ++i)
+  {
+    FftProcessor* fft = dynamic_cast<FftProcessor*>(&(*(i -> second)));
+    if (fft)
+      fft -> setPlanCache(fft_plans_);
+    ZoomFft* zoom = dynamic_cast<ZoomFft*>(&(*(i -> second)));
+    if (zoom)
+      zoom -> setPlanCache(fft_plans_);
+    FilterBank* filter_bank = dynamic_cast<FilterBank*>(&(*(i -> second)));
+    if (filter_bank)
+      filter_bank -> setPlanCache(fft_plans_);
+  }
+
+  connectDisplays_(display_params);
+  scheduleProcessors_();
+
   selectDisplay(display_params.get<std::string>("current"));
 
+  // read the layout used in tiled mode
+  tiled_ = display_params.get("layout.tiled", false);
+  boost::optional<Properties&> layout =
+    display_params.get_child_optional("layout");
+  if (layout) {
+    for (Properties::const_iterator i = layout -> begin();
+          i != layout -> end();
+          ++i)
+    {
+      if (i -> first != "view")
+        continue;
+
+      View view;
+      view.display = i -> second.get<std::string>("display");
+      if (displays_.find(view.display) == displays_.end())
+        throw Exception("Unknown display in layout (" + view.display + ").");
+      view.region.start = i -> second.get("start", GlVertex2(0, 0));
+      view.region.end = i -> second.get("end", GlVertex2(1, 1));
+      view.width = view.height = 0;
+      view.dirty = true;
+      views_.push_back(view);
+    }
+  }
+  if (tiled_ && views_.empty()) {
+    logger::info << "The layout has no views, showing one display at a time."
+                 << std::endl;
+    tiled_ = false;
+  }
+
+  // otherwise, each display gets a view covering the whole window
+  if (!tiled_) {
+    views_.clear();
+    for (SdlDisplays::const_iterator i = displays_.begin();
+          i != displays_.end();
+          ++i)
+    {
+      View view;
+      view.display = i -> first;
+      view.region = Rectangle(0, 0, 1, 1);
+      view.width = view.height = 0;
+      view.dirty = true;
+      views_.push_back(view);
+    }
+  }
+
   // initialize the inputs
   for (InputChoices::iterator i = input_choices_.begin();
         i != input_choices_.end();
@@ -129,24 +236,13 @@ bool SpectrumApp::initGl()
   // XXX maybe I should separate this into different functions
   logger::detail << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
 
-  // setup the viewport
-  glViewport(0, 0, scr_w_, scr_h_);
-
-  // setup the projection matrix
-  // make normalized device coordinates identical to eye coordinates
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-//  glOrtho(0, scr_w_, 0, scr_h_, -1, 1);
-  gluOrtho2D(0, scr_w_, 0, scr_h_);
-
-  // setup the model matrix
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+  // setup the viewport and the projection
+  setProjection_(scr_w_, scr_h_);
 
   glClearColor(0, 0, 0, 1);
 
   // need alpha blending for some animations
-  glEnable(GL_BLEND);
+  GlState::enable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
   // set up the display region.
@@ -156,20 +252,39 @@ bool SpectrumApp::initGl()
     transitions_ -> get("open"));
   animator_.doTransition(&display_opacity_, 0, 1, transitions_ -> get("open"));
 
-  // initialize the VBO
-  const size_t vbo_size = 10*sizeof(GlVertex2);
-  vbo_.reset(new Vbo(vbo_size));
-  vbo_ -> setAutoResize(false); // get notified if this isn't large enough
+  // initialize the streaming VBO that is shared by all the displays
+  // XXX make this configurable?
+  const size_t vbo_size = 1 << 20;
+  vbo_.reset(new Vbo(vbo_size, true));
+
+  // set up the shaders that draw graph-space data, if possible
+  if (properties_ -> get("display.shaders", true)) {
+    try {
+      graph_program_.reset(new GraphProgram);
+      marker_program_.reset(new MarkerProgram);
+    }
+    catch (const ShaderError& e) {
+      logger::info << e.what() << " Drawing without shaders." << std::endl;
+    }
+  }
+
+  // the render targets of the app and of the displays come from a shared
+  // pool, so that they can be reused when the window is resized
+  // XXX make the number of spare FBOs configurable?
+  fbo_pool_.reset(new FboPool(2*views_.size() + 4));
 
-  // initialize a framebuffer object
-  fbo_.reset(new Fbo(scr_w_, scr_h_));
+  // size the views and the displays
+  layoutViews_();
 
   // initialize the displays
   for (SdlDisplays::const_iterator i = displays_.begin();
         i != displays_.end();
         ++i)
   {
-    i -> second -> resize(scr_w_, scr_h_);
+    i -> second -> setVbo(vbo_);
+    i -> second -> setFboPool(fbo_pool_);
+    i -> second -> setGraphProgram(graph_program_);
+    i -> second -> setMarkerProgram(marker_program_);
     if (i -> second -> init() != 0)
       return false;
   }
@@ -180,9 +295,69 @@ bool SpectrumApp::initGl()
   return true;
 }
 
+void SpectrumApp::resizeGl()
+{
+  setProjection_(scr_w_, scr_h_);
+
+  // the frames in a capture must all have the same size
+  if (capture_.isCapturing()) {
+    logger::info << "The window was resized, stopping the capture."
+                 << std::endl;
+    capture_.stop();
+  }
+
+  // skip the rest of the opening animation, if it's still running
+  const std::pair<float, BaseEasingPtr> now(0, BaseEasingPtr());
+  animator_.redoTransition(&display_region_, Rectangle(0, 0, scr_w_, scr_h_),
+    now);
+
+  layoutViews_();
+}
+
+void SpectrumApp::layoutViews_()
+{
+  // each view caches the rendering of its display in an FBO of its own size
+  // XXX a display shown in several views is sized for the first one
+  std::map<std::string, GlVertex2> sizes;
+  for (Views::iterator i = views_.begin(); i != views_.end(); ++i) {
+    const unsigned w = std::max(1.0f,
+      (i -> region.end.x - i -> region.start.x)*scr_w_ + 0.5f);
+    const unsigned h = std::max(1.0f,
+      (i -> region.end.y - i -> region.start.y)*scr_h_ + 0.5f);
+    if (!i -> fbo || w != i -> width || h != i -> height) {
+      fbo_pool_ -> release(i -> fbo);
+      i -> fbo = fbo_pool_ -> acquire(w, h);
+      i -> width = w;
+      i -> height = h;
+      i -> dirty = true;
+    }
+    if (sizes.find(i -> display) == sizes.end())
+      sizes[i -> display] = GlVertex2(w, h);
+  }
+
+  for (SdlDisplays::const_iterator i = displays_.begin();
+        i != displays_.end();
+        ++i)
+  {
+    std::map<std::string, GlVertex2>::const_iterator j = sizes.find(i -> first);
+    if (j != sizes.end())
+      i -> second -> resize(j -> second.x, j -> second.y);
+    else
+      i -> second -> resize(scr_w_, scr_h_);
+  }
+}
+
 void SpectrumApp::cleanup()
 {
   updateProperties();
+  capture_.stop();
+
+  const std::vector<std::string> order = graph_.getOrder();
+  for (size_t i = 0; i < order.size(); ++i) {
+    logger::debug << "Processor " << order[i] << " ran "
+                  << graph_.getExecutionCount(order[i]) << " times, skipped "
+                  << graph_.getSkipCount(order[i]) << " times." << std::endl;
+  }
 
   // clean up the displays
   for (SdlDisplays::const_iterator i = displays_.begin();
@@ -192,6 +367,13 @@ void SpectrumApp::cleanup()
     i -> second -> done();
   }
 
+  // free the render targets while the OpenGL context is still around
+  for (Views::iterator i = views_.begin(); i != views_.end(); ++i) {
+    fbo_pool_ -> release(i -> fbo);
+    i -> fbo.reset();
+  }
+  fbo_pool_ -> clear();
+
   // clean up the inputs
   for (InputChoices::const_iterator i = input_choices_.begin();
         i != input_choices_.end();
@@ -240,6 +422,18 @@ void SpectrumApp::handleEvent(SDL_Event* event)
           handled = true;
         }
         break;
+      case SDLK_c:
+        if (event -> key.keysym.mod == 0) {
+          flipCapture();
+          handled = true;
+        }
+        break;
+      case SDLK_v:
+        if (event -> key.keysym.mod == 0) {
+          resetAverages();
+          handled = true;
+        }
+        break;
       case SDLK_i:
         if (event -> key.keysym.mod == 0) {
           chooseNextInput();
@@ -261,6 +455,8 @@ void SpectrumApp::handleEvent(SDL_Event* event)
   SdlDisplays::const_iterator i0 = i;
   do {
     handled = i -> second -> handleEvent(event);
+    if (handled)
+      invalidateViews_(i -> first);
     ++i;
     if (i == displays_.end())
       i = displays_.begin();
@@ -275,80 +471,555 @@ void SpectrumApp::render()
   // update the animations
   animator_.update();
 
-  // let all the processors know that a new display cycle started
-  for (Processors::const_iterator j = processors_.begin();
-        j != processors_.end();
+  // run the processors for the new display cycle; the input is grabbed, and
+  // the FFT is run, at most once per cycle, and only if new samples came in;
+  // the results are shared by all the displays
+  graph_.run();
+
+  // let all the displays keep up with the data, even the hidden ones
+  for (SdlDisplays::const_iterator j = displays_.begin();
+        j != displays_.end();
         ++j)
   {
-    j -> second -> invalidateCache();
+    j -> second -> accumulate();
   }
 
-  SdlDisplays::const_iterator i1 = displays_.find(current_display_.target);
-  if (i1 == displays_.end()) {
-    logger::error << "Display not found, " << current_display_.target << "."
-                  << std::endl;
-  }
+  drawViews_();
 
-  const float eps = 1e-6;
-  float opacity1 = current_display_.progress;
-  if (1 - opacity1 >= eps) {
-    // we need to do some blending
-    SdlDisplays::const_iterator i2 = displays_.find(current_display_.initial);
-    if (i2 == displays_.end()) {
-      logger::error << "Display not found, " << current_display_.initial << "."
-                    << std::endl;
-    }
-    drawDisplay(i2 -> second, 1 - opacity1, true);
-    drawDisplay(i1 -> second, opacity1, false);
-  } else {
-    drawDisplay(i1 -> second, opacity1, true);
-  }
+  // reading back the frame doesn't wait for the GPU
+  capture_.capture();
 
   swapBuffers();
 
+  // keep track of the OpenGL work done per frame
+  GlState::newFrame();
+  // XXX make the reporting interval configurable
+  if (stats_timer_.getElapsed() >= 5) {
+    const GlState::Stats& stats = GlState::getLastFrameStats();
+    logger::debug << "OpenGL per frame: " << stats.draw_calls
+                  << " draw calls, " << stats.state_changes
+                  << " state changes, " << stats.redundant
+                  << " redundant state changes filtered." << std::endl;
+    stats_timer_.reset();
+  }
+
   // don't eat up unnecessary time
   microDelay(2000);
 }
 
-void SpectrumApp::drawDisplay(const BaseSdlDisplayPtr& display, float opac,
-  bool clear)
+void SpectrumApp::drawViews_()
 {
-  // draw in FBO
-  fbo_ -> bind();
-  glClear(GL_COLOR_BUFFER_BIT);
+  // choose the views to show, in order, and how opaque they should be
+  std::vector<std::pair<size_t, float> > shown;
+  const float progress = current_display_.progress;
+  if (tiled_) {
+    for (size_t i = 0; i < views_.size(); ++i)
+      shown.push_back(std::make_pair(i, display_opacity_));
+  } else {
+    const float eps = 1e-6;
+    if (1 - progress >= eps) {
+      // we need to do some blending
+      shown.push_back(std::make_pair(findView_(current_display_.initial),
+        (1 - progress)*display_opacity_));
+    }
+    shown.push_back(std::make_pair(findView_(current_display_.target),
+      progress*display_opacity_));
+  }
 
-  display -> draw();
+  // find out which displays changed before drawing any of them, since
+  // drawing can reset the state
+  std::set<std::string> changed;
+  std::vector<bool> visible(views_.size(), false);
+  for (size_t k = 0; k < shown.size(); ++k) {
+    if (shown[k].first >= views_.size())
+      continue;
+    const View& view = views_[shown[k].first];
+    visible[shown[k].first] = true;
+    if (displays_.find(view.display) -> second -> hasChanged())
+      changed.insert(view.display);
+  }
 
-  // switch back to display
-  Fbo::unbind();
+  // redraw the views that need it; hidden views fall behind, so they have to
+  // be redrawn when they are shown again
+  for (size_t i = 0; i < views_.size(); ++i) {
+    View& view = views_[i];
+    if (!visible[i]) {
+      view.dirty = true;
+      continue;
+    }
+    if (!view.dirty && changed.find(view.display) == changed.end())
+      continue;
 
-  // draw the FBO to screen
-  if (clear)
+    view.fbo -> bind();
+    setProjection_(view.width, view.height);
     glClear(GL_COLOR_BUFFER_BIT);
 
-  glEnable(GL_TEXTURE_2D);
-  fbo_ -> getTexture() -> bind();
-  opac *= display_opacity_;
+    displays_.find(view.display) -> second -> draw();
+    view.dirty = false;
+  }
+  Fbo::unbind();
+  setProjection_(scr_w_, scr_h_);
+
+  // composite the cached renderings on screen
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  const GlVertex2& s = display_region_.start;
+  const GlVertex2 size = display_region_.end - s;
+
+  // the two views of a transition cover the same region, so they can be
+  // mixed in one go
+  if (!tiled_ && shown.size() == 2 && shown[0].first < views_.size() &&
+      shown[1].first < views_.size())
+  {
+    const View& initial = views_[shown[0].first];
+    const View& target = views_[shown[1].first];
+    drawCrossFade_(*initial.fbo -> getTexture(), *target.fbo -> getTexture(),
+      Rectangle(s.x, s.y, s.x + size.x, s.y + size.y),
+      GlVertex2(target.width, target.height), progress, display_opacity_);
+    return;
+  }
+
+  for (size_t k = 0; k < shown.size(); ++k) {
+    if (shown[k].first >= views_.size())
+      continue;
+    const View& view = views_[shown[k].first];
+    const Rectangle r(s.x + view.region.start.x*size.x,
+                      s.y + view.region.start.y*size.y,
+                      s.x + view.region.end.x*size.x,
+                      s.y + view.region.end.y*size.y);
+    drawTexture_(*view.fbo -> getTexture(), r,
+      GlVertex2(view.width, view.height), shown[k].second);
+  }
+}
+
+size_t SpectrumApp::findView_(const std::string& display) const
+{
+  for (size_t i = 0; i < views_.size(); ++i) {
+    if (views_[i].display == display)
+      return i;
+  }
+
+  logger::error << "Display not found, " << display << "." << std::endl;
+  return views_.size();
+}
+
+void SpectrumApp::drawTexture_(Texture& tex, const Rectangle& r,
+  const GlVertex2& size, float opac)
+{
+  // only the bottom-left corner of pooled textures is used
+  const float u = size.x / tex.getWidth();
+  const float v = size.y / tex.getHeight();
+
+  GlState::enable(GL_TEXTURE_2D);
+  tex.bind();
   setGlColor(GlColor4(opac, opac, opac, opac));
 
   // fill the VBO
   std::vector<GlVertexTex2> points_tex;
 
-  float x1 = display_region_.start.x;
-  float y1 = display_region_.start.y;
-  float x2 = display_region_.end.x;
-  float y2 = display_region_.end.y;
+  float x1 = r.start.x;
+  float y1 = r.start.y;
+  float x2 = r.end.x;
+  float y2 = r.end.y;
   points_tex.push_back(GlVertexTex2(x1, y1, 0, 0));
-  points_tex.push_back(GlVertexTex2(x2, y1, 1, 0));
-  points_tex.push_back(GlVertexTex2(x2, y2, 1, 1));
-  points_tex.push_back(GlVertexTex2(x1, y2, 0, 1));
+  points_tex.push_back(GlVertexTex2(x2, y1, u, 0));
+  points_tex.push_back(GlVertexTex2(x2, y2, u, v));
+  points_tex.push_back(GlVertexTex2(x1, y2, 0, v));
 
   // select the texture
   glClientActiveTexture(GL_TEXTURE0);
 
   // send the data to OpenGL
   vbo_ -> draw(points_tex, GL_QUADS);
+  GlState::disable(GL_TEXTURE_2D);
+}
+
+void SpectrumApp::drawCrossFade_(Texture& initial, Texture& target,
+  const Rectangle& r, const GlVertex2& size, float progress, float opac)
+{
+  // the pooled textures can have different sizes, so the coordinates for the
+  // target are generated from the vertex positions
+  const float u = size.x / target.getWidth();
+  const float v = size.y / target.getHeight();
+  const float w = r.end.x - r.start.x;
+  const float h = r.end.y - r.start.y;
+  const GLfloat s_plane[] = { u/w, 0, 0, -r.start.x*u/w };
+  const GLfloat t_plane[] = { 0, v/h, 0, -r.start.y*v/h };
+
+  // the target goes on the second texture unit; GlState only keeps track of
+  // the first one, so this is set up directly
+  glActiveTexture(GL_TEXTURE1);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, target.getLabel());
+  glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+  glTexGenfv(GL_S, GL_OBJECT_PLANE, s_plane);
+  glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+  glTexGenfv(GL_T, GL_OBJECT_PLANE, t_plane);
+  glEnable(GL_TEXTURE_GEN_S);
+  glEnable(GL_TEXTURE_GEN_T);
+
+  // ...where it only applies the opacity to what the first unit mixed
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_MODULATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_PRIMARY_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_PRIMARY_COLOR);
+
+  // the first unit mixes the target with the initial texture
+  const GLfloat mix[] = { 0, 0, 0, progress };
+  glActiveTexture(GL_TEXTURE0);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_INTERPOLATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_INTERPOLATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE1);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_TEXTURE1);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_TEXTURE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_TEXTURE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE2_RGB, GL_CONSTANT);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE2_ALPHA, GL_CONSTANT);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_RGB, GL_SRC_ALPHA);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_ALPHA, GL_SRC_ALPHA);
+  glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, mix);
+
+  // the rest is as in drawTexture_
+  drawTexture_(initial, r, size, opac);
+
+  // back to the usual state
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glActiveTexture(GL_TEXTURE1);
+  glDisable(GL_TEXTURE_GEN_S);
+  glDisable(GL_TEXTURE_GEN_T);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
   glDisable(GL_TEXTURE_2D);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void SpectrumApp::setProjection_(unsigned w, unsigned h)
+{
+  glViewport(0, 0, w, h);
+
+  // make normalized device coordinates identical to eye coordinates
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  gluOrtho2D(0, w, 0, h);
+
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+}
+
+void SpectrumApp::makeFftRequests_(const Properties& display_params)
+{
+  fft_requests_.clear();
+
+  // the FFTs that are longer than the input buffer get their samples from a
+  // ring shared by the displays with the same source, which has to fit the
+  // longest of them; the zoom FFTs read the ring's history, which has to fit
+  // the most samples any of them uses
+  typedef std::map<std::string, std::pair<unsigned, unsigned> > RingSizes;
+  RingSizes rings;
+  for (SdlDisplays::const_iterator i = displays_.begin();
+        i != displays_.end();
+        ++i)
+  {
+    const std::string& name = i -> first;
+    const unsigned size = display_params.get(name + ".fft_size", 0u);
+    const bool zoom = usesZoomFft_(display_params, name);
+    if (size == 0 && !zoom)
+      continue;
+
+    std::pair<unsigned, unsigned>& ring = rings[getSourceName(display_params,
+      name)];
+    ring.first = std::max(ring.first, size);
+    if (zoom) {
+      ring.second = std::max(ring.second,
+        display_params.get(name + ".zoom_max_samples", 262144u));
+    }
+  }
+
+  for (RingSizes::const_iterator i = rings.begin(); i != rings.end(); ++i) {
+    const std::string& source = i -> first;
+    Properties& ring = fft_requests_.add("node", "");
+    ring.put("name", getRingName(source));
+    ring.put("type", "ring");
+    ring.add("input", source + ".output").put("<xmlattr>.port", "input");
+    ring.add("input", source + ".details").put("<xmlattr>.port", "details");
+    ring.put("settings.length", i -> second.first);
+    ring.put("settings.history", i -> second.second);
+  }
+
+  for (SdlDisplays::const_iterator i = displays_.begin();
+        i != displays_.end();
+        ++i)
+  {
+    const std::string& name = i -> first;
+    const unsigned size = display_params.get(name + ".fft_size", 0u);
+    const std::string ring = getRingName(getSourceName(display_params, name));
+
+    if (usesAverage_(display_params, name))
+      makeAverageRequest_(display_params, name);
+
+    if (usesZoomFft_(display_params, name)) {
+      Properties& zoom = fft_requests_.add("node", "");
+      zoom.put("name", name + "_zoom");
+      zoom.put("type", "zoom_fft");
+      zoom.add("input", ring + ".history").put("<xmlattr>.port", "history");
+      zoom.add("input", ring + ".details").put("<xmlattr>.port", "details");
+      zoom.put("settings.max_samples",
+        display_params.get(name + ".zoom_max_samples", 262144u));
+      // keep the magnitudes on the same scale as the fixed-size FFT
+      zoom.put("settings.reference_size",
+        (size > 0)?size:getInput() -> getWindowSize());
+      continue;
+    }
+
+    if (i -> second -> hasInput("levels"))
+      makeBandsRequest_(display_params, name);
+
+    // the other displays, like the spectrogram, run their own FFTs
+    const bool uses_fft = i -> second -> hasInput("fft") ||
+      i -> second -> hasInput("levels");
+    if (size == 0 || !uses_fft)
+      continue;
+
+    Properties& window = fft_requests_.add("node", "");
+    window.put("name", name + "_window");
+    window.put("type", display_params.get(name + ".fft_window",
+      std::string("gaussian")));
+    window.add("input", ring + ".output").put("<xmlattr>.port", "input");
+    window.put("settings.size", size);
+
+    Properties& fft = fft_requests_.add("node", "");
+    fft.put("name", name + "_fft");
+    fft.put("type", "fft");
+    fft.add("input", name + "_window.output").put("<xmlattr>.port", "input");
+  }
+}
+
+void SpectrumApp::makeAverageRequest_(const Properties& display_params,
+  const std::string& name)
+{
+  Properties& average = fft_requests_.add("node", "");
+  average.put("name", name + "_average");
+  average.put("type", "average");
+  average.add("input", getSpectrumName_(display_params, name, false) +
+    ".output").put("<xmlattr>.port", "fft");
+  average.add("input", getSourceName(display_params, name) + ".details").put(
+    "<xmlattr>.port", "details");
+  average.put_child("settings", display_params.get_child(name + ".average"));
+}
+
+void SpectrumApp::makeBandsRequest_(const Properties& display_params,
+  const std::string& name)
+{
+  Properties& bands = fft_requests_.add("node", "");
+  bands.put("name", name + "_bands");
+  bands.put("type", "bands");
+  bands.add("input", getSpectrumName_(display_params, name, true) +
+    ".output").put("<xmlattr>.port", "fft");
+  bands.add("input", getSourceName(display_params, name) + ".details").put(
+    "<xmlattr>.port", "details");
+  bands.put("settings.fraction", display_params.get(name + ".fraction", 3u));
+  bands.put("settings.low", display_params.get(name + ".low", 20.0f));
+  bands.put("settings.high", display_params.get(name + ".high", 20000.0f));
+  bands.put("settings.weighting", display_params.get(name + ".weighting",
+    std::string("A")));
+  bands.put("settings.window_power", display_params.get(name +
+    ".window_power", 1.0f));
+}
+
+void SpectrumApp::connectDisplays_(const Properties& display_params)
+{
+  own_windows_.clear();
+  for (SdlDisplays::const_iterator i = displays_.begin();
+        i != displays_.end();
+        ++i)
+  {
+    const std::string& name = i -> first;
+    BaseSdlDisplay& display = *(i -> second);
+
+    // displays that asked for their own FFT size use the processors made
+    // for them; the others name the ones they use
+    const bool own_fft = (display_params.get(name + ".fft_size", 0u) > 0);
+    const bool zoom = usesZoomFft_(display_params, name);
+    if (display.hasInput("fft")) {
+      display.connect("fft", getProcessor_(getSpectrumName_(display_params,
+        name, true)), "output");
+    }
+
+    SpectralEnvelope* spectral = dynamic_cast<SpectralEnvelope*>(&display);
+    if (spectral && zoom) {
+      spectral -> setZoomFft(dynamic_cast<ZoomFft*>(
+        &getProcessor_(name + "_zoom")));
+    }
+
+    if (display.hasInput("levels")) {
+      BaseProcessor& bands = getProcessor_(name + "_bands");
+      display.connect("levels", bands, "levels");
+      display.connect("bands", bands, "bands");
+    }
+
+    RtaDisplay* rta = dynamic_cast<RtaDisplay*>(&display);
+    if (rta) {
+      rta -> setBandLevels(dynamic_cast<BandLevels*>(
+        &getProcessor_(name + "_bands")));
+    }
+
+    // the spectrogram runs its own FFTs, at fixed intervals in sample time,
+    // so it only borrows the coefficients of a window function; with its own
+    // FFT size, it gets a window that is not part of the graph
+    Spectrogram* spectrogram = dynamic_cast<Spectrogram*>(&display);
+    if (spectrogram) {
+      GenericWindow* window_function = 0;
+      std::string window_name;
+      if (own_fft) {
+        window_name = display_params.get(name + ".fft_window",
+          std::string("gaussian"));
+        own_windows_[name] = ProcessorFactory().create(window_name);
+        window_function = dynamic_cast<GenericWindow*>(
+          own_windows_[name].get());
+      } else {
+        window_name = display_params.get(name + ".window",
+          std::string("window"));
+        window_function = dynamic_cast<GenericWindow*>(
+          &getProcessor_(window_name));
+      }
+      if (!window_function)
+        throw Exception("Processor " + window_name + " is not a window "
+          "function.");
+      spectrogram -> setWindowFunction(window_function);
+      spectrogram -> setPlanCache(fft_plans_);
+    }
+
+    // the samples come from the grabber, unless the display names another
+    // processor with the same outputs, like a resampler
+    const std::string source_name = getSourceName(display_params, name);
+    BaseProcessor& source = (source_name == "input")?
+      static_cast<BaseProcessor&>(input_):getProcessor_(source_name);
+    if (display.hasInput("raw"))
+      display.connect("raw", source, "output");
+    if (display.hasInput("details"))
+      display.connect("details", source, "details");
+    display.checkInputs();
+  }
+}
+
+void SpectrumApp::scheduleProcessors_()
+{
+  // find the processors that some display depends on
+  std::set<BaseProcessor*> used;
+  std::vector<BaseProcessor*> to_visit;
+  for (SdlDisplays::const_iterator i = displays_.begin();
+        i != displays_.end();
+        ++i)
+  {
+    const std::vector<BaseProcessor*> sources = i -> second -> getSources();
+    to_visit.insert(to_visit.end(), sources.begin(), sources.end());
+  }
+  while (!to_visit.empty()) {
+    BaseProcessor* processor = to_visit.back();
+    to_visit.pop_back();
+    if (!used.insert(processor).second)
+      continue;
+
+    const std::vector<BaseProcessor*> sources = processor -> getSources();
+    to_visit.insert(to_visit.end(), sources.begin(), sources.end());
+  }
+
+  // schedule those, starting with the grabber; processors that are shared by
+  // several nodes are only scheduled once
+  graph_.clear();
+  graph_.add("input", &input_);
+  std::set<BaseProcessor*> scheduled;
+  for (Processors::const_iterator i = processors_.begin();
+        i != processors_.end();
+        ++i)
+  {
+    BaseProcessor* processor = &(*(i -> second));
+    if (!scheduled.insert(processor).second)
+      continue;
+
+    if (used.count(processor) > 0) {
+      graph_.add(i -> first, processor);
+    } else {
+      logger::info << "Processor " << i -> first << " is not used by any "
+                   << "display, so it won't be run." << std::endl;
+    }
+  }
+  graph_.setThreads(properties_ -> get("processors.threads", 1u));
+  graph_.build();
+}
+
+bool SpectrumApp::usesZoomFft_(const Properties& display_params,
+  const std::string& name) const
+{
+  SdlDisplays::const_iterator i = displays_.find(name);
+  return i != displays_.end() && i -> second -> hasInput("fft") &&
+    dynamic_cast<SpectralEnvelope*>(&(*(i -> second))) != 0 &&
+    display_params.get(name + ".zoom", false);
+}
+
+bool SpectrumApp::usesAverage_(const Properties& display_params,
+  const std::string& name) const
+{
+  SdlDisplays::const_iterator i = displays_.find(name);
+  return i != displays_.end() && (i -> second -> hasInput("fft") ||
+    i -> second -> hasInput("levels")) &&
+    trim(display_params.get(name + ".average.mode", std::string("none"))) !=
+    "none";
+}
+
+std::string SpectrumApp::getSpectrumName_(const Properties& display_params,
+  const std::string& name, bool averaged) const
+{
+  if (averaged && usesAverage_(display_params, name))
+    return name + "_average";
+  else if (usesZoomFft_(display_params, name))
+    return name + "_zoom";
+  else if (display_params.get(name + ".fft_size", 0u) > 0)
+    return name + "_fft";
+  else
+    return display_params.get(name + ".fft", std::string("fft"));
+}
+
+BaseProcessor& SpectrumApp::getProcessor_(const std::string& name) const
+{
+  Processors::const_iterator i = processors_.find(name);
+  if (i == processors_.end())
+    throw Exception("Unknown processor: " + name +
+      " (SpectrumApp::getProcessor_).");
+  return *(i -> second);
+}
+
+void SpectrumApp::invalidateViews_(const std::string& display)
+{
+  for (Views::iterator i = views_.begin(); i != views_.end(); ++i) {
+    if (i -> display == display)
+      i -> dirty = true;
+  }
+}
+
+void SpectrumApp::resetAverages()
+{
+  for (Processors::const_iterator i = processors_.begin();
+        i != processors_.end();
+        ++i)
+  {
+    SpectralAverage* average = dynamic_cast<SpectralAverage*>(
+      &(*(i -> second)));
+    if (average)
+      average -> reset();
+  }
+  logger::info << "Restarted the spectral averages." << std::endl;
+}
+
+void SpectrumApp::flipCapture()
+{
+  if (capture_.isCapturing())
+    capture_.stop();
+  else
+    capture_.start(scr_w_, scr_h_);
 }
 
 void SpectrumApp::chooseNextInput()
@@ -377,6 +1048,13 @@ void SpectrumApp::updateProperties()
 {
   properties_ -> put("input.current", input_name_);
   properties_ -> put("display.current", current_display_.target);
+  properties_ -> put("display.width", scr_w_);
+  properties_ -> put("display.height", scr_h_);
+  properties_ -> put("display.layout.tiled", tiled_);
+  properties_ -> put("capture.format", capture_.getFormatString());
+  properties_ -> put("capture.path", capture_.getPath());
+  properties_ -> put("capture.fps", capture_.getFrameRate());
+  properties_ -> put("processors.threads", graph_.getThreads());
 
   for (InputChoices::iterator i = input_choices_.begin();
         i != input_choices_.end();
@@ -8,21 +8,30 @@
 
 #include <vector>
 
-#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "animation/animator.h"
 #include "glutils/fbo.h"
+#include "glutils/fbo_pool.h"
+#include "glutils/frame_capture.h"
 #include "glutils/geometry.h"
 #include "glutils/vbo.h"
+#include "processor/fft_plan_cache.h"
 #include "processor/grabber.h"
+#include "processor/processor_graph.h"
 #include "sdl/sdl_app.h"
 #include "utils/exception.h"
 #include "utils/forward_defs.h"
+#include "utils/misc.h"
 #include "utils/properties.h"
 
 /** @brief The spectrum application class.
  *
  *  This is an OpenGL application that handles various visualizations for sound.
+ *  It either shows one display at a time, or, in tiled mode, several views
+ *  at once, each of them in its own region of the window. Each view keeps the
+ *  rendering of its display in an FBO, which is only redrawn when the display
+ *  changed; transitions between displays just blend the cached renderings.
  */
 class SpectrumApp : public SdlGlApp {
  public:
@@ -30,13 +39,15 @@ class SpectrumApp : public SdlGlApp {
   typedef std::map<std::string, BaseInputPtr> InputChoices;
 
   /// Constructor.
-  SpectrumApp() : properties_(0), display_region_(0, 0, 640, 480),
-      display_opacity_(1) {}
+  SpectrumApp() : properties_(0), tiled_(false),
+      display_region_(0, 0, 640, 480), display_opacity_(1) {}
 
   /// Overriding the initialization routine.
   virtual bool init();
   /// Overriding the OpenGL initialization.
   virtual bool initGl();
+  /// Overriding the reaction to window size changes.
+  virtual void resizeGl();
 
   /// Overriding the cleanup routine.
   virtual void cleanup();
@@ -47,8 +58,14 @@ class SpectrumApp : public SdlGlApp {
   /// Overriding the rendering routine.
   virtual void render();
 
-  /// Draw one display on screen.
-  void drawDisplay(const BaseSdlDisplayPtr& display, float opac, bool clear);
+  /// Start or stop recording the frames drawn on screen.
+  void flipCapture();
+
+  /// Start all the spectral averages again.
+  void resetAverages();
+
+  /// Find out whether all the views are shown at once.
+  bool isTiled() const { return tiled_; }
 
   /// Select an input module.
   void selectInput(const std::string& name) {
@@ -102,6 +119,9 @@ class SpectrumApp : public SdlGlApp {
   /// Access the processors.
   const Processors& getProcessors() const { return processors_; }
 
+  /// Access the schedule of the processors.
+  const ProcessorGraph& getProcessorGraph() const { return graph_; }
+
   /// Give the app access to its settings.
   void setProperties(Properties* props) { properties_ = props; }
 
@@ -109,23 +129,115 @@ class SpectrumApp : public SdlGlApp {
   void updateProperties();
 
  private:
+  /// A display shown in a region of the window.
+  struct View {
+    /// Name of the display.
+    std::string             display;
+    /// Region covered, as fractions of the display region.
+    Rectangle               region;
+    /// Cached rendering of the display.
+    FboPool::FboPtr         fbo;
+    /// Size of the FBO, in pixels.
+    unsigned                width;
+    unsigned                height;
+    /// Whether the FBO needs to be redrawn, whatever the display says.
+    bool                    dirty;
+  };
+  typedef std::vector<View> Views;
+
   void chooseNextInput();
   void choosePreviousInput();
 
+  /// Draw the visible views, redrawing the ones whose display changed.
+  void drawViews_();
+  /// Find the first view showing the given display.
+  size_t findView_(const std::string& display) const;
+  /// Find a processor by name. Throws if it doesn't exist.
+  BaseProcessor& getProcessor_(const std::string& name) const;
+  /// Describe the windows and FFTs that the displays need for the FFT sizes
+  /// they ask for, the zoom FFTs, and the band levels.
+  void makeFftRequests_(const Properties& display_params);
+  /// Add a request for the processor averaging the spectra used by a
+  /// display.
+  void makeAverageRequest_(const Properties& display_params,
+    const std::string& name);
+  /// Add a request for the processor finding the band levels shown by a
+  /// display.
+  void makeBandsRequest_(const Properties& display_params,
+    const std::string& name);
+  /// Find out whether a display gets its spectrum from a zoom FFT that
+  /// follows its visible band.
+  bool usesZoomFft_(const Properties& display_params,
+    const std::string& name) const;
+  /// Find out whether a display averages its spectra.
+  bool usesAverage_(const Properties& display_params,
+    const std::string& name) const;
+  /** @brief Get the name of the processor giving a display its spectrum.
+   *
+   *  With @a averaged false, this is the processor before the average, if
+   *  there is one.
+   */
+  std::string getSpectrumName_(const Properties& display_params,
+    const std::string& name, bool averaged) const;
+  /// Connect the displays to the processors they use.
+  void connectDisplays_(const Properties& display_params);
+  /// Schedule the processors that the displays depend on.
+  void scheduleProcessors_();
+  /** @brief Draw the bottom-left @a size pixels of a texture, covering the
+   *  rectangle @a r.
+   */
+  void drawTexture_(Texture& tex, const Rectangle& r, const GlVertex2& size,
+    float opac);
+  /** @brief Draw two textures mixed in proportion to @a progress, in a
+   *  single pass.
+   *
+   *  This is like drawing both with @a drawTexture_, except that the mix is
+   *  exact, and the pixels are only drawn once.
+   */
+  void drawCrossFade_(Texture& initial, Texture& target, const Rectangle& r,
+    const GlVertex2& size, float progress, float opac);
+  /// Size the views' FBOs and the displays to fit the window.
+  void layoutViews_();
+  /// Set up the viewport and the projection for a target of the given size.
+  static void setProjection_(unsigned w, unsigned h);
+  /// Force the views showing the given display to be redrawn.
+  void invalidateViews_(const std::string& display);
+
   InputChoices                  input_choices_;
   std::string                   input_name_;
   Grabber                       input_;
   Processors                    processors_;
+  ProcessorGraph                graph_;
+  /// Processors added for the FFT sizes requested by the displays.
+  Properties                    fft_requests_;
+  /// Window functions of the displays that run their own FFTs, by display;
+  /// these are not part of the graph.
+  Processors                    own_windows_;
+  FftPlanCachePtr               fft_plans_;
   SdlDisplays                   displays_;
-  boost::scoped_ptr<Vbo>        vbo_;
-  boost::scoped_ptr<Fbo>        fbo_;
+  /// Streaming VBO shared by the app and all the displays.
+  VboPtr                        vbo_;
+  /// Shader program shared by the displays, if shaders are available.
+  GraphProgramPtr               graph_program_;
+  /// Shader program for markers, if shaders are available.
+  MarkerProgramPtr              marker_program_;
+  /// Pool of render targets shared by the app and all the displays.
+  FboPoolPtr                    fbo_pool_;
   DiscreteAnimated<std::string> current_display_;
   Properties*                   properties_;
+  bool                          tiled_;
+  Views                         views_;
 
   Rectangle                     display_region_;
   float                         display_opacity_;
   Animator                      animator_;
   TransitionStorePtr            transitions_;
+
+  /// Records the frames drawn on screen, when asked to.
+  FrameCapture                  capture_;
+
+  /// Timer used to periodically report rendering statistics.
+  Timer                         stats_timer_;
 };
 
 #endif
@@ -0,0 +1,185 @@
+#include "processor/band_levels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "utils/exception.h"
+#include "utils/misc.h"
+
+namespace {
+
+template <class T>
+inline T sqr(T x)
+{
+  return x*x;
+}
+
+} // anonymous namespace
+
+BandLevels::BandLevels() : fraction_(3), low_(20), high_(20000),
+    weighting_(Z_WEIGHTING), window_power_(1), n_bins_(0), start_(0),
+    step_(0), rate_(0), levels_output_(this, levels_),
+    bands_output_(this, bands_)
+{
+  registerInput_("fft", &fft_);
+  registerInput_("details", &details_);
+  registerOutput_("levels", &levels_output_);
+  registerOutput_("bands", &bands_output_);
+
+  setBands(fraction_, low_, high_);
+}
+
+void BandLevels::setBands(unsigned fraction, float low, float high)
+{
+  fraction_ = std::max(fraction, 1u);
+  low_ = low;
+  high_ = high;
+  bands_ = getOctaveBands(fraction_, low_, high_);
+  levels_.assign(bands_.size(), 0);
+
+  // the weights have to be recalculated
+  n_bins_ = 0;
+  markStale();
+}
+
+void BandLevels::setWeighting(Weighting w)
+{
+  weighting_ = w;
+  n_bins_ = 0;
+  markStale();
+}
+
+BandLevels::Weighting BandLevels::getWeighting(const std::string& name)
+{
+  if (name == "A" || name == "a")
+    return A_WEIGHTING;
+  else if (name == "C" || name == "c")
+    return C_WEIGHTING;
+  else if (name == "Z" || name == "z")
+    return Z_WEIGHTING;
+  else
+    throw Exception("Unknown frequency weighting: " + name +
+      " (BandLevels::getWeighting).");
+}
+
+std::string BandLevels::getWeightingName(Weighting w)
+{
+  switch (w) {
+    case A_WEIGHTING: return "A";
+    case C_WEIGHTING: return "C";
+    default: return "Z";
+  }
+}
+
+float BandLevels::getWeightingGain(Weighting w, float f)
+{
+  if (w == Z_WEIGHTING)
+    return 1;
+  if (f <= 0)
+    return 0;
+
+  // the pole frequencies from IEC 61672, and the offsets that make the gain
+  // one at 1 kHz
+  const double f2 = sqr((double)f);
+  const double c = sqr(12194.0)*f2/((f2 + sqr(20.6))*(f2 + sqr(12194.0)));
+  if (w == C_WEIGHTING)
+    return sqr(c)*std::pow(10.0, 0.062/10);
+
+  const double a = c*f2/std::sqrt((f2 + sqr(107.7))*(f2 + sqr(737.9)));
+  return sqr(a)*std::pow(10.0, 2.0/10);
+}
+
+int BandLevels::init()
+{
+  if (properties_) {
+    setBands(properties_ -> get("fraction", fraction_),
+      properties_ -> get("low", low_), properties_ -> get("high", high_));
+    setWeighting(getWeighting(trim(properties_ -> get("weighting",
+      getWeightingName(weighting_)))));
+    setWindowPower(properties_ -> get("window_power", window_power_));
+  }
+
+  return 0;
+}
+
+void BandLevels::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("fraction", fraction_);
+    properties_ -> put("low", low_);
+    properties_ -> put("high", high_);
+    properties_ -> put("weighting", getWeightingName(weighting_));
+    properties_ -> put("window_power", window_power_);
+  }
+}
+
+int BandLevels::execute()
+{
+  const FftProcessor::OutputStruct& fft = fft_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+
+  if (fft.n_bins != n_bins_ || fft.start != start_ || fft.step != step_ ||
+      details.samplingFrequency != rate_)
+  {
+    buildWeights_(fft, details.samplingFrequency);
+  }
+
+  // power in each bin; for a one-sided spectrum, this makes the levels mean
+  // squares of the signal
+  const float norm = (fft.size > 0)?(2/(sqr((float)fft.size)*
+    window_power_)):0;
+  power_.resize(fft.n_bins);
+  for (unsigned i = 0; i < fft.n_bins; ++i)
+    power_[i] = std::norm(fft.fft[i])*norm;
+
+  for (size_t i = 0; i < bands_.size(); ++i) {
+    float sum = 0;
+    for (unsigned j = band_starts_[i]; j < band_starts_[i + 1]; ++j)
+      sum += weights_[j]*power_[bins_[j]];
+    levels_[i] = sum;
+  }
+
+  markValid();
+  return 0;
+}
+
+void BandLevels::buildWeights_(const FftProcessor::OutputStruct& fft,
+  float rate)
+{
+  n_bins_ = fft.n_bins;
+  start_ = fft.start;
+  step_ = fft.step;
+  rate_ = rate;
+
+  band_starts_.assign(1, 0);
+  bins_.clear();
+  weights_.clear();
+
+  const double first = rate*start_;
+  const double width = rate*step_;
+  for (size_t i = 0; i < bands_.size(); ++i) {
+    if (width > 0 && n_bins_ > 0) {
+      // the bins that overlap the band, each covering half a bin around its
+      // center on both sides
+      const double lo = (bands_[i].low - first)/width - 0.5;
+      const double hi = (bands_[i].high - first)/width + 0.5;
+      const int k0 = std::max((int)std::floor(lo), 0);
+      const int k1 = std::min((int)std::ceil(hi), (int)n_bins_ - 1);
+      for (int k = k0; k <= k1; ++k) {
+        const double f = first + k*width;
+        const double overlap = std::min<double>(f + width/2, bands_[i].high) -
+          std::max<double>(f - width/2, bands_[i].low);
+        if (overlap <= 0)
+          continue;
+
+        const float weight = overlap/width*getWeightingGain(weighting_, f);
+        if (weight <= 0)
+          continue;
+        bins_.push_back(k);
+        weights_.push_back(weight);
+      }
+    }
+    band_starts_.push_back(bins_.size());
+  }
+}
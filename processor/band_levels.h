@@ -0,0 +1,112 @@
+/** @file band_levels.h
+ *  @brief Defines a processor that sums a power spectrum into
+ *  fractional-octave bands.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef BAND_LEVELS_H_
+#define BAND_LEVELS_H_
+
+#include <string>
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/fft.h"
+#include "processor/grabber.h"
+#include "processor/octave_bands.h"
+
+/** @brief Find the levels in fractional-octave bands, from a spectrum.
+ *
+ *  The spectrum is read from the "fft" port, and the sampling rate from the
+ *  "details" port. The "levels" port has the mean square of the signal in
+ *  each band, and the "bands" port has the edges of the bands.
+ *
+ *  Each band's level is a weighted sum over the power in the FFT bins: a bin
+ *  counts in proportion to how much of it overlaps the band, times the power
+ *  gain of the frequency weighting at its center. The weights are kept as a
+ *  sparse matrix, so each cycle only touches the bins that matter; they are
+ *  recalculated only when the size of the FFT or its bins change.
+ *
+ *  The levels are normalized for a window whose mean square is
+ *  @a window_power, 1 being the rectangular window.
+ */
+class BandLevels : public BaseProcessor {
+ public:
+  /// Frequency weightings, from IEC 61672.
+  enum Weighting { Z_WEIGHTING, A_WEIGHTING, C_WEIGHTING };
+
+  /// Constructor.
+  BandLevels();
+
+  /// Use the 1/@a fraction-octave bands with centers between @a low and
+  /// @a high.
+  void setBands(unsigned fraction, float low, float high);
+  /// Get the fraction of an octave covered by each band.
+  unsigned getFraction() const { return fraction_; }
+  /// Get the lowest band center that was asked for.
+  float getLow() const { return low_; }
+  /// Get the highest band center that was asked for.
+  float getHigh() const { return high_; }
+  /// Get the bands.
+  const std::vector<OctaveBand>& getBands() const { return bands_; }
+
+  /// Set the frequency weighting.
+  void setWeighting(Weighting w);
+  /// Get the frequency weighting.
+  Weighting getWeighting() const { return weighting_; }
+
+  /// Set the mean square of the window applied before the FFT.
+  void setWindowPower(float p) { window_power_ = p; }
+  /// Get the mean square of the window applied before the FFT.
+  float getWindowPower() const { return window_power_; }
+
+  /// Get the weighting with the given name ("A", "C", or "Z"). Throws
+  /// @a Exception if there is no such weighting.
+  static Weighting getWeighting(const std::string& name);
+  /// Get the name of a weighting.
+  static std::string getWeightingName(Weighting w);
+  /// Get the power gain of a weighting at frequency @a f, in Hz.
+  static float getWeightingGain(Weighting w, float f);
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Sum the spectrum into the bands.
+  virtual int execute();
+
+ private:
+  /// Calculate the weights of the bins for each band.
+  void buildWeights_(const FftProcessor::OutputStruct& fft, float rate);
+
+  unsigned                            fraction_;
+  float                               low_;
+  float                               high_;
+  Weighting                           weighting_;
+  float                               window_power_;
+  std::vector<OctaveBand>             bands_;
+
+  /// The spectrum the weights were calculated for.
+  unsigned                            n_bins_;
+  double                              start_;
+  double                              step_;
+  float                               rate_;
+  /// Where each band's weights start in @a bins_ and @a weights_; the last
+  /// element is the total number of weights.
+  std::vector<unsigned>               band_starts_;
+  std::vector<unsigned>               bins_;
+  std::vector<float>                  weights_;
+
+  std::vector<float>                  power_;
+  std::vector<float>                  levels_;
+
+  InputPort<FftProcessor::OutputStruct>   fft_;
+  InputPort<Grabber::DetailsStruct>       details_;
+  OutputPort<std::vector<float> >         levels_output_;
+  OutputPort<std::vector<OctaveBand> >    bands_output_;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "processor/base_processor.h"
+
+#include <algorithm>
+
+void BaseProcessor::connect(const std::string& input, BaseProcessor& source,
+  const std::string& output)
+{
+  InputPorts::const_iterator i = input_ports_.find(input);
+  if (i == input_ports_.end())
+    throw PortError("Unknown input port: " + input +
+      " (BaseProcessor::connect).");
+
+  OutputPorts::const_iterator j = source.output_ports_.find(output);
+  if (j == source.output_ports_.end())
+    throw PortError("Unknown output port: " + output +
+      " (BaseProcessor::connect).");
+
+  try {
+    i -> second -> connect(*j -> second);
+  }
+  catch (const PortError&) {
+    throw PortError("Can't connect output " + output + " to input " + input +
+      ", the types don't match (BaseProcessor::connect).");
+  }
+}
+
+void BaseProcessor::checkInputs() const
+{
+  for (InputPorts::const_iterator i = input_ports_.begin();
+        i != input_ports_.end();
+        ++i)
+  {
+    if (!i -> second -> isConnected())
+      throw PortError("Input port " + i -> first + " is not connected "
+        "(BaseProcessor::checkInputs).");
+  }
+}
+
+std::vector<BaseProcessor*> BaseProcessor::getSources() const
+{
+  std::vector<BaseProcessor*> res;
+  for (InputPorts::const_iterator i = input_ports_.begin();
+        i != input_ports_.end();
+        ++i)
+  {
+    const BaseOutputPort* source = i -> second -> getSource();
+    if (!source)
+      continue;
+    BaseProcessor* owner = source -> getOwner();
+    if (std::find(res.begin(), res.end(), owner) == res.end())
+      res.push_back(owner);
+  }
+
+  return res;
+}
+
+int BaseProcessor::run_()
+{
+  unchanged_ = false;
+  const int res = execute();
+  if (!unchanged_)
+    ++version_;
+
+  return res;
+}
@@ -10,42 +10,107 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
-#include <boost/any.hpp>
+#include <boost/noncopyable.hpp>
 
+#include "utils/exception.h"
 #include "utils/properties.h"
 
+/// Exception thrown when processors are connected incorrectly.
+class PortError : public Exception {
+ public:
+  /// Constructor.
+  explicit PortError(const std::string& what) : Exception(what) {}
+};
+
+class BaseProcessor;
+
+/// Base class for the output ports of processors.
+class BaseOutputPort {
+ public:
+  /// Virtual destructor, for inheritance.
+  virtual ~BaseOutputPort() {}
+
+  /// Get the processor that owns the port.
+  BaseProcessor* getOwner() const { return owner_; }
+
+ protected:
+  explicit BaseOutputPort(BaseProcessor* owner) : owner_(owner) {}
+
+  BaseProcessor*  owner_;
+};
+
+/// Base class for the input ports of processors.
+class BaseInputPort {
+ public:
+  /// Virtual destructor, for inheritance.
+  virtual ~BaseInputPort() {}
+
+  /// Connect to an output port. Throws @a PortError if the types don't match.
+  virtual void connect(BaseOutputPort& output) = 0;
+
+  /// Find out whether the port was connected.
+  virtual bool isConnected() const = 0;
+
+  /// Get the output port this is connected to, or null.
+  virtual const BaseOutputPort* getSource() const = 0;
+};
+
 /** @brief This class defines the interface for a signal processor.
  *
  *  A signal processor is a module that takes in buffered input and outputs
- *  processed data. The type of the processed data can vary, as it is returned
- *  in a boost::any. Descendants should have a subtype called Output 
- *  describing the output data type.
- *
- *  The processor can also return more details about itself and the data it
- *  produces in another boost::any returned by getDetails. Descendants should
- *  define the subtype Details describing the output of getDetails.
+ *  processed data. Data flows through typed ports: descendants own
+ *  @a OutputPort members, which give access to their results, and
+ *  @a InputPort members, which read the results of other processors. The
+ *  ports are registered by name in the constructor, and connected once, when
+ *  the processing graph is built; type mismatches are reported at that time.
+ *  Afterwards, reading an input only costs a couple of pointer dereferences.
  *
- *  Descendants can choose to ignore inputs, in which case they are input
- *  modules, ignore or outputs, in which case they are display modules.
+ *  Descendants can choose to have no inputs, in which case they are input
+ *  modules, or no outputs, in which case they are display modules.
  *  Examples of signal processors are a module implementing a certain windowing
  *  function, an input module, a module performing a FFT, a display module, or
  *  a module calculating the most intense frequency in the input stream.
  */
-class BaseProcessor {
+class BaseProcessor : boost::noncopyable {
  public:
   /// Virtual destructor, for inheritance.
   virtual ~BaseProcessor() {}
 
-  /// Add an input to the processor.
-  void addInput(const std::string& name, BaseProcessor* input)
-    { inputs_[name] = input; }
+  /** @brief Connect the input port @a input to the output port @a output of
+   *  the processor @a source.
+   *
+   *  Throws @a PortError if either port doesn't exist, or if their types
+   *  don't match.
+   */
+  void connect(const std::string& input, BaseProcessor& source,
+    const std::string& output);
+
+  /// Find out whether the processor has an input port with the given name.
+  bool hasInput(const std::string& name) const
+    { return input_ports_.count(name) > 0; }
+
+  /// Find out whether the processor has an output port with the given name.
+  bool hasOutput(const std::string& name) const
+    { return output_ports_.count(name) > 0; }
+
+  /// Throw @a PortError if any of the input ports is not connected.
+  void checkInputs() const;
+
+  /// Get the processors that the input ports are connected to, without
+  /// repetitions.
+  std::vector<BaseProcessor*> getSources() const;
 
-  /// Get the output of the processor.
-  boost::any getOutput() { validate(); return getOutput_(); }
+  /// Make sure the module has been executed in this display cycle.
+  void validate() { if (!isValid()) run_(); }
 
-  /// Get details about the processor.
-  boost::any getDetails() { validate(); return getDetails_(); }
+  /** @brief Get a number that changes whenever the output changes.
+   *
+   *  This is increased every time the processor runs, unless it reported
+   *  that its output stayed the same. @see markUnchanged
+   */
+  unsigned long getVersion() const { return version_; }
 
   /** @brief Mark the cached values as invalid.
    *
@@ -58,27 +123,38 @@ class BaseProcessor {
   /// Give the module its settings.
   void setProperties(Properties* props) { properties_ = props; }
 
+  /** @brief Initialize the processor, reading its settings.
+   *
+   *  Should return 0 if successful, nonzero otherwise. By default, this does
+   *  nothing.
+   */
+  virtual int init() { return 0; }
+
   /// Update the settings. Descendants should implement this. @see setProperties
   virtual void updateProperties() {}
 
  protected:
-  typedef std::map<std::string, BaseProcessor*> Inputs;
+  typedef std::map<std::string, BaseInputPort*> InputPorts;
+  typedef std::map<std::string, BaseOutputPort*> OutputPorts;
 
   /** @brief Do the processing. Return zero if successful, non-zero otherwise.
    *
-   *  This is to be implemented by descendants. These can use any of the
-   *  other processors in the @a processors list to do their job. They can also
-   *  use the input module.
+   *  This is to be implemented by descendants. They read their data through
+   *  their input ports, and store the results where their output ports
+   *  point to.
    */
   virtual int execute() = 0;
 
-  /// Get the output of the processor -- should be implemented by descendants.
-  virtual boost::any getOutput_() const = 0;
+  BaseProcessor() : properties_(0), valid_(false), unchanged_(false),
+    stale_(false), version_(0) {}
 
-  /// Get details about the processor -- descendants can override this.
-  virtual boost::any getDetails_() const { return boost::any(); }
+  /// Make an input port available for connections.
+  void registerInput_(const std::string& name, BaseInputPort* port)
+    { input_ports_[name] = port; }
 
-  BaseProcessor() : valid_(false) {}
+  /// Make an output port available for connections.
+  void registerOutput_(const std::string& name, BaseOutputPort* port)
+    { output_ports_[name] = port; }
 
   // check whether the cache is valid
   bool isValid() const { return valid_; }
@@ -86,14 +162,78 @@ class BaseProcessor {
   // mark the cache as valid
   void markValid() { valid_ = true; }
 
-  // make sure the module has been executed
-  void validate() { if (~isValid()) execute(); }
+  /// Call this from @a execute when the output is the same as in the
+  /// previous cycle, so that the processors using it don't need to run.
+  void markUnchanged() { unchanged_ = true; }
+
+  /// Call this when the settings changed, so that the processor runs in the
+  /// next cycle even if its inputs stay the same.
+  void markStale() { stale_ = true; }
 
   Properties*           properties_;
-  Inputs                inputs_;
 
  private:
+  friend class ProcessorGraph;
+
+  // run execute, keeping track of the version of the output
+  int run_();
+
+  InputPorts            input_ports_;
+  OutputPorts           output_ports_;
   bool                  valid_;
+  bool                  unchanged_;
+  bool                  stale_;
+  unsigned long         version_;
+};
+
+/** @brief An output port, giving access to a result of type @a T.
+ *
+ *  The result is stored by the processor that owns the port. Reading it makes
+ *  sure that the processor has run in the current display cycle.
+ */
+template <class T>
+class OutputPort : public BaseOutputPort {
+ public:
+  /// Constructor. @a value is where @a owner stores its result.
+  OutputPort(BaseProcessor* owner, const T& value) : BaseOutputPort(owner),
+    value_(&value) {}
+
+  /// Get the result, running the owner if needed.
+  const T& get() const { owner_ -> validate(); return *value_; }
+
+ private:
+  const T*        value_;
+};
+
+/// An input port, reading a value of type @a T from an output port.
+template <class T>
+class InputPort : public BaseInputPort {
+ public:
+  /// Constructor.
+  InputPort() : source_(0) {}
+
+  /// Connect to an output port of the right type.
+  void connect(const OutputPort<T>& output) { source_ = &output; }
+
+  /// Connect to an output port. Throws @a PortError if the types don't match.
+  virtual void connect(BaseOutputPort& output) {
+    const OutputPort<T>* typed = dynamic_cast<const OutputPort<T>*>(&output);
+    if (!typed)
+      throw PortError("Mismatched port types (InputPort::connect).");
+    source_ = typed;
+  }
+
+  /// Find out whether the port was connected.
+  virtual bool isConnected() const { return source_ != 0; }
+
+  /// Get the output port this is connected to, or null.
+  virtual const BaseOutputPort* getSource() const { return source_; }
+
+  /// Get the value at the other end of the connection.
+  const T& get() const { return source_ -> get(); }
+
+ private:
+  const OutputPort<T>*  source_;
 };
 
 #endif
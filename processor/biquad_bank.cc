@@ -0,0 +1,369 @@
+#include "processor/biquad_bank.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "processor/octave_bands.h"
+#include "utils/exception.h"
+#include "utils/misc.h"
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+/// Number of floats per section and lane: b0, b1, b2, a1, a2, z1, z2.
+const unsigned kSectionSize = 7;
+
+/// Calculate b0, b1, b2, a1, a2, normalized so that a0 = 1.
+void designSection(const BiquadSpec& spec, float rate, double* res)
+{
+  // keep the frequency below Nyquist, where the formulas make sense
+  const double f = std::min<double>(spec.frequency, 0.49*rate);
+  const double w0 = 2*kPi*f/rate;
+  const double cs = std::cos(w0);
+  const double alpha = std::sin(w0)/(2*spec.q);
+  const double a = std::pow(10.0, spec.gain/40.0);
+  const double sq = 2*std::sqrt(a)*alpha;
+
+  double b0, b1, b2, a0, a1, a2;
+  switch (spec.type) {
+    case BiquadSpec::LOWPASS:
+      b0 = b2 = (1 - cs)/2; b1 = 1 - cs;
+      a0 = 1 + alpha; a1 = -2*cs; a2 = 1 - alpha;
+      break;
+    case BiquadSpec::HIGHPASS:
+      b0 = b2 = (1 + cs)/2; b1 = -(1 + cs);
+      a0 = 1 + alpha; a1 = -2*cs; a2 = 1 - alpha;
+      break;
+    case BiquadSpec::BANDPASS:
+      // unit gain at the center
+      b0 = alpha; b1 = 0; b2 = -alpha;
+      a0 = 1 + alpha; a1 = -2*cs; a2 = 1 - alpha;
+      break;
+    case BiquadSpec::NOTCH:
+      b0 = b2 = 1; b1 = -2*cs;
+      a0 = 1 + alpha; a1 = -2*cs; a2 = 1 - alpha;
+      break;
+    case BiquadSpec::PEAK:
+      b0 = 1 + alpha*a; b1 = -2*cs; b2 = 1 - alpha*a;
+      a0 = 1 + alpha/a; a1 = -2*cs; a2 = 1 - alpha/a;
+      break;
+    case BiquadSpec::LOWSHELF:
+      b0 = a*((a + 1) - (a - 1)*cs + sq);
+      b1 = 2*a*((a - 1) - (a + 1)*cs);
+      b2 = a*((a + 1) - (a - 1)*cs - sq);
+      a0 = (a + 1) + (a - 1)*cs + sq;
+      a1 = -2*((a - 1) + (a + 1)*cs);
+      a2 = (a + 1) + (a - 1)*cs - sq;
+      break;
+    case BiquadSpec::HIGHSHELF:
+    default:
+      b0 = a*((a + 1) + (a - 1)*cs + sq);
+      b1 = -2*a*((a - 1) + (a + 1)*cs);
+      b2 = a*((a + 1) + (a - 1)*cs - sq);
+      a0 = (a + 1) - (a - 1)*cs + sq;
+      a1 = 2*((a - 1) - (a + 1)*cs);
+      a2 = (a + 1) - (a - 1)*cs - sq;
+      break;
+  }
+
+  res[0] = b0/a0;
+  res[1] = b1/a0;
+  res[2] = b2/a0;
+  res[3] = a1/a0;
+  res[4] = a2/a0;
+}
+
+/// Run one section over @a n samples for four lanes at once, in place; this
+/// uses the transposed direct form II.
+void runSection(float* c, float* buf, size_t n)
+{
+#ifdef __SSE__
+  const __m128 b0 = _mm_loadu_ps(c);
+  const __m128 b1 = _mm_loadu_ps(c + 4);
+  const __m128 b2 = _mm_loadu_ps(c + 8);
+  const __m128 a1 = _mm_loadu_ps(c + 12);
+  const __m128 a2 = _mm_loadu_ps(c + 16);
+  __m128 z1 = _mm_loadu_ps(c + 20);
+  __m128 z2 = _mm_loadu_ps(c + 24);
+  for (size_t t = 0; t < n; ++t) {
+    const __m128 x = _mm_loadu_ps(buf + 4*t);
+    const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+    z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+    z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+    _mm_storeu_ps(buf + 4*t, y);
+  }
+  _mm_storeu_ps(c + 20, z1);
+  _mm_storeu_ps(c + 24, z2);
+#else
+  float* z1 = c + 20;
+  float* z2 = c + 24;
+  for (size_t t = 0; t < n; ++t) {
+    float* x = buf + 4*t;
+    for (unsigned k = 0; k < 4; ++k) {
+      const float y = c[k]*x[k] + z1[k];
+      z1[k] = c[4 + k]*x[k] - c[12 + k]*y + z2[k];
+      z2[k] = c[8 + k]*x[k] - c[16 + k]*y;
+      x[k] = y;
+    }
+  }
+#endif
+}
+
+/// Average the squares of @a n samples from four lanes into @a levels,
+/// exponentially.
+void accumulateLevels(const float* buf, size_t n, float alpha, float* levels)
+{
+#ifdef __SSE__
+  const __m128 a = _mm_set1_ps(alpha);
+  __m128 p = _mm_loadu_ps(levels);
+  for (size_t t = 0; t < n; ++t) {
+    const __m128 y = _mm_loadu_ps(buf + 4*t);
+    p = _mm_add_ps(p, _mm_mul_ps(a, _mm_sub_ps(_mm_mul_ps(y, y), p)));
+  }
+  _mm_storeu_ps(levels, p);
+#else
+  for (size_t t = 0; t < n; ++t) {
+    for (unsigned k = 0; k < 4; ++k) {
+      const float y = buf[4*t + k];
+      levels[k] += alpha*(y*y - levels[k]);
+    }
+  }
+#endif
+}
+
+} // anonymous namespace
+
+BiquadSpec::Type BiquadSpec::getType(const std::string& name)
+{
+  if (name == "lowpass")
+    return LOWPASS;
+  else if (name == "highpass")
+    return HIGHPASS;
+  else if (name == "bandpass")
+    return BANDPASS;
+  else if (name == "notch")
+    return NOTCH;
+  else if (name == "peak")
+    return PEAK;
+  else if (name == "lowshelf")
+    return LOWSHELF;
+  else if (name == "highshelf")
+    return HIGHSHELF;
+  else
+    throw Exception("Unknown filter type: " + name +
+      " (BiquadSpec::getType).");
+}
+
+BiquadBank::BiquadBank() : output_band_(0), time_constant_(0.125), rate_(0),
+    n_groups_(0), n_sections_(0), last_input_(), output_(this, data_),
+    details_output_(this, last_input_), levels_output_(this, levels_)
+{
+  registerInput_("input", &input_);
+  registerInput_("details", &details_input_);
+  registerOutput_("output", &output_);
+  registerOutput_("details", &details_output_);
+  registerOutput_("levels", &levels_output_);
+}
+
+void BiquadBank::addBand(const BiquadCascade& cascade)
+{
+  bands_.push_back(cascade);
+  design_();
+}
+
+void BiquadBank::addOctaveBands(unsigned fraction, float low, float high,
+  unsigned n_sections)
+{
+  // every section has the bandwidth of the band, so more sections give
+  // steeper skirts, and a slightly narrower band
+  const std::vector<OctaveBand> bands = getOctaveBands(fraction, low, high);
+  for (size_t i = 0; i < bands.size(); ++i) {
+    const float q = bands[i].center/(bands[i].high - bands[i].low);
+    bands_.push_back(BiquadCascade(std::max(n_sections, 1u),
+      BiquadSpec(BiquadSpec::BANDPASS, bands[i].center, q)));
+  }
+  design_();
+}
+
+void BiquadBank::clearBands()
+{
+  bands_.clear();
+  design_();
+}
+
+void BiquadBank::setSamplingFrequency(float rate)
+{
+  if (rate == rate_)
+    return;
+
+  rate_ = rate;
+  design_();
+}
+
+void BiquadBank::reset()
+{
+  for (unsigned i = 0; i < n_groups_*n_sections_; ++i) {
+    float* state = &coeffs_[(i*kSectionSize + 5)*kLanes];
+    std::fill(state, state + 2*kLanes, 0);
+  }
+  std::fill(levels_.begin(), levels_.end(), 0);
+  std::fill(padded_levels_.begin(), padded_levels_.end(), 0);
+}
+
+void BiquadBank::process(const float* data, size_t n, float* out)
+{
+  const bool has_output = (output_band_ < bands_.size());
+  if (out && !has_output)
+    std::copy(data, data + n, out);
+  if (n == 0 || bands_.empty())
+    return;
+
+  // the weight of a new sample in the exponential average
+  const float alpha = (time_constant_ > 0 && rate_ > 0)?
+    (1 - std::exp(-1/(time_constant_*rate_))):1;
+
+  scratch_.resize(n*kLanes);
+  for (unsigned g = 0; g < n_groups_; ++g) {
+    // every band in the group gets the input
+    for (size_t t = 0; t < n; ++t)
+      std::fill(&scratch_[t*kLanes], &scratch_[t*kLanes] + kLanes, data[t]);
+
+    for (unsigned s = 0; s < n_sections_; ++s) {
+      runSection(&coeffs_[(g*n_sections_ + s)*kSectionSize*kLanes],
+        &scratch_[0], n);
+    }
+    accumulateLevels(&scratch_[0], n, alpha, &padded_levels_[g*kLanes]);
+
+    if (out && has_output && output_band_/kLanes == g) {
+      const unsigned lane = output_band_ % kLanes;
+      for (size_t t = 0; t < n; ++t)
+        out[t] = scratch_[t*kLanes + lane];
+    }
+  }
+
+  std::copy(padded_levels_.begin(), padded_levels_.begin() + levels_.size(),
+    levels_.begin());
+}
+
+int BiquadBank::init()
+{
+  if (properties_) {
+    setOutputBand(properties_ -> get("output_band", output_band_));
+    setTimeConstant(properties_ -> get("time_constant", time_constant_));
+
+    // read the bands in the order in which they appear
+    bands_.clear();
+    for (Properties::const_iterator i = properties_ -> begin();
+          i != properties_ -> end();
+          ++i)
+    {
+      const Properties& params = i -> second;
+      if (i -> first == "band") {
+        BiquadCascade cascade;
+        for (Properties::const_iterator j = params.begin();
+              j != params.end();
+              ++j)
+        {
+          if (j -> first != "section")
+            continue;
+
+          BiquadSpec spec;
+          spec.type = BiquadSpec::getType(trim(
+            j -> second.get<std::string>("type")));
+          spec.frequency = j -> second.get<float>("frequency");
+          spec.q = j -> second.get("q", spec.q);
+          spec.gain = j -> second.get("gain", spec.gain);
+          cascade.push_back(spec);
+        }
+        bands_.push_back(cascade);
+      } else if (i -> first == "bank") {
+        addOctaveBands(params.get("fraction", 3u), params.get("low", 20.0f),
+          params.get("high", 20000.0f), params.get("sections", 1u));
+      }
+    }
+    design_();
+  }
+
+  return 0;
+}
+
+void BiquadBank::updateProperties()
+{
+  // the bands are only read
+  if (properties_) {
+    properties_ -> put("output_band", output_band_);
+    properties_ -> put("time_constant", time_constant_);
+  }
+}
+
+int BiquadBank::execute()
+{
+  const std::vector<float>& input = input_.get();
+  const Grabber::DetailsStruct& details = details_input_.get();
+
+  // find the samples that are new since the last cycle; restart if some were
+  // missed, or if the input went back or changed its rate
+  const size_t n_input = input.size();
+  size_t n_new = n_input;
+  if (details.samplingFrequency != rate_ || details.end < last_input_.end ||
+      details.end - last_input_.end > n_input)
+  {
+    setSamplingFrequency(details.samplingFrequency);
+    reset();
+    data_.assign(n_input, 0);
+  } else {
+    n_new = details.end - last_input_.end;
+  }
+  last_input_ = details;
+
+  if (n_new == 0 && data_.size() == n_input) {
+    markUnchanged();
+    markValid();
+    return 0;
+  }
+
+  // shift the window, and filter the new samples into its end
+  data_.resize(n_input, 0);
+  std::copy(data_.begin() + n_new, data_.end(), data_.begin());
+  if (n_new > 0)
+    process(&input[n_input - n_new], n_new, &data_[n_input - n_new]);
+
+  markValid();
+  return 0;
+}
+
+void BiquadBank::design_()
+{
+  n_groups_ = (bands_.size() + kLanes - 1)/kLanes;
+  n_sections_ = 0;
+  for (size_t i = 0; i < bands_.size(); ++i)
+    n_sections_ = std::max<unsigned>(n_sections_, bands_[i].size());
+
+  // the sections missing from shorter cascades pass the signal through,
+  // and the lanes without a band give zeros; this also clears the states
+  coeffs_.assign(n_groups_*n_sections_*kSectionSize*kLanes, 0);
+  for (size_t i = 0; i < bands_.size(); ++i) {
+    const unsigned group = i/kLanes;
+    const unsigned lane = i % kLanes;
+    for (unsigned s = 0; s < n_sections_; ++s) {
+      float* c = &coeffs_[(group*n_sections_ + s)*kSectionSize*kLanes + lane];
+      if (s >= bands_[i].size() || rate_ <= 0) {
+        c[0] = 1;
+        continue;
+      }
+
+      double res[5];
+      designSection(bands_[i][s], rate_, res);
+      for (unsigned k = 0; k < 5; ++k)
+        c[k*kLanes] = res[k];
+    }
+  }
+
+  levels_.assign(bands_.size(), 0);
+  padded_levels_.assign(n_groups_*kLanes, 0);
+}
@@ -0,0 +1,158 @@
+/** @file biquad_bank.h
+ *  @brief Defines a bank of IIR filters, each a cascade of second-order
+ *  sections.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef BIQUAD_BANK_H_
+#define BIQUAD_BANK_H_
+
+#include <string>
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/grabber.h"
+
+/// The parameters of a second-order IIR section.
+struct BiquadSpec {
+  /// The shapes of filters, following the Audio EQ Cookbook.
+  enum Type { LOWPASS, HIGHPASS, BANDPASS, NOTCH, PEAK, LOWSHELF, HIGHSHELF };
+
+  BiquadSpec() : type(LOWPASS), frequency(1000), q(0.7071), gain(0) {}
+  BiquadSpec(Type t, float f, float qq, float g = 0) : type(t), frequency(f),
+    q(qq), gain(g) {}
+
+  /// Get the type with the given name, like "highpass". Throws
+  /// @a Exception if there is no such type.
+  static Type getType(const std::string& name);
+
+  Type      type;
+  /// Center or corner frequency, in Hz.
+  float     frequency;
+  /// Quality factor.
+  float     q;
+  /// Gain in dB, for peak and shelf filters.
+  float     gain;
+};
+
+/// A filter made of second-order sections run one after the other.
+typedef std::vector<BiquadSpec> BiquadCascade;
+
+/** @brief Run a bank of independent IIR filters on the input.
+ *
+ *  Each band is a cascade of second-order sections, all fed with the same
+ *  input: a single band does the pre-filtering, like removing the DC and
+ *  the rumble, or the mains hum, while many band-passes split the signal
+ *  for octave-band analysis. Only the samples that are new since the last
+ *  cycle are filtered, and the filters keep their state from one cycle to
+ *  the next. If samples are missed, or the input restarts, the filters
+ *  restart, too.
+ *
+ *  The recursion makes each filter sequential in time, so the bank is
+ *  vectorized across bands instead: groups of four bands go through the
+ *  sections together, one band per SIMD lane. Bands with fewer sections
+ *  are padded with sections that pass the signal through.
+ *
+ *  The samples come from the "input" port and their details from the
+ *  "details" port. The "output" port has a window of the same length as
+ *  the input, with the newest outputs of one of the bands; the "details"
+ *  port passes the details on, so the output can replace the grabbed
+ *  samples. The "levels" port has the mean square of each band's output,
+ *  averaged exponentially over a settable time, like the "fast" or "slow"
+ *  settings of a sound level meter.
+ *
+ *  In the settings, every @a band element holds the @a section elements of
+ *  a cascade, each with a @a type, a @a frequency, a @a q, and possibly a
+ *  @a gain. A @a bank element adds band-pass filters for fractional-octave
+ *  bands, given the @a fraction of an octave, the range of center
+ *  frequencies (@a low and @a high), and the number of @a sections in each
+ *  band.
+ */
+class BiquadBank : public BaseProcessor {
+ public:
+  /// Constructor.
+  BiquadBank();
+
+  /// Add a band. This restarts the filters.
+  void addBand(const BiquadCascade& cascade);
+  /// Add band-pass filters for the 1/@a fraction-octave bands with centers
+  /// between @a low and @a high, each made of @a n_sections sections.
+  void addOctaveBands(unsigned fraction, float low, float high,
+    unsigned n_sections);
+  /// Remove all the bands.
+  void clearBands();
+  /// Get the number of bands.
+  size_t getBandCount() const { return bands_.size(); }
+  /// Get the filter used for a band.
+  const BiquadCascade& getBand(size_t i) const { return bands_[i]; }
+
+  /// Choose the band shown on the "output" port.
+  void setOutputBand(unsigned i) { output_band_ = i; }
+  /// Get the band shown on the "output" port.
+  unsigned getOutputBand() const { return output_band_; }
+
+  /// Set the time constant for the levels, in seconds.
+  void setTimeConstant(float t) { time_constant_ = t; }
+  /// Get the time constant for the levels, in seconds.
+  float getTimeConstant() const { return time_constant_; }
+
+  /** @brief Filter @a n new samples.
+   *
+   *  If @a out is not null, the outputs of the band chosen with
+   *  @a setOutputBand are written to it. The levels are updated.
+   */
+  void process(const float* data, size_t n, float* out);
+
+  /// Get the mean square of each band's output.
+  const std::vector<float>& getLevels() const { return levels_; }
+
+  /// Set the sampling rate, recalculating the coefficients if it changed.
+  void setSamplingFrequency(float rate);
+
+  /// Clear the state of the filters and the levels.
+  void reset();
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Filter the new samples.
+  virtual int execute();
+
+ private:
+  /// Number of bands processed together.
+  static const unsigned kLanes = 4;
+
+  /// Calculate the coefficients in the layout used by @a process.
+  void design_();
+
+  std::vector<BiquadCascade>          bands_;
+  unsigned                            output_band_;
+  float                               time_constant_;
+  float                               rate_;
+
+  unsigned                            n_groups_;
+  unsigned                            n_sections_;
+  /// Coefficients b0, b1, b2, a1, a2 (normalized by a0), then the states
+  /// z1, z2, for every section of every group of bands; each value takes
+  /// @a kLanes floats, one per band.
+  std::vector<float>                  coeffs_;
+  std::vector<float>                  levels_;
+  /// Padded to a whole number of groups.
+  std::vector<float>                  padded_levels_;
+  std::vector<float>                  scratch_;
+
+  Grabber::DetailsStruct              last_input_;
+  std::vector<float>                  data_;
+
+  InputPort<std::vector<float> >      input_;
+  InputPort<Grabber::DetailsStruct>   details_input_;
+  OutputPort<std::vector<float> >     output_;
+  OutputPort<Grabber::DetailsStruct>  details_output_;
+  OutputPort<std::vector<float> >     levels_output_;
+};
+
+#endif
@@ -8,8 +8,7 @@
 
 int FftProcessor::execute()
 {
-  const std::vector<float>& pdata = *boost::any_cast<const std::vector<float>*>
-    (inputs_["input"] -> getOutput());
+  const std::vector<float>& pdata = input_.get();
   unsigned sz = pdata.size();
 
   // make sure the size is right
@@ -28,6 +27,9 @@ int FftProcessor::execute()
   // fill the output structure
   output_.fft = fft_.getOutput();
   output_.size = fft_.getSize();
+  output_.n_bins = output_.size/2 + 1;
+  output_.start = 0;
+  output_.step = (output_.size > 0)?(1.0/output_.size):0;
 
   // mark our cache as valid
   markValid();
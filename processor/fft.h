@@ -10,6 +10,7 @@
 
 #include "processor/base_processor.h"
 #include "processor/fftwrapper.h"
+#include "utils/forward_defs.h"
 
 /// The complex number type used by the FFT routines.
 typedef RealFft::Complex Complex;
@@ -17,28 +18,52 @@ typedef RealFft::Complex Complex;
 /** @brief This defines a module that performs FFT on the input data.
  *
  *  The module should have one input, called "input", which should provide it
- *  with the data on which to perform the FFT. The default output of the module
- *  (obtainable by getBuffer) is empty; instead, the output should be gotten
- *  by using getFft.
+ *  with the data on which to perform the FFT. The result is available on the
+ *  "output" port.
  */
 class FftProcessor : public BaseProcessor {
  public:
+  /** @brief A spectrum.
+   *
+   *  This is also used by other processors that calculate spectra, for which
+   *  the bins don't necessarily start at zero frequency.
+   */
   struct OutputStruct {
+    /// The frequency bins.
     const Complex*    fft;
+    /// Size of the FFT.
     unsigned          size;
+    /// Number of bins in @a fft.
+    unsigned          n_bins;
+    /// Frequency of the first bin, as a fraction of the sampling frequency.
+    double            start;
+    /// Spacing between the bins, as a fraction of the sampling frequency.
+    double            step;
   };
-  typedef const OutputStruct* Output;
+
+  /// Constructor.
+  FftProcessor() : output_(), output_port_(this, output_) {
+    registerInput_("input", &input_);
+    registerOutput_("output", &output_port_);
+  }
+
+  /// Take the FFT plans from a shared cache.
+  void setPlanCache(const FftPlanCachePtr& cache) {
+    plan_cache_ = cache;
+    fft_.setPlanCache(cache.get());
+  }
 
  protected:
   /// Calculate the FFT.
   virtual int execute();
 
-  /// Return the FFT data.
-  boost::any getOutput_() const { return &output_; }
-
  private:
-  RealFft           fft_;
-  OutputStruct      output_;
+  FftPlanCachePtr                     plan_cache_;
+  RealFft                             fft_;
+  OutputStruct                        output_;
+
+  InputPort<std::vector<float> >      input_;
+  OutputPort<OutputStruct>            output_port_;
 };
 
 #endif
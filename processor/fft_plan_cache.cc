@@ -0,0 +1,69 @@
+#include "processor/fft_plan_cache.h"
+
+#include <boost/thread/locks.hpp>
+
+fftwf_plan FftPlanCache::get(size_t size)
+{
+  boost::lock_guard<boost::mutex> lock(getPlannerMutex());
+  Plans::const_iterator i = plans_.find(size);
+  if (i != plans_.end())
+    return i -> second;
+
+  // measuring overwrites the buffers, so use scratch ones
+  float* in = (float*)fftwf_malloc(sizeof(float)*size);
+  fftwf_complex* out = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*
+    (size/2 + 1));
+  fftwf_plan plan = fftwf_plan_dft_r2c_1d(size, in, out, FFTW_MEASURE);
+  fftwf_free(out);
+  fftwf_free(in);
+
+  plans_[size] = plan;
+  return plan;
+}
+
+fftwf_plan FftPlanCache::getComplex(size_t size)
+{
+  boost::lock_guard<boost::mutex> lock(getPlannerMutex());
+  Plans::const_iterator i = complex_plans_.find(size);
+  if (i != complex_plans_.end())
+    return i -> second;
+
+  fftwf_complex* in = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*
+    size);
+  fftwf_complex* out = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*
+    size);
+  fftwf_plan plan = fftwf_plan_dft_1d(size, in, out, FFTW_FORWARD,
+    FFTW_MEASURE);
+  fftwf_free(out);
+  fftwf_free(in);
+
+  complex_plans_[size] = plan;
+  return plan;
+}
+
+size_t FftPlanCache::getSize() const
+{
+  boost::lock_guard<boost::mutex> lock(getPlannerMutex());
+  return plans_.size() + complex_plans_.size();
+}
+
+void FftPlanCache::clear()
+{
+  boost::lock_guard<boost::mutex> lock(getPlannerMutex());
+  for (Plans::const_iterator i = plans_.begin(); i != plans_.end(); ++i)
+    fftwf_destroy_plan(i -> second);
+  for (Plans::const_iterator i = complex_plans_.begin();
+        i != complex_plans_.end();
+        ++i)
+  {
+    fftwf_destroy_plan(i -> second);
+  }
+  plans_.clear();
+  complex_plans_.clear();
+}
+
+boost::mutex& FftPlanCache::getPlannerMutex()
+{
+  static boost::mutex mutex;
+  return mutex;
+}
@@ -0,0 +1,61 @@
+/** @file fft_plan_cache.h
+ *  @brief Defines a cache of FFTW plans, shared by all the FFTs of a given
+ *  size.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef FFT_PLAN_CACHE_H_
+#define FFT_PLAN_CACHE_H_
+
+#include <cstddef>
+#include <map>
+
+#include <fftw3.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** @brief Keep one FFTW plan for every size of real-to-complex FFT, and of
+ *  forward complex FFT.
+ *
+ *  Measuring a plan takes a long time, so FFTs of the same size share their
+ *  plan. The plans are made on scratch buffers, and used with FFTW's new-array
+ *  interface, so the buffers of the FFTs have to be allocated with
+ *  @a fftwf_malloc, to have the same alignment. A plan can be executed by
+ *  several threads at once, on different buffers.
+ */
+class FftPlanCache : boost::noncopyable {
+ public:
+  /// Constructor.
+  FftPlanCache() {}
+
+  /// Destructor. Destroys the plans.
+  ~FftPlanCache() { clear(); }
+
+  /// Get the real-to-complex plan for the given size, making it if needed.
+  fftwf_plan get(size_t size);
+
+  /// Get the forward complex plan for the given size, making it if needed.
+  fftwf_plan getComplex(size_t size);
+
+  /// Get the number of plans that are stored.
+  size_t getSize() const;
+
+  /// Destroy all the plans. They shouldn't be in use any more.
+  void clear();
+
+  /** @brief Get the mutex guarding the FFTW planner.
+   *
+   *  Only one thread at a time can make or destroy plans, while executing
+   *  them is thread safe.
+   */
+  static boost::mutex& getPlannerMutex();
+
+ private:
+  typedef std::map<size_t, fftwf_plan> Plans;
+
+  Plans             plans_;
+  Plans             complex_plans_;
+};
+
+#endif
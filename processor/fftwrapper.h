@@ -7,12 +7,23 @@
 // fftwf_complex, which SHOULD be true...
 #include <fftw3.h>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "processor/fft_plan_cache.h"
+
+/** @brief A real-to-complex FFT of a fixed size.
+ *
+ *  The plan is either made by the object itself, or taken from a
+ *  @a FftPlanCache, if one was given with @a setPlanCache.
+ */
 class RealFft {
  public:
   typedef std::complex<float> Complex;
 
-  RealFft() : inited_(false), size_(0), data_(0) {}
-  explicit RealFft(size_t sz) : inited_(false), data_(0) { setSize(sz); }
+  RealFft() : inited_(false), size_(0), data_(0), out_(0), plan_cache_(0) {}
+  explicit RealFft(size_t sz) : inited_(false), size_(0), data_(0), out_(0),
+    plan_cache_(0) { setSize(sz); }
 
   bool isInited() const { return inited_; }
   size_t getSize() const { return size_; }
@@ -20,11 +31,19 @@ class RealFft {
   float* getBuffer() { return data_; }
   const Complex* getOutput() const { return out_; }
 
+  /// Take the plans from a cache; null to make them here.
+  void setPlanCache(FftPlanCache* cache) {
+    done();
+    plan_cache_ = cache;
+  }
+
   void setSize (size_t sz) {
     done();
-    data_ = ((sz != 0) ? (new float[sz]) : 0);
+    if (data_)
+      fftwf_free(data_);
+    // the plans from the cache need the alignment given by fftwf_malloc
+    data_ = ((sz != 0) ? ((float*)fftwf_malloc(sizeof(float)*sz)) : 0);
     size_ = sz;
-    inited_ = false;
   }
 
   bool init() {
@@ -33,8 +52,13 @@ class RealFft {
       return false;
 
     out_ = (Complex*)fftwf_malloc (sizeof (Complex)*(size_ / 2 + 1));
-    plan_ = fftwf_plan_dft_r2c_1d (size_, data_, (float (*)[2])out_,
-      FFTW_MEASURE);
+    if (plan_cache_) {
+      plan_ = plan_cache_ -> get(size_);
+    } else {
+      boost::lock_guard<boost::mutex> lock(FftPlanCache::getPlannerMutex());
+      plan_ = fftwf_plan_dft_r2c_1d (size_, data_, (float (*)[2])out_,
+        FFTW_MEASURE);
+    }
     inited_ = true;
     return true;
   }
@@ -43,10 +67,12 @@ class RealFft {
     if (!inited_)
       return true;
 
-    fftwf_destroy_plan(plan_);
+    if (!plan_cache_) {
+      boost::lock_guard<boost::mutex> lock(FftPlanCache::getPlannerMutex());
+      fftwf_destroy_plan(plan_);
+    }
     fftwf_free(out_);
-    if (data_)
-      delete[] data_;
+    out_ = 0;
 
     inited_ = false;
     return true;
@@ -56,10 +82,14 @@ class RealFft {
     if (!inited_)
       if (!init())
         return;
-    fftwf_execute(plan_);
+    fftwf_execute_dft_r2c(plan_, data_, (float (*)[2])out_);
   }
 
-  ~RealFft() { done(); }
+  ~RealFft() {
+    done();
+    if (data_)
+      fftwf_free(data_);
+  }
  
  protected:
   bool		inited_;
@@ -67,6 +97,7 @@ class RealFft {
   float*	data_;
   Complex*	out_;
   fftwf_plan	plan_;
+  FftPlanCache*	plan_cache_;
 };
 
 #endif
@@ -0,0 +1,348 @@
+#include "processor/filter_bank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "processor/fft_plan_cache.h"
+#include "processor/vector_ops.h"
+#include "utils/exception.h"
+#include "utils/misc.h"
+
+namespace {
+
+/// Highest frequency that a band taken from a decimated stage can reach, as
+/// a fraction of the sampling rate before decimation. This is well inside
+/// the flat part of the decimation filters, whose cutoff is at 0.225, and
+/// far enough below a quarter of the rate that nothing aliases into it.
+const float kPassband = 0.15;
+/// Length of the decimation filters, in periods of the decimated rate.
+const unsigned kDecimatorLength = 32;
+
+} // anonymous namespace
+
+FilterBank::FilterBank() : scale_(CONSTANT_Q), n_bands_(96), low_(27.5),
+    high_(14080), fft_size_(2048), octaves_(0), history_length_(0),
+    sigma_(0.5), rate_(0), last_end_(0), plan_cache_(new FftPlanCache),
+    output_(this, data_), frequencies_output_(this, frequencies_data_)
+{
+  fft_.setPlanCache(plan_cache_.get());
+
+  registerInput_("input", &input_);
+  registerInput_("details", &details_);
+  registerOutput_("output", &output_);
+  registerOutput_("frequencies", &frequencies_output_);
+}
+
+void FilterBank::setBands(Scale scale, unsigned n, float low, float high)
+{
+  scale_ = scale;
+  n_bands_ = std::max(n, 1u);
+  low_ = std::max(low, 1.0f);
+  high_ = std::max(high, low_);
+  rate_ = 0;
+  markStale();
+}
+
+void FilterBank::setFftSize(unsigned n)
+{
+  fft_size_ = std::max(n, 16u);
+  rate_ = 0;
+  markStale();
+}
+
+void FilterBank::setOctaves(unsigned n)
+{
+  octaves_ = std::min(n, 16u);
+  rate_ = 0;
+  markStale();
+}
+
+void FilterBank::setHistoryLength(size_t n)
+{
+  if (n == history_length_)
+    return;
+
+  history_length_ = n;
+  rate_ = 0;
+}
+
+void FilterBank::setPlanCache(const FftPlanCachePtr& cache)
+{
+  plan_cache_ = cache?cache:FftPlanCachePtr(new FftPlanCache);
+  fft_.setPlanCache(plan_cache_.get());
+  rate_ = 0;
+}
+
+FilterBank::Scale FilterBank::getScale(const std::string& name)
+{
+  if (name == "mel")
+    return MEL;
+  else if (name == "constant_q")
+    return CONSTANT_Q;
+  else
+    throw Exception("Unknown frequency scale: " + name +
+      " (FilterBank::getScale).");
+}
+
+std::string FilterBank::getScaleName(Scale scale)
+{
+  return (scale == MEL)?"mel":"constant_q";
+}
+
+int FilterBank::init()
+{
+  if (properties_) {
+    setBands(getScale(trim(properties_ -> get("scale",
+      getScaleName(scale_)))), properties_ -> get("bands", n_bands_),
+      properties_ -> get("low", low_), properties_ -> get("high", high_));
+    setFftSize(properties_ -> get("size", fft_size_));
+    setOctaves(properties_ -> get("octaves", octaves_));
+    sigma_ = properties_ -> get("sigma", sigma_);
+  }
+
+  return 0;
+}
+
+void FilterBank::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("scale", getScaleName(scale_));
+    properties_ -> put("bands", n_bands_);
+    properties_ -> put("low", low_);
+    properties_ -> put("high", high_);
+    properties_ -> put("size", fft_size_);
+    properties_ -> put("octaves", octaves_);
+    properties_ -> put("sigma", sigma_);
+  }
+}
+
+size_t FilterBank::append(const float* data, size_t n, unsigned long long end,
+  float rate)
+{
+  bool restart = (last_end_ == 0 || end < last_end_ || end - last_end_ > n);
+  if (rate != rate_) {
+    rate_ = rate;
+    design_();
+    restart = true;
+  }
+
+  size_t n_new = n;
+  if (restart) {
+    const unsigned long long start = (end > n)?(end - n):0;
+    for (size_t k = 0; k < histories_.size(); ++k)
+      histories_[k].clear(start >> k);
+    for (size_t k = 0; k < decimators_.size(); ++k)
+      decimators_[k] -> reset();
+  } else {
+    n_new = end - last_end_;
+  }
+  last_end_ = end;
+
+  // each stage is decimated into the next
+  const float* samples = data + n - n_new;
+  size_t n_samples = n_new;
+  for (size_t k = 0; k < histories_.size() && n_samples > 0; ++k) {
+    histories_[k].append(samples, n_samples);
+    if (k >= decimators_.size())
+      break;
+
+    std::vector<float>& out = scratch_[k % 2];
+    out.resize(decimators_[k] -> getMaxOutputs(n_samples));
+    n_samples = decimators_[k] -> process(samples, n_samples, &out[0]);
+    samples = &out[0];
+  }
+
+  return n_new;
+}
+
+bool FilterBank::calculate(unsigned long long end,
+  std::vector<float>& magnitudes)
+{
+  magnitudes.assign(n_bands_, 0);
+  if (histories_.empty())
+    return false;
+
+  const unsigned size = fft_size_;
+  const double delay = decimators_.empty()?0:decimators_[0] -> getDelay();
+  bool complete = true;
+  for (size_t k = 0; k < histories_.size(); ++k) {
+    if (stage_begin_[k] == stage_end_[k])
+      continue;
+
+    // the samples at stage k lag the input by (2^k - 1) times the delay of
+    // a decimator, counted at the input rate; the newest windows use the
+    // latest samples available
+    const SampleHistory& history = histories_[k];
+    const unsigned long long stage_end = std::min<unsigned long long>(
+      (end + (unsigned long long)(((1u << k) - 1)*delay + 0.5)) >> k,
+      history.getEnd());
+    float* buffer = fft_.getBuffer();
+    if (stage_end < size || !history.copy(stage_end - size, size, buffer)) {
+      complete = false;
+      continue;
+    }
+
+    for (unsigned i = 0; i < size; ++i)
+      buffer[i] *= window_[i];
+    fft_.exec();
+
+    const RealFft::Complex* out = fft_.getOutput();
+    for (size_t i = 0; i < power_.size(); ++i)
+      power_[i] = std::norm(out[i]);
+
+    // sparse matrix times vector; each row is a run of consecutive bins
+    for (unsigned j = stage_begin_[k]; j < stage_end_[k]; ++j) {
+      const unsigned offset = row_starts_[j];
+      magnitudes[j] = std::sqrt(vectorDot(&weights_[offset],
+        &power_[first_bins_[j]], row_starts_[j + 1] - offset));
+    }
+  }
+
+  return complete;
+}
+
+int FilterBank::execute()
+{
+  const std::vector<float>& input = input_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+
+  if (input.empty()) {
+    markValid();
+    return 0;
+  }
+
+  const bool changed = (rate_ != details.samplingFrequency);
+  if (append(&input[0], input.size(), details.end,
+        details.samplingFrequency) == 0 && !changed &&
+      data_.size() == n_bands_)
+  {
+    markUnchanged();
+    markValid();
+    return 0;
+  }
+
+  calculate(details.end, data_);
+  if (frequencies_)
+    frequencies_data_ = *frequencies_;
+
+  markValid();
+  return 0;
+}
+
+float FilterBank::warp_(float f) const
+{
+  if (scale_ == MEL)
+    return 2595*std::log10(1 + f/700);
+  else
+    return std::log(std::max(f, 1e-3f))/std::log(2.0f);
+}
+
+float FilterBank::unwarp_(float w) const
+{
+  if (scale_ == MEL)
+    return 700*(std::pow(10.0f, w/2595) - 1);
+  else
+    return std::pow(2.0f, w);
+}
+
+void FilterBank::design_()
+{
+  const unsigned size = fft_size_;
+  const unsigned n_bins = size/2 + 1;
+
+  // the centers are evenly spaced on the warped scale, and each kernel
+  // reaches to the neighboring centers
+  const float w_low = warp_(low_);
+  const float w_high = warp_(high_);
+  const float step = (n_bands_ > 1)?((w_high - w_low)/(n_bands_ - 1)):1;
+  std::vector<float>* frequencies = new std::vector<float>(n_bands_);
+  frequencies_.reset(frequencies);
+
+  // every band goes to the most decimated stage that still contains it;
+  // the bands get wider going up, so the stages come in decreasing order
+  std::vector<unsigned> stages(n_bands_);
+  unsigned n_stages = 1;
+  for (unsigned i = 0; i < n_bands_; ++i) {
+    (*frequencies)[i] = unwarp_(w_low + i*step);
+    const float top = unwarp_(w_low + (i + 1)*step);
+    unsigned k = 0;
+    while (k < octaves_ && top <= kPassband*rate_/(1u << k))
+      ++k;
+    stages[i] = k;
+    n_stages = std::max(n_stages, k + 1);
+  }
+
+  stage_begin_.assign(n_stages, n_bands_);
+  stage_end_.assign(n_stages, n_bands_);
+  row_starts_.assign(1, 0);
+  first_bins_.clear();
+  weights_.clear();
+  for (unsigned i = 0; i < n_bands_; ++i) {
+    const unsigned k = stages[i];
+    stage_begin_[k] = std::min(stage_begin_[k], i);
+    stage_end_[k] = i + 1;
+
+    const float bin_width = rate_/(1u << k)/size;
+    const float center = w_low + i*step;
+    const float f0 = unwarp_(center - step);
+    const float f1 = unwarp_(center + step);
+    const int b0 = std::max((int)std::ceil(f0/bin_width), 0);
+    const int b1 = std::min((int)std::floor(f1/bin_width), (int)n_bins - 1);
+
+    // keep only the bins where the kernel is positive
+    unsigned first = 0;
+    std::vector<float> row;
+    for (int b = b0; b <= b1; ++b) {
+      const float weight = 1 - std::abs(warp_(b*bin_width) - center)/step;
+      if (weight <= 0 && row.empty())
+        continue;
+      if (row.empty())
+        first = b;
+      row.push_back(weight);
+    }
+    while (!row.empty() && row.back() <= 0)
+      row.pop_back();
+
+    // bands narrower than a bin take the bin nearest to their center
+    if (row.empty()) {
+      first = std::min((unsigned)((*frequencies)[i]/bin_width + 0.5),
+        n_bins - 1);
+      row.push_back(1);
+    }
+
+    first_bins_.push_back(first);
+    weights_.insert(weights_.end(), row.begin(), row.end());
+    row_starts_.push_back(weights_.size());
+  }
+
+  // one history per stage, and one half-band decimator between stages
+  decimators_.resize(n_stages - 1);
+  for (size_t k = 0; k < decimators_.size(); ++k) {
+    if (!decimators_[k]) {
+      decimators_[k].reset(new Resampler);
+      decimators_[k] -> setRatio(1, 2);
+      decimators_[k] -> setFilterLength(kDecimatorLength);
+    }
+  }
+
+  const size_t margin = decimators_.empty()?0:(size_t)std::ceil(
+    decimators_[0] -> getDelay()) + 1;
+  histories_.resize(n_stages);
+  for (size_t k = 0; k < n_stages; ++k)
+    histories_[k].setCapacity(size + margin + (history_length_ >> k));
+  last_end_ = 0;
+
+  // a gaussian window, like the zoom FFT uses
+  window_.resize(size);
+  const float size2 = size/2.0f;
+  for (unsigned i = 0; i < size; ++i) {
+    const float x = ((float)i - size2)/size2/sigma_;
+    window_[i] = std::exp(-0.5*x*x);
+  }
+
+  if (fft_.getSize() != size)
+    fft_.setSize(size);
+  fft_.init();
+  power_.resize(n_bins);
+}
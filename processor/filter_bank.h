@@ -0,0 +1,172 @@
+/** @file filter_bank.h
+ *  @brief Defines a processor that maps spectra onto a mel or constant-Q
+ *  frequency scale.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef FILTER_BANK_H_
+#define FILTER_BANK_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "processor/base_processor.h"
+#include "processor/fftwrapper.h"
+#include "processor/grabber.h"
+#include "processor/resampler.h"
+#include "processor/sample_history.h"
+#include "utils/forward_defs.h"
+
+/** @brief Find the magnitudes of the spectrum in bands that are evenly
+ *  spaced on a mel or a logarithmic (constant-Q) scale.
+ *
+ *  Each band is a triangular kernel on the chosen scale, reaching from the
+ *  center of the band below to the center of the band above, with a peak
+ *  of one. The kernels are calculated once, for a given sampling rate and
+ *  FFT size, and stored as a sparse matrix whose rows are runs of
+ *  consecutive bins, so that applying them is one short dot product per
+ *  band. The output is the square root of the weighted power, on the same
+ *  scale as the magnitudes of the FFT.
+ *
+ *  A single FFT has the same resolution at all frequencies, which is too
+ *  coarse for the narrow bands at the bottom of a constant-Q scale. With
+ *  @a octaves larger than zero, the input is also decimated by 2, 4, ...,
+ *  2^@a octaves, each stage keeping its own history, and every band is
+ *  taken from the FFT of the most decimated stage that still contains it.
+ *  All the FFTs have the same size, so the resolution in Hz halves with
+ *  each octave, like the bands do. The samples are multiplied by a gaussian
+ *  window of width @a sigma before each FFT.
+ *
+ *  As a processor, this reads samples from the "input" and "details" ports,
+ *  and gives the magnitudes for the most recent samples on the "output"
+ *  port, and the band centers on the "frequencies" port. It can also be
+ *  fed directly, with @a append, and asked for the magnitudes for a window
+ *  ending at any sample that is still in its history, with @a calculate.
+ */
+class FilterBank : public BaseProcessor {
+ public:
+  /// Frequency scales.
+  enum Scale { MEL, CONSTANT_Q };
+
+  /// Constructor.
+  FilterBank();
+
+  /// Use @a n bands on the given scale, with centers from @a low to
+  /// @a high, in Hz.
+  void setBands(Scale scale, unsigned n, float low, float high);
+  /// Get the frequency scale.
+  Scale getScale() const { return scale_; }
+  /// Get the number of bands.
+  unsigned getBandCount() const { return n_bands_; }
+
+  /// Set the size of the FFTs.
+  void setFftSize(unsigned n);
+  /// Get the size of the FFTs.
+  unsigned getFftSize() const { return fft_size_; }
+
+  /// Set the number of times the input can be decimated by 2.
+  void setOctaves(unsigned n);
+  /// Get the number of times the input can be decimated by 2.
+  unsigned getOctaves() const { return octaves_; }
+
+  /// Set the number of samples, at the input rate, that are kept besides
+  /// those needed for the longest window.
+  void setHistoryLength(size_t n);
+
+  /// Take the FFT plans from a shared cache.
+  void setPlanCache(const FftPlanCachePtr& cache);
+
+  /// Get the center frequencies of the bands, in Hz. These change when the
+  /// bands are recalculated; the old ones stay valid.
+  boost::shared_ptr<const std::vector<float> > getFrequencies() const
+    { return frequencies_; }
+
+  /** @brief Add the new part of a window of @a n samples that ends at the
+   *  absolute index @a end, sampled at @a rate.
+   *
+   *  If samples were missed, or @a end went back, the histories restart.
+   *  Returns the number of new samples.
+   */
+  size_t append(const float* data, size_t n, unsigned long long end,
+    float rate);
+
+  /** @brief Calculate the magnitudes in the bands, for the windows ending
+   *  at the absolute input index @a end.
+   *
+   *  Returns @a false if some of the samples are not in the histories; the
+   *  bands that need them are set to zero.
+   */
+  bool calculate(unsigned long long end, std::vector<float>& magnitudes);
+
+  /// Get the scale with the given name ("mel" or "constant_q"). Throws
+  /// @a Exception if there is no such scale.
+  static Scale getScale(const std::string& name);
+  /// Get the name of a scale.
+  static std::string getScaleName(Scale scale);
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Add the new samples, and find the magnitudes for the latest ones.
+  virtual int execute();
+
+ private:
+  /// Calculate the kernels and set up the decimation stages.
+  void design_();
+  /// Map a frequency to the scale on which the bands are evenly spaced.
+  float warp_(float f) const;
+  /// Map back from the warped scale to a frequency.
+  float unwarp_(float w) const;
+
+  Scale                               scale_;
+  unsigned                            n_bands_;
+  float                               low_;
+  float                               high_;
+  unsigned                            fft_size_;
+  unsigned                            octaves_;
+  size_t                              history_length_;
+  float                               sigma_;
+
+  /// Sampling rate the kernels were calculated for; zero if they have to
+  /// be recalculated.
+  float                               rate_;
+  boost::shared_ptr<const std::vector<float> >  frequencies_;
+  /// Range of bands taken from each stage; the bands of the most decimated
+  /// stages come first.
+  std::vector<unsigned>               stage_begin_;
+  std::vector<unsigned>               stage_end_;
+  /// For each band, where its weights start in @a weights_, and the bin
+  /// they start at; the last element of @a row_starts_ is the total number
+  /// of weights.
+  std::vector<unsigned>               row_starts_;
+  std::vector<unsigned>               first_bins_;
+  std::vector<float>                  weights_;
+
+  /// The samples at each stage, and the filters decimating each stage into
+  /// the next.
+  std::vector<SampleHistory>          histories_;
+  std::vector<boost::shared_ptr<Resampler> >  decimators_;
+  unsigned long long                  last_end_;
+  std::vector<float>                  scratch_[2];
+
+  FftPlanCachePtr                     plan_cache_;
+  RealFft                             fft_;
+  std::vector<float>                  window_;
+  std::vector<float>                  power_;
+
+  std::vector<float>                  data_;
+  std::vector<float>                  frequencies_data_;
+
+  InputPort<std::vector<float> >      input_;
+  InputPort<Grabber::DetailsStruct>   details_;
+  OutputPort<std::vector<float> >     output_;
+  OutputPort<std::vector<float> >     frequencies_output_;
+};
+
+#endif
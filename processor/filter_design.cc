@@ -0,0 +1,37 @@
+#include "processor/filter_design.h"
+
+#include <cmath>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+} // anonymous namespace
+
+std::vector<float> designLowPass(unsigned n, double cutoff, double gain)
+{
+  std::vector<float> h(n);
+  if (n == 0)
+    return h;
+  if (n == 1) {
+    h[0] = gain;
+    return h;
+  }
+
+  const double middle = (n - 1)/2.0;
+  double sum = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    const double x = i - middle;
+    const double sinc = (x == 0)?(2*cutoff):
+      (std::sin(2*kPi*cutoff*x)/(kPi*x));
+    const double t = 2*kPi*i/(n - 1);
+    const double blackman = 0.42 - 0.5*std::cos(t) + 0.08*std::cos(2*t);
+    h[i] = sinc*blackman;
+    sum += h[i];
+  }
+
+  for (unsigned i = 0; i < n; ++i)
+    h[i] *= gain/sum;
+
+  return h;
+}
@@ -0,0 +1,21 @@
+/** @file filter_design.h
+ *  @brief Defines functions that calculate the coefficients of digital
+ *  filters.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef FILTER_DESIGN_H_
+#define FILTER_DESIGN_H_
+
+#include <vector>
+
+/** @brief Calculate a linear-phase low-pass FIR filter with @a n taps.
+ *
+ *  This is a sinc with a Blackman window. The @a cutoff is in cycles per
+ *  sample, and the coefficients are scaled so that the gain at zero
+ *  frequency is @a gain. The transition band is about 5.5/@a n wide, and
+ *  centered at the cutoff.
+ */
+std::vector<float> designLowPass(unsigned n, double cutoff, double gain = 1);
+
+#endif
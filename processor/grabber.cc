@@ -1,24 +1,43 @@
 #include "processor/grabber.h"
 
+#include <algorithm>
+
 int Grabber::execute()
 {
   if (!backend_)
     return 1;
 
   const unsigned sz = backend_ -> getWindowSize();
+  const float rate = backend_ -> getSamplingFrequency();
+
   // make sure our data vector has the right size
-  if (data_.size() != sz)
+  const bool resized = (data_.size() != sz);
+  if (resized)
     data_.resize(sz);
 
-  details_.samplingFrequency = backend_ -> getSamplingFrequency();
-  details_.size = sz;
-
-  // get the data
-  int res = backend_ -> copyWindow(&data_[0]);
-  if (res != 0)
-    return res;
-  else {
+  // nothing changed if no new samples arrived since the last cycle, in which
+  // case there is no need to copy the window again
+  const unsigned long long available = std::max(backend_ -> getSampleCount(),
+    (unsigned long long)sz);
+  if (!resized && details_.end == available &&
+      details_.samplingFrequency == rate)
+  {
+    markUnchanged();
     markValid();
     return 0;
   }
+
+  // get the data, together with the number of samples up to its end
+  unsigned long long count = 0;
+  int res = backend_ -> copyWindow(&data_[0], count);
+  if (res != 0)
+    return res;
+  const unsigned long long end = std::max(count, (unsigned long long)sz);
+
+  details_.samplingFrequency = rate;
+  details_.size = sz;
+  details_.end = end;
+
+  markValid();
+  return 0;
 }
@@ -16,33 +16,42 @@
  *  back end.
  *
  *  This should have no usual BaseProcessor inputs; instead, assign an input
- *  back end by using assignBackend.
+ *  back end by using assignBackend. The samples are available on the
+ *  "output" port, and the details about them on the "details" port.
  */
 class Grabber : public BaseProcessor {
  public:
   struct DetailsStruct {
-    float           samplingFrequency;
-    unsigned        size;
+    float               samplingFrequency;
+    unsigned            size;
+    /// Number of samples that went through the input up to the window end
+    /// (but at least @a size). Consumers can compare this between grabs to
+    /// find the new samples.
+    unsigned long long  end;
   };
-  typedef const DetailsStruct* Details;
-  typedef const std::vector<float>* Output;
+
+  /// Constructor.
+  Grabber() : backend_(0), details_(), output_(this, data_),
+    details_output_(this, details_)
+  {
+    registerOutput_("output", &output_);
+    registerOutput_("details", &details_output_);
+  }
 
   /// Assign a backend to the grabber.
-  void assignBackend(BaseInput* input) { backend_ = input; }
+  void assignBackend(BaseInput* input) { backend_ = input; data_.clear(); }
 
  protected:
   /// Implementation of the grabbing.
   virtual int execute();
 
-  /// Get access to the data.
-  virtual boost::any getOutput_() const { return &data_; }
-
-  virtual boost::any getDetails_() const { return &details_; }
-
  private:
-  std::vector<float>      data_;
-  BaseInput*              backend_;
-  DetailsStruct           details_;
+  std::vector<float>                  data_;
+  BaseInput*                          backend_;
+  DetailsStruct                       details_;
+
+  OutputPort<std::vector<float> >     output_;
+  OutputPort<DetailsStruct>           details_output_;
 };
 
 #endif
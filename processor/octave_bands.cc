@@ -0,0 +1,36 @@
+#include "processor/octave_bands.h"
+
+#include <cmath>
+
+std::vector<OctaveBand> getOctaveBands(unsigned fraction, float low,
+  float high)
+{
+  std::vector<OctaveBand> bands;
+  if (fraction == 0 || low <= 0 || high < low)
+    return bands;
+
+  const double ratio = std::pow(10.0, 0.3);
+  const double half_width = std::pow(ratio, 0.5/fraction);
+  // for odd fractions the centers are at ratio^(x/fraction) kHz, for even
+  // ones at ratio^((2x + 1)/(2 fraction)) kHz
+  const double offset = (fraction % 2 == 0)?0.5:0;
+
+  const int first = (int)std::floor(fraction*std::log(low/1000.0)/
+    std::log(ratio) - offset) - 1;
+  for (int x = first; ; ++x) {
+    const double center = 1000*std::pow(ratio, (x + offset)/fraction);
+    // allow for the nominal frequencies being rounded, like 20 Hz for 19.95
+    if (center > high*1.01)
+      break;
+    if (center < low*0.99)
+      continue;
+
+    OctaveBand band;
+    band.low = center/half_width;
+    band.center = center;
+    band.high = center*half_width;
+    bands.push_back(band);
+  }
+
+  return bands;
+}
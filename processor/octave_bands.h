@@ -0,0 +1,28 @@
+/** @file octave_bands.h
+ *  @brief Defines the fractional-octave frequency bands used in acoustics.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef OCTAVE_BANDS_H_
+#define OCTAVE_BANDS_H_
+
+#include <vector>
+
+/// A frequency band, in Hz.
+struct OctaveBand {
+  float   low;
+  float   center;
+  float   high;
+};
+
+/** @brief Get the 1/@a fraction-octave bands whose centers lie in
+ *  [@a low, @a high], give or take a percent.
+ *
+ *  The bands follow IEC 61260: the octave ratio is 10^(3/10), the bands are
+ *  placed relative to 1 kHz, and for even fractions, 1 kHz is a band edge
+ *  rather than a center. The bands are sorted by frequency.
+ */
+std::vector<OctaveBand> getOctaveBands(unsigned fraction, float low,
+  float high);
+
+#endif
@@ -0,0 +1,208 @@
+#include "processor/processor_factory.h"
+
+#include <sstream>
+#include <vector>
+
+#include "processor/band_levels.h"
+#include "processor/biquad_bank.h"
+#include "processor/fft.h"
+#include "processor/filter_bank.h"
+#include "processor/resampler.h"
+#include "processor/sample_ring.h"
+#include "processor/spectral_average.h"
+#include "processor/window_functions.h"
+#include "processor/zoom_fft.h"
+#include "utils/logging.h"
+#include "utils/misc.h"
+
+namespace {
+
+BaseProcessor* createAverage() { return new SpectralAverage; }
+BaseProcessor* createBandLevels() { return new BandLevels; }
+BaseProcessor* createBiquadBank() { return new BiquadBank; }
+BaseProcessor* createFft() { return new FftProcessor; }
+BaseProcessor* createFilterBank() { return new FilterBank; }
+BaseProcessor* createGaussianWindow() { return new GaussianWindow; }
+BaseProcessor* createResampler() { return new Resampler; }
+BaseProcessor* createSampleRing() { return new SampleRing; }
+BaseProcessor* createZoomFft() { return new ZoomFft; }
+
+/// Write the settings in a canonical form, without the comments.
+void writeSettings(std::ostream& out, const Properties& props)
+{
+  out << props.get_value<std::string>();
+  for (Properties::const_iterator i = props.begin(); i != props.end(); ++i) {
+    if (i -> first == "<xmlcomment>")
+      continue;
+    out << "<" << i -> first << ">";
+    writeSettings(out, i -> second);
+    out << "</" << i -> first << ">";
+  }
+}
+
+} // anonymous namespace
+
+ProcessorFactory::ProcessorFactory()
+{
+  add("average", createAverage);
+  add("bands", createBandLevels);
+  add("biquads", createBiquadBank);
+  add("fft", createFft);
+  add("filterbank", createFilterBank);
+  add("gaussian", createGaussianWindow);
+  add("resampler", createResampler);
+  add("ring", createSampleRing);
+  add("zoom_fft", createZoomFft);
+}
+
+BaseProcessorPtr ProcessorFactory::create(const std::string& type) const
+{
+  std::map<std::string, Creator>::const_iterator i = creators_.find(type);
+  if (i == creators_.end())
+    throw Exception("Unknown processor type: " + type +
+      " (ProcessorFactory::create).");
+
+  return BaseProcessorPtr(i -> second());
+}
+
+void ProcessorFactory::build(Properties& desc, Processors& processors) const
+{
+  // read the description of the nodes
+  Nodes nodes;
+  std::vector<std::string> names;
+  for (Properties::iterator i = desc.begin(); i != desc.end(); ++i) {
+    if (i -> first != "node")
+      continue;
+
+    Properties& params = i -> second;
+    const std::string name = trim(params.get<std::string>("name", ""));
+    if (name.empty())
+      throw Exception("Processor without a name (ProcessorFactory::build).");
+    if (nodes.count(name) > 0 || processors.count(name) > 0)
+      throw Exception("Processor " + name + " is defined more than once "
+        "(ProcessorFactory::build).");
+
+    Node& node = nodes[name];
+    node.type = trim(params.get<std::string>("type", ""));
+    if (!has(node.type))
+      throw Exception("Unknown type for processor " + name + ": " +
+        node.type + " (ProcessorFactory::build).");
+
+    boost::optional<Properties&> settings =
+      params.get_child_optional("settings");
+    node.settings = settings?&(*settings):&params.put_child("settings",
+      Properties());
+
+    for (Properties::const_iterator j = params.begin();
+          j != params.end();
+          ++j)
+    {
+      if (j -> first != "input")
+        continue;
+
+      const std::string port = j -> second.get<std::string>(
+        "<xmlattr>.port", "input");
+      const std::string source = trim(j -> second.get_value<std::string>());
+      if (node.inputs.count(port) > 0)
+        throw Exception("Input " + port + " of processor " + name + " is "
+          "connected more than once (ProcessorFactory::build).");
+
+      const size_t dot = source.find('.');
+      if (dot == std::string::npos)
+        node.inputs[port] = std::make_pair(source, std::string("output"));
+      else
+        node.inputs[port] = std::make_pair(source.substr(0, dot),
+          source.substr(dot + 1));
+    }
+
+    names.push_back(name);
+  }
+
+  // figure out which nodes calculate the same thing
+  for (size_t i = 0; i < names.size(); ++i) {
+    std::set<std::string> visiting;
+    findKey_(names[i], nodes, processors, visiting);
+  }
+
+  // create one processor for every distinct node
+  std::map<std::string, std::string> first_names;
+  std::vector<std::string> created;
+  for (size_t i = 0; i < names.size(); ++i) {
+    const Node& node = nodes[names[i]];
+    std::map<std::string, std::string>::const_iterator j =
+      first_names.find(node.key);
+    if (j != first_names.end()) {
+      logger::info << "Processor " << names[i] << " is the same as "
+                   << j -> second << ", sharing it." << std::endl;
+      processors[names[i]] = processors[j -> second];
+      continue;
+    }
+
+    BaseProcessorPtr processor = create(node.type);
+    processor -> setProperties(node.settings);
+    processors[names[i]] = processor;
+    first_names[node.key] = names[i];
+    created.push_back(names[i]);
+  }
+
+  // connect and initialize them
+  for (size_t i = 0; i < created.size(); ++i) {
+    const Node& node = nodes[created[i]];
+    BaseProcessor& processor = *processors[created[i]];
+    for (std::map<std::string, std::pair<std::string, std::string> >::
+          const_iterator j = node.inputs.begin();
+          j != node.inputs.end();
+          ++j)
+    {
+      processor.connect(j -> first, *processors[j -> second.first],
+        j -> second.second);
+    }
+    processor.checkInputs();
+
+    if (processor.init() != 0)
+      throw Exception("Can't initialize processor " + created[i] +
+        " (ProcessorFactory::build).");
+  }
+}
+
+const std::string& ProcessorFactory::findKey_(const std::string& name,
+  Nodes& nodes, const Processors& existing,
+  std::set<std::string>& visiting) const
+{
+  Nodes::iterator i = nodes.find(name);
+  if (i == nodes.end())
+    throw Exception("Unknown processor: " + name +
+      " (ProcessorFactory::build).");
+
+  Node& node = i -> second;
+  if (!node.key.empty())
+    return node.key;
+  if (visiting.count(name) > 0)
+    throw Exception("The processor connections form a cycle, at " + name +
+      " (ProcessorFactory::build).");
+  visiting.insert(name);
+
+  std::ostringstream key;
+  key << node.type << "{";
+  writeSettings(key, *node.settings);
+  key << "}(";
+  for (std::map<std::string, std::pair<std::string, std::string> >::
+        const_iterator j = node.inputs.begin();
+        j != node.inputs.end();
+        ++j)
+  {
+    // the processors that were there before are all distinct
+    const std::string& source = j -> second.first;
+    key << j -> first << "=";
+    if (existing.count(source) > 0)
+      key << "@" << source;
+    else
+      key << findKey_(source, nodes, existing, visiting);
+    key << "." << j -> second.second << ";";
+  }
+  key << ")";
+
+  visiting.erase(name);
+  node.key = key.str();
+  return node.key;
+}
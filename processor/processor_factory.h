@@ -0,0 +1,92 @@
+/** @file processor_factory.h
+ *  @brief Defines a class that creates processors by type name, and builds
+ *  processing graphs described in the settings.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef PROCESSOR_FACTORY_H_
+#define PROCESSOR_FACTORY_H_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "processor/base_processor.h"
+#include "utils/exception.h"
+#include "utils/forward_defs.h"
+#include "utils/properties.h"
+
+/** @brief Create processors from their type names.
+ *
+ *  The standard processor types are registered by the constructor; others
+ *  can be added with @a add.
+ *
+ *  The factory can also build a whole processing graph from a description in
+ *  the settings. This is a list of @a node elements, each having a @a name, a
+ *  @a type, optional @a settings, and any number of @a input elements, like
+ *  this:
+ *
+ *  @code
+ *  <node>
+ *    <name>fft</name>
+ *    <type>fft</type>
+ *    <input port="input">window.output</input>
+ *  </node>
+ *  @endcode
+ *
+ *  The input connects the port given by the attribute to an output port of
+ *  another node; the output port defaults to "output" if it is omitted. The
+ *  nodes can appear in any order. Nodes that have the same type, the same
+ *  settings, and inputs from equivalent nodes would calculate the same thing,
+ *  so only one processor is created for all of them.
+ */
+class ProcessorFactory {
+ public:
+  /// A function that creates a processor.
+  typedef BaseProcessor* (*Creator)();
+
+  /// Constructor. Registers the standard processors.
+  ProcessorFactory();
+
+  /// Register a processor type.
+  void add(const std::string& type, Creator creator)
+    { creators_[type] = creator; }
+
+  /// Find out whether a processor type was registered.
+  bool has(const std::string& type) const
+    { return creators_.count(type) > 0; }
+
+  /// Create a processor of the given type. Throws if the type is unknown.
+  BaseProcessorPtr create(const std::string& type) const;
+
+  /** @brief Build the processing graph described by @a desc.
+   *
+   *  The processors are added to @a processors, one entry per node name;
+   *  nodes that were merged share the same processor. The processors that
+   *  are already in @a processors (like the grabber) can be used as inputs,
+   *  but are not part of the description. The new processors get their
+   *  settings from @a desc, are initialized, and have their inputs checked.
+   *  Throws @a Exception if the description is invalid.
+   */
+  void build(Properties& desc, Processors& processors) const;
+
+ private:
+  /// A node in the graph description.
+  struct Node {
+    std::string           type;
+    Properties*           settings;
+    /// Maps input port names to (node, output port) pairs.
+    std::map<std::string, std::pair<std::string, std::string> > inputs;
+    /// Identifies what the node calculates.
+    std::string           key;
+  };
+  typedef std::map<std::string, Node> Nodes;
+
+  /// Find the key of a node, after finding those of its sources.
+  const std::string& findKey_(const std::string& name, Nodes& nodes,
+    const Processors& existing, std::set<std::string>& visiting) const;
+
+  std::map<std::string, Creator>  creators_;
+};
+
+#endif
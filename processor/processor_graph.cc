@@ -0,0 +1,284 @@
+#include "processor/processor_graph.h"
+
+#include <exception>
+
+#include <boost/bind.hpp>
+
+void ProcessorGraph::add(const std::string& name, BaseProcessor* processor)
+{
+  if (indices_.count(name) > 0)
+    throw PortError("Processor " + name + " was already added "
+      "(ProcessorGraph::add).");
+
+  Node node;
+  node.name = name;
+  node.processor = processor;
+  node.executions = 0;
+  node.skips = 0;
+  node.failed = false;
+
+  indices_[name] = nodes_.size();
+  nodes_.push_back(node);
+  built_ = false;
+}
+
+void ProcessorGraph::build()
+{
+  std::map<const BaseProcessor*, size_t> lookup;
+  for (size_t i = 0; i < nodes_.size(); ++i)
+    lookup[nodes_[i].processor] = i;
+
+  // find the sources of each node
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    Node& node = nodes_[i];
+    const std::vector<BaseProcessor*> sources =
+      node.processor -> getSources();
+
+    node.sources.clear();
+    for (size_t j = 0; j < sources.size(); ++j) {
+      std::map<const BaseProcessor*, size_t>::const_iterator k =
+        lookup.find(sources[j]);
+      if (k == lookup.end())
+        throw PortError("Processor " + node.name + " uses a processor that "
+          "is not part of the graph (ProcessorGraph::build).");
+      node.sources.push_back(k -> second);
+    }
+    node.versions.assign(node.sources.size(), 0);
+    node.executions = 0;
+    node.skips = 0;
+    node.failed = false;
+  }
+
+  // each node goes one stage after the latest of its sources; this is
+  // Kahn's algorithm, one stage at a time
+  std::vector<size_t> missing(nodes_.size());
+  std::vector<std::vector<size_t> > users(nodes_.size());
+  Stage stage;
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    missing[i] = nodes_[i].sources.size();
+    for (size_t j = 0; j < nodes_[i].sources.size(); ++j)
+      users[nodes_[i].sources[j]].push_back(i);
+    if (missing[i] == 0)
+      stage.push_back(i);
+  }
+
+  stages_.clear();
+  size_t n_sorted = 0;
+  while (!stage.empty()) {
+    stages_.push_back(stage);
+    n_sorted += stage.size();
+
+    Stage next;
+    for (size_t i = 0; i < stage.size(); ++i) {
+      const std::vector<size_t>& crt_users = users[stage[i]];
+      for (size_t j = 0; j < crt_users.size(); ++j) {
+        if (--missing[crt_users[j]] == 0)
+          next.push_back(crt_users[j]);
+      }
+    }
+    stage.swap(next);
+  }
+
+  if (n_sorted < nodes_.size()) {
+    stages_.clear();
+    throw PortError("The processor connections form a cycle "
+      "(ProcessorGraph::build).");
+  }
+
+  built_ = true;
+}
+
+void ProcessorGraph::clear()
+{
+  nodes_.clear();
+  indices_.clear();
+  stages_.clear();
+  built_ = false;
+}
+
+void ProcessorGraph::run()
+{
+  if (!built_)
+    build();
+
+  // outputs that are not refreshed in this cycle keep their old values, but
+  // the processors that are run need to see their sources as stale
+  for (size_t i = 0; i < nodes_.size(); ++i)
+    nodes_[i].processor -> invalidateCache();
+
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    const Stage& stage = stages_[i];
+    if (stage.size() == 1 || n_threads_ <= 1) {
+      for (size_t j = 0; j < stage.size(); ++j)
+        runNode_(stage[j]);
+    } else {
+      runStage_(stage);
+    }
+  }
+}
+
+void ProcessorGraph::setThreads(unsigned n)
+{
+  if (n == 0)
+    n = 1;
+  if (n == n_threads_)
+    return;
+
+  stopWorkers_();
+  n_threads_ = n;
+  stopping_ = false;
+  for (unsigned i = 1; i < n_threads_; ++i) {
+    workers_.push_back(boost::shared_ptr<boost::thread>(new boost::thread(
+      boost::bind(&ProcessorGraph::workerLoop_, this))));
+  }
+}
+
+std::vector<std::string> ProcessorGraph::getOrder() const
+{
+  std::vector<std::string> res;
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    for (size_t j = 0; j < stages_[i].size(); ++j)
+      res.push_back(nodes_[stages_[i][j]].name);
+  }
+
+  return res;
+}
+
+unsigned long ProcessorGraph::getExecutionCount(const std::string& name) const
+{
+  return getNode_(name).executions;
+}
+
+unsigned long ProcessorGraph::getSkipCount(const std::string& name) const
+{
+  return getNode_(name).skips;
+}
+
+const ProcessorGraph::Node& ProcessorGraph::getNode_(const std::string& name)
+  const
+{
+  std::map<std::string, size_t>::const_iterator i = indices_.find(name);
+  if (i == indices_.end())
+    throw PortError("Unknown processor: " + name +
+      " (ProcessorGraph::getNode_).");
+  return nodes_[i -> second];
+}
+
+void ProcessorGraph::runNode_(size_t i)
+{
+  Node& node = nodes_[i];
+
+  // a processor can't run on the outputs of a failed one; pulling them would
+  // run the failed processor again, possibly on several threads at once
+  node.failed = false;
+  for (size_t j = 0; j < node.sources.size(); ++j) {
+    if (nodes_[node.sources[j]].failed) {
+      node.failed = true;
+      node.processor -> stale_ = true;
+      return;
+    }
+  }
+
+  // processors without inputs decide by themselves whether anything changed
+  bool stale = (node.executions == 0 || node.sources.empty() ||
+    node.processor -> stale_);
+  node.processor -> stale_ = false;
+  for (size_t j = 0; j < node.sources.size(); ++j) {
+    const unsigned long version =
+      nodes_[node.sources[j]].processor -> getVersion();
+    if (version != node.versions[j]) {
+      node.versions[j] = version;
+      stale = true;
+    }
+  }
+
+  if (stale) {
+    node.failed = (node.processor -> run_() != 0);
+    ++node.executions;
+  } else {
+    ++node.skips;
+  }
+
+  // a processor that failed is tried again in the next cycle
+  if (node.failed)
+    node.processor -> stale_ = true;
+  else
+    node.processor -> markValid();
+}
+
+void ProcessorGraph::runStage_(const Stage& stage)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    stage_ = &stage;
+    next_task_ = 0;
+    remaining_ = stage.size();
+    error_.clear();
+    work_cond_.notify_all();
+  }
+
+  // this thread helps, too
+  work_();
+
+  boost::unique_lock<boost::mutex> lock(mutex_);
+  while (remaining_ > 0)
+    done_cond_.wait(lock);
+  stage_ = 0;
+
+  if (!error_.empty())
+    throw Exception(error_);
+}
+
+void ProcessorGraph::work_()
+{
+  for (;;) {
+    size_t i;
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (!stage_ || next_task_ >= stage_ -> size())
+        return;
+      i = (*stage_)[next_task_++];
+    }
+
+    std::string error;
+    try {
+      runNode_(i);
+    }
+    catch (const std::exception& e) {
+      error = e.what();
+    }
+
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (!error.empty() && error_.empty())
+      error_ = error;
+    if (--remaining_ == 0)
+      done_cond_.notify_all();
+  }
+}
+
+void ProcessorGraph::workerLoop_()
+{
+  for (;;) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!stopping_ && (!stage_ || next_task_ >= stage_ -> size()))
+        work_cond_.wait(lock);
+      if (stopping_)
+        return;
+    }
+
+    work_();
+  }
+}
+
+void ProcessorGraph::stopWorkers_()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    stopping_ = true;
+    work_cond_.notify_all();
+  }
+  for (size_t i = 0; i < workers_.size(); ++i)
+    workers_[i] -> join();
+  workers_.clear();
+}
@@ -0,0 +1,132 @@
+/** @file processor_graph.h
+ *  @brief Defines a class that schedules the processors once per display
+ *  cycle, in dependency order.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef PROCESSOR_GRAPH_H_
+#define PROCESSOR_GRAPH_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "processor/base_processor.h"
+
+/** @brief Run a set of connected processors, once per display cycle.
+ *
+ *  The processors are added by name, after their ports were connected. When
+ *  the graph is built, the connections are used to sort the processors
+ *  topologically, grouping them into stages: every processor depends only on
+ *  processors from earlier stages. All the sources of a processor have to be
+ *  part of the graph, so that nothing is run behind the graph's back.
+ *
+ *  In each cycle, @a run executes every processor at most once, stage by
+ *  stage. A processor whose sources all kept the same version since it last
+ *  ran is skipped, and keeps its old output, unless its settings changed.
+ *  A processor that fails is run again in the next cycle, and so are the
+ *  processors using it, which are not run in the cycle of the failure.
+ *  The processors within a stage are independent, so they are spread over a
+ *  few worker threads.
+ *
+ *  The graph does not own the processors.
+ */
+class ProcessorGraph : boost::noncopyable {
+ public:
+  /// Constructor.
+  ProcessorGraph() : n_threads_(1), built_(false), stopping_(false),
+    stage_(0), next_task_(0), remaining_(0) {}
+
+  /// Destructor. Stops the worker threads.
+  ~ProcessorGraph() { stopWorkers_(); }
+
+  /// Add a processor. This has to be done before @a build.
+  void add(const std::string& name, BaseProcessor* processor);
+
+  /// Find out whether the graph has a processor with the given name.
+  bool has(const std::string& name) const
+    { return indices_.count(name) > 0; }
+
+  /** @brief Sort the processors in the order in which they should run.
+   *
+   *  Throws @a PortError if some processor gets its input from a processor
+   *  that is not part of the graph, or if the connections form a cycle.
+   */
+  void build();
+
+  /// Remove all the processors.
+  void clear();
+
+  /// Run all the processors that need to, for a new display cycle.
+  void run();
+
+  /** @brief Set the number of threads used to run the processors.
+   *
+   *  This includes the thread calling @a run, so one thread means that
+   *  everything is run serially.
+   */
+  void setThreads(unsigned n);
+  /// Get the number of threads used to run the processors.
+  unsigned getThreads() const { return n_threads_; }
+
+  /// Get the names of the processors in the order in which they are run.
+  std::vector<std::string> getOrder() const;
+
+  /// Get the number of stages, i.e., the length of the longest chain.
+  size_t getStageCount() const { return stages_.size(); }
+
+  /// Get the number of times a processor was executed by the graph.
+  unsigned long getExecutionCount(const std::string& name) const;
+  /// Get the number of cycles in which a processor was skipped.
+  unsigned long getSkipCount(const std::string& name) const;
+
+ private:
+  struct Node {
+    std::string                 name;
+    BaseProcessor*              processor;
+    /// Indices of the nodes that this one gets its inputs from.
+    std::vector<size_t>         sources;
+    /// Versions of the sources the last time this node ran.
+    std::vector<unsigned long>  versions;
+    unsigned long               executions;
+    unsigned long               skips;
+    /// Whether the node failed, or was held back by a failure, this cycle.
+    bool                        failed;
+  };
+  typedef std::vector<size_t> Stage;
+
+  const Node& getNode_(const std::string& name) const;
+  /// Run one node, or skip it if its inputs didn't change.
+  void runNode_(size_t i);
+  /// Run the nodes in a stage, using the worker threads.
+  void runStage_(const Stage& stage);
+  /// Take tasks from the current stage until there are none left.
+  void work_();
+  void workerLoop_();
+  void stopWorkers_();
+
+  std::vector<Node>               nodes_;
+  std::map<std::string, size_t>   indices_;
+  std::vector<Stage>              stages_;
+  unsigned                        n_threads_;
+  bool                            built_;
+
+  std::vector<boost::shared_ptr<boost::thread> > workers_;
+  boost::mutex                    mutex_;
+  /// Signaled when a new stage is handed out, or when stopping.
+  boost::condition_variable       work_cond_;
+  /// Signaled when all the nodes in a stage are done.
+  boost::condition_variable       done_cond_;
+  bool                            stopping_;
+  const Stage*                    stage_;
+  size_t                          next_task_;
+  size_t                          remaining_;
+  /// Error message from a processor that threw during this stage.
+  std::string                     error_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "processor/resampler.h"
+
+#include <algorithm>
+
+#include "processor/filter_design.h"
+#include "processor/vector_ops.h"
+
+Resampler::Resampler() : up_(1), down_(1), filter_length_(16), cutoff_(0.9),
+    length_(0), n_taps_(0), position_(0), phase_(0), last_input_(),
+    n_outputs_(0), details_(), output_(this, data_),
+    details_output_(this, details_)
+{
+  registerInput_("input", &input_);
+  registerInput_("details", &details_input_);
+  registerOutput_("output", &output_);
+  registerOutput_("details", &details_output_);
+
+  design_();
+}
+
+void Resampler::setRatio(unsigned up, unsigned down)
+{
+  up_ = std::max(up, 1u);
+  down_ = std::max(down, 1u);
+
+  // the same ratio with smaller numbers needs fewer polyphase components
+  unsigned a = up_;
+  unsigned b = down_;
+  while (b != 0) {
+    const unsigned r = a % b;
+    a = b;
+    b = r;
+  }
+  up_ /= a;
+  down_ /= a;
+
+  design_();
+}
+
+void Resampler::setFilterLength(unsigned n)
+{
+  filter_length_ = std::max(n, 1u);
+  design_();
+}
+
+void Resampler::setCutoff(float cutoff)
+{
+  cutoff_ = std::min(std::max(cutoff, 0.01f), 1.0f);
+  design_();
+}
+
+void Resampler::reset()
+{
+  buffer_.assign(n_taps_ - 1, 0);
+  position_ = 0;
+  phase_ = 0;
+  n_outputs_ = 0;
+}
+
+size_t Resampler::process(const float* data, size_t n, float* out)
+{
+  const size_t history = n_taps_ - 1;
+  buffer_.resize(history + n);
+  std::copy(data, data + n, buffer_.begin() + history);
+
+  // each output needs the n_taps_ inputs ending at position_
+  const float* inputs = &buffer_[0];
+  size_t n_out = 0;
+  while (position_ < n) {
+    out[n_out++] = vectorDot(&phases_[phase_*n_taps_], inputs + position_,
+      n_taps_);
+
+    phase_ += down_;
+    position_ += phase_/up_;
+    phase_ %= up_;
+  }
+  position_ -= n;
+
+  // keep the inputs needed by the next outputs
+  std::copy(buffer_.end() - history, buffer_.end(), buffer_.begin());
+  buffer_.resize(history);
+
+  return n_out;
+}
+
+int Resampler::init()
+{
+  if (properties_) {
+    setRatio(properties_ -> get("up", up_),
+      properties_ -> get("down", down_));
+    setFilterLength(properties_ -> get("filter_length", filter_length_));
+    setCutoff(properties_ -> get("cutoff", cutoff_));
+    setLength(properties_ -> get("length", length_));
+  }
+
+  return 0;
+}
+
+void Resampler::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("up", up_);
+    properties_ -> put("down", down_);
+    properties_ -> put("filter_length", filter_length_);
+    properties_ -> put("cutoff", cutoff_);
+    properties_ -> put("length", length_);
+  }
+}
+
+int Resampler::execute()
+{
+  const std::vector<float>& input = input_.get();
+  const Grabber::DetailsStruct& details = details_input_.get();
+
+  // find the samples that are new since the last cycle; restart if some were
+  // missed, or if the input went back or changed its rate
+  const size_t n_input = input.size();
+  size_t n_new = n_input;
+  const bool restart = (details.samplingFrequency !=
+      last_input_.samplingFrequency || details.end < last_input_.end ||
+      details.end - last_input_.end > n_input);
+  if (restart)
+    reset();
+  else
+    n_new = details.end - last_input_.end;
+  last_input_ = details;
+
+  const size_t n = (length_ > 0)?length_:std::max<size_t>(
+    n_input*up_/down_, 1);
+  if (n_new == 0 && data_.size() == n) {
+    markUnchanged();
+    markValid();
+    return 0;
+  }
+
+  scratch_.resize(getMaxOutputs(n_new));
+  const size_t n_out = (n_new > 0)?process(&input[n_input - n_new], n_new,
+    &scratch_[0]):0;
+  n_outputs_ += n_out;
+
+  // shift the window, leaving zeros where there are no outputs yet
+  if (data_.size() != n)
+    data_.resize(n, 0);
+  if (n_out >= n) {
+    std::copy(scratch_.begin() + n_out - n, scratch_.begin() + n_out,
+      data_.begin());
+  } else {
+    std::copy(data_.begin() + n_out, data_.end(), data_.begin());
+    std::copy(scratch_.begin(), scratch_.begin() + n_out,
+      data_.end() - n_out);
+  }
+
+  details_.samplingFrequency = details.samplingFrequency*up_/down_;
+  details_.size = n;
+  details_.end = n_outputs_;
+
+  markValid();
+  return 0;
+}
+
+void Resampler::design_()
+{
+  // the filter works at the upsampled rate, and has to remove both the
+  // images made by upsampling and what would alias when decimating
+  const unsigned slower = std::max(up_, down_);
+  n_taps_ = filter_length_*slower/up_ + 1;
+  const std::vector<float> h = designLowPass(n_taps_*up_,
+    0.5*cutoff_/slower, up_);
+
+  // output phase p uses the coefficients p, p + up_, p + 2*up_, ...
+  phases_.resize(n_taps_*up_);
+  for (unsigned p = 0; p < up_; ++p) {
+    for (unsigned k = 0; k < n_taps_; ++k)
+      phases_[p*n_taps_ + n_taps_ - 1 - k] = h[p + k*up_];
+  }
+
+  reset();
+}
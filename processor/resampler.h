@@ -0,0 +1,132 @@
+/** @file resampler.h
+ *  @brief Defines a processor that changes the sampling rate by a rational
+ *  factor, using a polyphase filter.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/grabber.h"
+
+/** @brief Change the sampling rate by a factor @a up/@a down.
+ *
+ *  This works like a @a Grabber for the processors that follow it: it takes
+ *  its samples from the "input" port and their details from the "details"
+ *  port, and makes a window of the most recent resampled samples available
+ *  on the "output" port, with their details on the "details" port. Only the
+ *  samples that are new since the last cycle are filtered, and the filter
+ *  keeps its state from one cycle to the next, so the output is continuous.
+ *  If samples are missed, or the input restarts, the filter restarts, too.
+ *  The end of the output window, in its details, is the number of outputs
+ *  since the filter last restarted.
+ *
+ *  The anti-aliasing filter is a windowed sinc, split into @a up polyphase
+ *  components, so that only the outputs that are kept are calculated, and
+ *  none of the zeros that upsampling would insert are multiplied. Each
+ *  output is then a dot product between one component and consecutive
+ *  inputs.
+ */
+class Resampler : public BaseProcessor {
+ public:
+  /// Constructor.
+  Resampler();
+
+  /// Set the ratio between the output and input sampling rates. This
+  /// restarts the filter.
+  void setRatio(unsigned up, unsigned down);
+  /// Get the factor by which the input is upsampled.
+  unsigned getUp() const { return up_; }
+  /// Get the factor by which the upsampled input is decimated.
+  unsigned getDown() const { return down_; }
+
+  /** @brief Set the length of the filter, in periods of the lower of the
+   *  input and output sampling rates.
+   *
+   *  Longer filters have sharper transitions. This restarts the filter.
+   */
+  void setFilterLength(unsigned n);
+  /// Get the length of the filter, in periods of the lower sampling rate.
+  unsigned getFilterLength() const { return filter_length_; }
+
+  /// Set the cutoff, as a fraction of the lower of the input and output
+  /// Nyquist frequencies. This restarts the filter.
+  void setCutoff(float cutoff);
+  /// Get the cutoff, as a fraction of the lower Nyquist frequency.
+  float getCutoff() const { return cutoff_; }
+
+  /// Set the number of samples in the output window; zero to scale the size
+  /// of the input window by the resampling ratio.
+  void setLength(unsigned n) { length_ = n; }
+  /// Get the number of samples in the output window, or zero if it follows
+  /// the input.
+  unsigned getLength() const { return length_; }
+
+  /** @brief Filter @a n new samples, writing the outputs to @a out.
+   *
+   *  @a out needs room for @a getMaxOutputs(n) samples. Returns the number
+   *  of outputs written.
+   */
+  size_t process(const float* data, size_t n, float* out);
+
+  /// Get the delay of the filter, in input samples.
+  double getDelay() const { return (n_taps_*up_ - 1)/(2.0*up_); }
+
+  /// Get the largest number of outputs that @a n new samples can produce.
+  size_t getMaxOutputs(size_t n) const { return n*up_/down_ + 1; }
+
+  /// Forget the samples seen so far.
+  void reset();
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Filter the new samples and update the output window.
+  virtual int execute();
+
+ private:
+  /// Calculate the polyphase components of the filter.
+  void design_();
+
+  unsigned                            up_;
+  unsigned                            down_;
+  unsigned                            filter_length_;
+  float                               cutoff_;
+  unsigned                            length_;
+
+  /// Number of coefficients in each polyphase component.
+  unsigned                            n_taps_;
+  /// The polyphase components, one after the other. Each is stored in
+  /// reverse order, so it lines up with the inputs it multiplies.
+  std::vector<float>                  phases_;
+  /// The last @a n_taps_ - 1 inputs, followed by the new ones.
+  std::vector<float>                  buffer_;
+  /// Index of the input at which the next output is calculated, counted
+  /// from the first new input.
+  size_t                              position_;
+  /// Polyphase component used for the next output.
+  unsigned                            phase_;
+
+  /// Details of the input at the last cycle.
+  Grabber::DetailsStruct              last_input_;
+  /// Total number of outputs since the filter was last restarted.
+  unsigned long long                  n_outputs_;
+  std::vector<float>                  scratch_;
+
+  std::vector<float>                  data_;
+  Grabber::DetailsStruct              details_;
+
+  InputPort<std::vector<float> >      input_;
+  InputPort<Grabber::DetailsStruct>   details_input_;
+  OutputPort<std::vector<float> >     output_;
+  OutputPort<Grabber::DetailsStruct>  details_output_;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "processor/sample_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/vector_ops.h"
+
+const unsigned SampleHistory::kFanout;
+
+void SampleHistory::setCapacity(size_t capacity)
+{
+  start_ = end_ = 0;
+  levels_.clear();
+  if (capacity == 0) {
+    capacity_ = 0;
+    samples_.clear();
+    return;
+  }
+
+  // find the number of levels, and round up the capacity to make the ring
+  // buffers at all levels line up
+  size_t block = 1;
+  unsigned n_levels = 0;
+  while (block*kFanout <= capacity) {
+    block *= kFanout;
+    ++n_levels;
+  }
+  // level-0 scans stop at block boundaries, so these should not straddle
+  // the end of the ring either
+  block = std::max(block, static_cast<size_t>(kFanout));
+  capacity_ = ((capacity + block - 1) / block)*block;
+
+  samples_.assign(capacity_, 0);
+  levels_.resize(n_levels);
+  size_t size = capacity_;
+  for (unsigned k = 0; k < n_levels; ++k) {
+    size /= kFanout;
+    levels_[k].mins.assign(size, 0);
+    levels_[k].maxs.assign(size, 0);
+  }
+}
+
+void SampleHistory::append(const float* data, size_t n)
+{
+  if (capacity_ == 0) {
+    end_ += n;
+    return;
+  }
+  if (n == 0)
+    return;
+
+  // only the last capacity_ samples can be stored
+  if (n > capacity_) {
+    data += n - capacity_;
+    end_ += n - capacity_;
+    n = capacity_;
+  }
+
+  const unsigned long long lo = end_;
+  const size_t pos = end_ % capacity_;
+  const size_t first = std::min(n, capacity_ - pos);
+  std::copy(data, data + first, samples_.begin() + pos);
+  std::copy(data + first, data + n, samples_.begin());
+  end_ += n;
+
+  updateLevels_(lo, end_);
+}
+
+size_t SampleHistory::appendWindow(const float* data, size_t n,
+                                   unsigned long long end)
+{
+  if (end < end_ || end_ == start_ || end < n) {
+    clear((end > n)?(end - n):0);
+  } else if (end - end_ > n) {
+    // some samples were missed; replace them by zeros
+    const unsigned long long gap = end - end_ - n;
+    if (gap >= capacity_) {
+      clear(end - n);
+    } else {
+      const std::vector<float> zeros(gap, 0.0f);
+      append(&zeros[0], gap);
+    }
+  }
+
+  const size_t n_new = std::min<unsigned long long>(end - end_, n);
+  append(data + n - n_new, n_new);
+
+  return n_new;
+}
+
+void SampleHistory::updateLevels_(unsigned long long lo, unsigned long long hi)
+{
+  unsigned long long block = 1;
+  const float* src_mins = &samples_[0];
+  const float* src_maxs = &samples_[0];
+  size_t src_size = capacity_;
+
+  for (size_t k = 0; k < levels_.size(); ++k) {
+    block *= kFanout;
+    Level& level = levels_[k];
+    const size_t size = level.mins.size();
+
+    // the ring buffers line up, so the entries making up a block are
+    // contiguous
+    for (unsigned long long j = lo / block; (j + 1)*block <= hi; ++j) {
+      const size_t src = (j*kFanout) % src_size;
+      const size_t dest = j % size;
+      level.mins[dest] = vectorMin(src_mins + src, kFanout, src_mins[src]);
+      level.maxs[dest] = vectorMax(src_maxs + src, kFanout, src_maxs[src]);
+    }
+
+    src_mins = &level.mins[0];
+    src_maxs = &level.maxs[0];
+    src_size = size;
+  }
+}
+
+bool SampleHistory::copy(unsigned long long start, size_t n, float* dest)
+  const
+{
+  if (start < getBegin() || start + n > end_)
+    return false;
+  if (n == 0)
+    return true;
+
+  const size_t pos = start % capacity_;
+  const size_t first = std::min(n, capacity_ - pos);
+  std::copy(samples_.begin() + pos, samples_.begin() + pos + first, dest);
+  std::copy(samples_.begin(), samples_.begin() + (n - first), dest + first);
+
+  return true;
+}
+
+bool SampleHistory::getMinMax(unsigned long long a, unsigned long long b,
+                              float& mn, float& mx) const
+{
+  a = std::max(a, getBegin());
+  b = std::min(b, end_);
+  if (a >= b)
+    return false;
+
+  mn = mx = samples_[a % capacity_];
+  unsigned long long x = a;
+  while (x < b) {
+    // use the largest aligned block that starts at x and fits in the range
+    size_t k = 0;
+    unsigned long long block = 1;
+    while (k < levels_.size() && x % (block*kFanout) == 0 &&
+           x + block*kFanout <= b) {
+      block *= kFanout;
+      ++k;
+    }
+
+    if (k == 0) {
+      // scan the samples up to the next block boundary
+      const unsigned long long stop = std::min(b, (x/kFanout + 1)*kFanout);
+      const float* p = &samples_[x % capacity_];
+      mn = vectorMin(p, stop - x, mn);
+      mx = vectorMax(p, stop - x, mx);
+      x = stop;
+    } else {
+      const Level& level = levels_[k - 1];
+      const size_t idx = (x / block) % level.mins.size();
+      mn = std::min(mn, level.mins[idx]);
+      mx = std::max(mx, level.maxs[idx]);
+      x += block;
+    }
+  }
+
+  return true;
+}
+
+void SampleHistory::getEnvelope(double start, double end, unsigned n,
+                                float* mins, float* maxs) const
+{
+  const double w = (end - start) / n;
+  for (unsigned i = 0; i < n; ++i) {
+    const double a = start + i*w;
+    const double b = a + w;
+    bool found = false;
+    if (b > 0) {
+      const unsigned long long ia = (a > 0)?std::floor(a):0;
+      const unsigned long long ib = std::max(
+          static_cast<unsigned long long>(std::floor(b)), ia + 1);
+      found = getMinMax(ia, ib, mins[i], maxs[i]);
+    }
+    if (!found) {
+      mins[i] = 1;
+      maxs[i] = -1;
+    }
+  }
+}
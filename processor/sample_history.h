@@ -0,0 +1,105 @@
+/** @file sample_history.h
+ *  @brief Defines a long history of samples that can be queried quickly for
+ *  minima and maxima over arbitrary intervals.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef SAMPLE_HISTORY_H_
+#define SAMPLE_HISTORY_H_
+
+#include <cstddef>
+#include <vector>
+
+/** @brief A ring buffer of samples backed by a min/max pyramid.
+ *
+ *  Samples are identified by their absolute index, i.e., the number of
+ *  samples that were appended before them. Level @a k of the pyramid holds
+ *  the minimum and maximum of each aligned block of @a kFanout^k samples, so
+ *  that the extrema over any range can be found in time proportional to the
+ *  logarithm of the range's length.
+ */
+class SampleHistory {
+ public:
+  /// Number of entries from one level that make up an entry in the next.
+  static const unsigned kFanout = 8;
+
+  /// Constructor.
+  explicit SampleHistory(size_t capacity = 0) : capacity_(0), start_(0),
+    end_(0) { setCapacity(capacity); }
+
+  /** @brief Set the number of samples to keep.
+   *
+   *  The capacity is rounded up to a multiple of the size of the coarsest
+   *  blocks in the pyramid. This clears the history.
+   */
+  void setCapacity(size_t capacity);
+
+  /// Get the number of samples that are kept.
+  size_t getCapacity() const { return capacity_; }
+
+  /// Remove all the samples. The next sample to be appended gets index
+  /// @a start.
+  void clear(unsigned long long start = 0) { start_ = end_ = start; }
+
+  /// Add @a n samples to the end of the history.
+  void append(const float* data, size_t n);
+
+  /** @brief Add the new part of a window of @a n samples that ends at the
+   *  absolute index @a end.
+   *
+   *  If the history is empty, or @a end went back, the history is restarted
+   *  at the start of the window. Samples that were missed since the last
+   *  window are replaced by zeros. Returns the number of new samples.
+   */
+  size_t appendWindow(const float* data, size_t n, unsigned long long end);
+
+  /// Get the index of the oldest sample that is still stored.
+  unsigned long long getBegin() const
+    { return (end_ - start_ > capacity_)?(end_ - capacity_):start_; }
+
+  /// Get the index one past the newest sample.
+  unsigned long long getEnd() const { return end_; }
+
+  /** @brief Copy the samples with indices in [@a start, @a start + @a n) to
+   *  @a dest.
+   *
+   *  Returns @a false, without copying anything, if some of the samples are
+   *  not stored.
+   */
+  bool copy(unsigned long long start, size_t n, float* dest) const;
+
+  /** @brief Find the extrema of the samples with indices in [@a a, @a b).
+   *
+   *  The range is clipped to the stored samples. Returns @a false if no
+   *  samples are left after clipping.
+   */
+  bool getMinMax(unsigned long long a, unsigned long long b, float& mn,
+                 float& mx) const;
+
+  /** @brief Split the range [@a start, @a end) into @a n equal bins and find
+   *  the extrema in each of them.
+   *
+   *  Each bin contains at least one sample. Bins that do not overlap the
+   *  stored samples get a minimum that is larger than the maximum.
+   */
+  void getEnvelope(double start, double end, unsigned n, float* mins,
+                   float* maxs) const;
+
+ private:
+  struct Level {
+    std::vector<float>  mins;
+    std::vector<float>  maxs;
+  };
+
+  /// Recalculate the blocks that were completed by samples in [lo, hi).
+  void updateLevels_(unsigned long long lo, unsigned long long hi);
+
+  size_t              capacity_;
+  unsigned long long  start_;
+  unsigned long long  end_;
+  std::vector<float>  samples_;
+  /// levels_[k] stores blocks of size kFanout^(k + 1).
+  std::vector<Level>  levels_;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "processor/sample_ring.h"
+
+#include <algorithm>
+
+int SampleRing::init()
+{
+  if (properties_) {
+    setLength(properties_ -> get("length", length_));
+    setHistoryLength(properties_ -> get("history", history_length_));
+  }
+
+  return 0;
+}
+
+void SampleRing::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("length", length_);
+    properties_ -> put("history", history_length_);
+  }
+}
+
+int SampleRing::execute()
+{
+  const std::vector<float>& input = input_.get();
+  const Grabber::DetailsStruct& details = details_input_.get();
+
+  const size_t n = std::max<size_t>(length_, input.size());
+  const size_t capacity = std::max<size_t>(n, history_length_);
+  if (history_.getCapacity() < capacity)
+    history_.setCapacity(capacity);
+  if (!input.empty())
+    history_.appendWindow(&input[0], input.size(), details.end);
+
+  // the samples that aren't available yet are left as zeros
+  data_.assign(n, 0);
+  const unsigned long long end = details.end;
+  unsigned long long start = std::max(history_.getBegin(),
+    (end > n)?(end - n):0ULL);
+  if (start < end)
+    history_.copy(start, end - start, &data_[n - (end - start)]);
+
+  details_ = details;
+  details_.size = n;
+
+  markValid();
+  return 0;
+}
@@ -0,0 +1,80 @@
+/** @file sample_ring.h
+ *  @brief Defines a processor that keeps the recent samples, to provide
+ *  windows longer than the input buffer.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef SAMPLE_RING_H_
+#define SAMPLE_RING_H_
+
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/grabber.h"
+#include "processor/sample_history.h"
+
+/** @brief Keep a history of the grabbed samples, and output the most recent
+ *  ones.
+ *
+ *  This takes the samples from the "input" port, and their details from the
+ *  "details" port. It outputs the last @a length samples on the "output"
+ *  port, starting with zeros until enough samples were collected, and their
+ *  details on the "details" port. A length of zero, or one smaller than the
+ *  input, means that the input is passed on as it is.
+ *
+ *  Processors that only need part of a long stretch of samples can instead
+ *  read the whole history from the "history" port; its capacity is set
+ *  separately, so that it doesn't have to be copied out in every cycle.
+ *
+ *  This is meant to be shared by all the FFTs that need more samples than
+ *  the input buffer holds.
+ */
+class SampleRing : public BaseProcessor {
+ public:
+  /// Constructor.
+  SampleRing() : length_(0), history_length_(0), details_(),
+    output_(this, data_), details_output_(this, details_),
+    history_output_(this, history_)
+  {
+    registerInput_("input", &input_);
+    registerInput_("details", &details_input_);
+    registerOutput_("output", &output_);
+    registerOutput_("details", &details_output_);
+    registerOutput_("history", &history_output_);
+  }
+
+  /// Set the number of samples in the output.
+  void setLength(unsigned n) { length_ = n; }
+  /// Get the number of samples in the output.
+  unsigned getLength() const { return length_; }
+
+  /// Set the minimum number of samples kept in the history.
+  void setHistoryLength(unsigned n) { history_length_ = n; }
+  /// Get the minimum number of samples kept in the history.
+  unsigned getHistoryLength() const { return history_length_; }
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Add the new samples to the history, and copy out the recent ones.
+  virtual int execute();
+
+ private:
+  unsigned                            length_;
+  unsigned                            history_length_;
+  SampleHistory                       history_;
+  std::vector<float>                  data_;
+  Grabber::DetailsStruct              details_;
+
+  InputPort<std::vector<float> >      input_;
+  InputPort<Grabber::DetailsStruct>   details_input_;
+  OutputPort<std::vector<float> >     output_;
+  OutputPort<Grabber::DetailsStruct>  details_output_;
+  OutputPort<SampleHistory>           history_output_;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "processor/spectral_average.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/vector_ops.h"
+#include "utils/exception.h"
+#include "utils/misc.h"
+
+SpectralAverage::SpectralAverage() : mode_(EXPONENTIAL), time_constant_(1),
+    frames_(16), decay_(10), overlap_(0.5), n_bins_(0), size_(0), start_(0),
+    step_(0), n_frames_(0), last_end_(0), last_segment_end_(0), ring_pos_(0),
+    ring_count_(0), output_(), output_port_(this, output_)
+{
+  registerInput_("fft", &fft_);
+  registerInput_("details", &details_);
+  registerOutput_("output", &output_port_);
+}
+
+void SpectralAverage::setMode(Mode mode)
+{
+  mode_ = mode;
+  reset();
+}
+
+void SpectralAverage::setFrames(unsigned n)
+{
+  frames_ = std::max(n, 1u);
+  ring_.assign(frames_*n_bins_, 0);
+  reset();
+}
+
+void SpectralAverage::setOverlap(float f)
+{
+  overlap_ = std::min(std::max(f, 0.0f), 0.95f);
+}
+
+void SpectralAverage::reset()
+{
+  n_frames_ = 0;
+  last_segment_end_ = 0;
+  ring_pos_ = 0;
+  ring_count_ = 0;
+  std::fill(average_.begin(), average_.end(), 0);
+  markStale();
+}
+
+SpectralAverage::Mode SpectralAverage::getMode(const std::string& name)
+{
+  if (name == "exponential")
+    return EXPONENTIAL;
+  else if (name == "linear")
+    return LINEAR;
+  else if (name == "max")
+    return PEAK_MAX;
+  else if (name == "min")
+    return PEAK_MIN;
+  else if (name == "welch")
+    return WELCH;
+  else
+    throw Exception("Unknown averaging mode: " + name +
+      " (SpectralAverage::getMode).");
+}
+
+std::string SpectralAverage::getModeName(Mode mode)
+{
+  switch (mode) {
+    case LINEAR: return "linear";
+    case PEAK_MAX: return "max";
+    case PEAK_MIN: return "min";
+    case WELCH: return "welch";
+    default: return "exponential";
+  }
+}
+
+int SpectralAverage::init()
+{
+  if (properties_) {
+    setMode(getMode(trim(properties_ -> get("mode",
+      getModeName(mode_)))));
+    setTimeConstant(properties_ -> get("time_constant", time_constant_));
+    setFrames(properties_ -> get("frames", frames_));
+    setDecay(properties_ -> get("decay", decay_));
+    setOverlap(properties_ -> get("overlap", overlap_));
+  }
+
+  return 0;
+}
+
+void SpectralAverage::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("mode", getModeName(mode_));
+    properties_ -> put("time_constant", time_constant_);
+    properties_ -> put("frames", frames_);
+    properties_ -> put("decay", decay_);
+    properties_ -> put("overlap", overlap_);
+  }
+}
+
+int SpectralAverage::execute()
+{
+  const FftProcessor::OutputStruct& fft = fft_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+
+  // a frame without new samples doesn't add anything
+  if (details.end == last_end_ && n_frames_ > 0) {
+    markUnchanged();
+    markValid();
+    return 0;
+  }
+
+  // start again if the layout of the spectrum changed; this is the only
+  // place where memory is allocated
+  if (fft.n_bins != n_bins_ || fft.size != size_ || fft.start != start_ ||
+      fft.step != step_)
+  {
+    n_bins_ = fft.n_bins;
+    size_ = fft.size;
+    start_ = fft.start;
+    step_ = fft.step;
+    power_.resize(n_bins_);
+    average_.resize(n_bins_);
+    ring_.assign(frames_*n_bins_, 0);
+    data_.resize(n_bins_);
+    reset();
+  }
+
+  // time covered by the new samples
+  const unsigned long long n_new = (n_frames_ > 0 && details.end > last_end_)?
+    (details.end - last_end_):size_;
+  const float dt = (details.samplingFrequency > 0)?
+    (n_new/details.samplingFrequency):0;
+  last_end_ = details.end;
+
+  // Welch segments can't overlap by more than the given fraction
+  if (mode_ == WELCH && n_frames_ > 0 &&
+      details.end < last_segment_end_ + (1 - overlap_)*size_)
+  {
+    markUnchanged();
+    markValid();
+    return 0;
+  }
+  last_segment_end_ = details.end;
+
+  if (n_bins_ > 0) {
+    vectorNorm(reinterpret_cast<const float*>(fft.fft), n_bins_, &power_[0]);
+
+    float* average = &average_[0];
+    const float* power = &power_[0];
+    if (n_frames_ == 0 && mode_ != LINEAR && mode_ != WELCH) {
+      std::copy(power_.begin(), power_.end(), average_.begin());
+    } else {
+      switch (mode_) {
+        case EXPONENTIAL:
+          vectorMix(average, power, n_bins_, (time_constant_ > 0)?
+            (1 - std::exp(-dt/time_constant_)):1);
+          break;
+        case PEAK_MAX:
+          vectorHoldMax(average, power, n_bins_,
+            std::pow(10.0f, -decay_*dt/10));
+          break;
+        case PEAK_MIN:
+          vectorHoldMin(average, power, n_bins_,
+            std::pow(10.0f, decay_*dt/10));
+          break;
+        default:
+          addToRing_();
+      }
+    }
+  }
+  ++n_frames_;
+
+  // the ring modes keep the sum of the frames
+  const float scale = (mode_ == LINEAR || mode_ == WELCH)?
+    (1.0f/std::max(ring_count_, 1u)):1;
+  for (unsigned i = 0; i < n_bins_; ++i)
+    data_[i] = Complex(std::sqrt(average_[i]*scale), 0);
+
+  output_.fft = data_.empty()?0:&data_[0];
+  output_.size = size_;
+  output_.n_bins = n_bins_;
+  output_.start = start_;
+  output_.step = step_;
+
+  markValid();
+  return 0;
+}
+
+void SpectralAverage::addToRing_()
+{
+  float* slot = &ring_[ring_pos_*n_bins_];
+  float* sum = &average_[0];
+  const float* power = &power_[0];
+  if (ring_count_ < frames_) {
+    vectorAdd(sum, power, n_bins_);
+    ++ring_count_;
+  } else {
+    vectorAddSub(sum, power, slot, n_bins_);
+  }
+  std::copy(power, power + n_bins_, slot);
+
+  // every time the ring fills, the sum is recalculated, so that rounding
+  // errors don't build up
+  if (++ring_pos_ == frames_) {
+    ring_pos_ = 0;
+    std::fill(average_.begin(), average_.end(), 0);
+    for (unsigned k = 0; k < frames_; ++k)
+      vectorAdd(sum, &ring_[k*n_bins_], n_bins_);
+  }
+}
@@ -0,0 +1,118 @@
+/** @file spectral_average.h
+ *  @brief Defines a processor that averages spectra over time.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef SPECTRAL_AVERAGE_H_
+#define SPECTRAL_AVERAGE_H_
+
+#include <string>
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/fft.h"
+#include "processor/grabber.h"
+
+/** @brief Average the power spectra coming from an FFT.
+ *
+ *  The spectra are read from the "fft" port, and the details of the samples
+ *  they come from from the "details" port; frames that bring no new samples
+ *  are not counted. The "output" port has the same layout as the output of
+ *  an @a FftProcessor, with the square root of the averaged power in the
+ *  real parts, so it can be used wherever an FFT is.
+ *
+ *  The modes are:
+ *  - exponential: each frame moves the average towards its power, with a
+ *    time constant of @a time_constant seconds;
+ *  - linear: the mean of the last @a frames frames;
+ *  - max, min: the largest or smallest power seen, falling or rising by
+ *    @a decay dB per second;
+ *  - welch: the mean of the last @a frames segments, where frames are only
+ *    used as segments if they overlap the previous segment by at most a
+ *    fraction @a overlap of the FFT size.
+ *
+ *  All the buffers are allocated when the size of the spectrum changes, and
+ *  the frames are accumulated in place, using SSE when it is available.
+ */
+class SpectralAverage : public BaseProcessor {
+ public:
+  /// Averaging modes.
+  enum Mode { EXPONENTIAL, LINEAR, PEAK_MAX, PEAK_MIN, WELCH };
+
+  /// Constructor.
+  SpectralAverage();
+
+  /// Set the averaging mode. This restarts the average.
+  void setMode(Mode mode);
+  /// Get the averaging mode.
+  Mode getMode() const { return mode_; }
+
+  /// Set the time constant for exponential averaging, in seconds.
+  void setTimeConstant(float t) { time_constant_ = t; }
+  /// Set the number of frames in linear and Welch averaging. This restarts
+  /// the average.
+  void setFrames(unsigned n);
+  /// Set the rate at which held peaks fall back, in dB per second.
+  void setDecay(float d) { decay_ = d; }
+  /// Set the largest overlap between Welch segments, as a fraction of the
+  /// FFT size.
+  void setOverlap(float f);
+
+  /// Start averaging again, from the next frame.
+  void reset();
+
+  /// Get the mode with the given name ("exponential", "linear", "max",
+  /// "min", or "welch"). Throws @a Exception if there is no such mode.
+  static Mode getMode(const std::string& name);
+  /// Get the name of a mode.
+  static std::string getModeName(Mode mode);
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Add the new frame to the average.
+  virtual int execute();
+
+ private:
+  /// Add a frame to the ring used by linear and Welch averaging.
+  void addToRing_();
+
+  Mode                                mode_;
+  float                               time_constant_;
+  unsigned                            frames_;
+  float                               decay_;
+  float                               overlap_;
+
+  /// Layout of the spectra being averaged.
+  unsigned                            n_bins_;
+  unsigned                            size_;
+  double                              start_;
+  double                              step_;
+
+  /// Number of frames averaged since the last reset.
+  unsigned long                       n_frames_;
+  unsigned long long                  last_end_;
+  unsigned long long                  last_segment_end_;
+
+  std::vector<float>                  power_;
+  /// The running average, for the exponential and peak modes, or the sum of
+  /// the frames in the ring, for the linear and Welch modes.
+  std::vector<float>                  average_;
+  /// The last @a frames_ frames, one after the other.
+  std::vector<float>                  ring_;
+  unsigned                            ring_pos_;
+  unsigned                            ring_count_;
+
+  std::vector<Complex>                data_;
+  FftProcessor::OutputStruct          output_;
+
+  InputPort<FftProcessor::OutputStruct>   fft_;
+  InputPort<Grabber::DetailsStruct>       details_;
+  OutputPort<FftProcessor::OutputStruct>  output_port_;
+};
+
+#endif
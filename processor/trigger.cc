@@ -0,0 +1,79 @@
+#include "processor/trigger.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/vector_ops.h"
+#include "utils/exception.h"
+
+void Trigger::setSlope(const std::string& s)
+{
+  if (s == "rising")
+    setSlope(RISING);
+  else if (s == "falling")
+    setSlope(FALLING);
+  else
+    throw Exception("Unknown trigger slope: " + s + ".");
+}
+
+void Trigger::reset()
+{
+  armed_ = false;
+  end_ = 0;
+  holdoff_end_ = 0;
+  events_.clear();
+}
+
+void Trigger::scan(const float* data, size_t n, unsigned long long start)
+{
+  if (start != end_)
+    armed_ = false;
+
+  const bool rising = (slope_ == RISING);
+  const float arm_level = rising?(level_ - hysteresis_):(level_ + hysteresis_);
+
+  size_t i = 0;
+  if (holdoff_end_ > start)
+    i = std::min<unsigned long long>(n, holdoff_end_ - start);
+
+  while (i < n) {
+    if (!armed_) {
+      // wait for the signal to go past the arming level
+      i += rising?vectorFindBelow(data + i, n - i, arm_level):
+                  vectorFindAbove(data + i, n - i, arm_level);
+      if (i < n)
+        armed_ = true;
+    } else {
+      // wait for the signal to cross the trigger level
+      i += rising?vectorFindAbove(data + i, n - i, level_):
+                  vectorFindBelow(data + i, n - i, level_);
+      if (i >= n)
+        break;
+
+      // the sample before the crossing might be from the previous block
+      const float prev = (i > 0)?data[i - 1]:last_;
+      float frac = 1;
+      if (data[i] != prev)
+        frac = std::min(std::max((level_ - prev)/(data[i] - prev), 0.0f), 1.0f);
+
+      const double pos = (double)start + i - 1 + frac;
+      events_.push_back(pos);
+      armed_ = false;
+
+      // skip the holdoff period
+      holdoff_end_ = std::ceil(pos + holdoff_);
+      if (holdoff_end_ > start + i)
+        i = std::min<unsigned long long>(n, holdoff_end_ - start);
+    }
+  }
+
+  if (n > 0)
+    last_ = data[n - 1];
+  end_ = start + n;
+}
+
+void Trigger::dropEventsBefore(double pos)
+{
+  while (!events_.empty() && events_.front() < pos)
+    events_.pop_front();
+}
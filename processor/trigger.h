@@ -0,0 +1,93 @@
+/** @file trigger.h
+ *  @brief Defines a trigger that finds level crossings in a stream of
+ *  samples.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef TRIGGER_H_
+#define TRIGGER_H_
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+/** @brief Find the points where a signal crosses a given level.
+ *
+ *  The samples are fed in blocks, by calling scan, and each sample is
+ *  looked at only once. The trigger has to be armed, by the signal going
+ *  beyond the level by more than the hysteresis on the opposite side of the
+ *  slope, before it can fire again. After it fires, it ignores the signal
+ *  for the holdoff time.
+ *
+ *  Trigger events are stored as absolute, fractional sample positions,
+ *  obtained by interpolating linearly between the samples on either side of
+ *  the crossing.
+ */
+class Trigger {
+ public:
+  /// The direction of the crossings.
+  enum Slope { RISING, FALLING };
+
+  /// Constructor.
+  Trigger() : level_(0), hysteresis_(0), slope_(RISING), holdoff_(0),
+    armed_(false), end_(0), holdoff_end_(0), last_(0) {}
+
+  /// Set the trigger level.
+  void setLevel(float l) { level_ = l; }
+  /// Get the trigger level.
+  float getLevel() const { return level_; }
+
+  /// Set how far the signal has to go past the level to arm the trigger.
+  void setHysteresis(float h) { hysteresis_ = (h > 0)?h:0; }
+  /// Get the hysteresis.
+  float getHysteresis() const { return hysteresis_; }
+
+  /// Set the slope of the crossings ("rising" or "falling").
+  void setSlope(const std::string& s);
+  /// Set the slope of the crossings.
+  void setSlope(Slope s) { slope_ = s; armed_ = false; }
+  /// Get the slope of the crossings.
+  Slope getSlope() const { return slope_; }
+  /// Get the slope of the crossings as a string.
+  std::string getSlopeString() const
+    { return (slope_ == RISING)?"rising":"falling"; }
+
+  /// Set the holdoff, in samples.
+  void setHoldoff(double h) { holdoff_ = (h > 0)?h:0; }
+  /// Get the holdoff, in samples.
+  double getHoldoff() const { return holdoff_; }
+
+  /// Forget about the trigger events and the state of the trigger.
+  void reset();
+
+  /** @brief Look for trigger events in @a n new samples, the first of which
+   *  has absolute index @a start.
+   *
+   *  If the samples do not follow the last ones that were scanned, the
+   *  trigger is disarmed first.
+   */
+  void scan(const float* data, size_t n, unsigned long long start);
+
+  /// Get the trigger events found so far, from oldest to newest.
+  const std::deque<double>& getEvents() const { return events_; }
+
+  /// Remove the events that happened before the position @a pos.
+  void dropEventsBefore(double pos);
+
+ private:
+  float               level_;
+  float               hysteresis_;
+  Slope               slope_;
+  double              holdoff_;
+
+  bool                armed_;
+  /// Absolute index one past the last scanned sample.
+  unsigned long long  end_;
+  /// The trigger is ignoring samples before this index.
+  unsigned long long  holdoff_end_;
+  /// Last scanned sample.
+  float               last_;
+  std::deque<double>  events_;
+};
+
+#endif
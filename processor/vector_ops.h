@@ -0,0 +1,232 @@
+/** @file vector_ops.h
+ *  @brief Defines some simple operations on float arrays, using SSE
+ *  instructions when they are available.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef VECTOR_OPS_H_
+#define VECTOR_OPS_H_
+
+#include <cstddef>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+/// Find the smallest of @a n floats, starting from the value @a init.
+inline float vectorMin(const float* data, size_t n, float init)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  if (n >= 8) {
+    __m128 m0 = _mm_loadu_ps(data);
+    __m128 m1 = _mm_loadu_ps(data + 4);
+    for (i = 8; i + 8 <= n; i += 8) {
+      m0 = _mm_min_ps(m0, _mm_loadu_ps(data + i));
+      m1 = _mm_min_ps(m1, _mm_loadu_ps(data + i + 4));
+    }
+    float tmp[4];
+    _mm_storeu_ps(tmp, _mm_min_ps(m0, m1));
+    for (int j = 0; j < 4; ++j)
+      if (tmp[j] < init)
+        init = tmp[j];
+  }
+#endif
+  for (; i < n; ++i)
+    if (data[i] < init)
+      init = data[i];
+
+  return init;
+}
+
+/// Find the largest of @a n floats, starting from the value @a init.
+inline float vectorMax(const float* data, size_t n, float init)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  if (n >= 8) {
+    __m128 m0 = _mm_loadu_ps(data);
+    __m128 m1 = _mm_loadu_ps(data + 4);
+    for (i = 8; i + 8 <= n; i += 8) {
+      m0 = _mm_max_ps(m0, _mm_loadu_ps(data + i));
+      m1 = _mm_max_ps(m1, _mm_loadu_ps(data + i + 4));
+    }
+    float tmp[4];
+    _mm_storeu_ps(tmp, _mm_max_ps(m0, m1));
+    for (int j = 0; j < 4; ++j)
+      if (tmp[j] > init)
+        init = tmp[j];
+  }
+#endif
+  for (; i < n; ++i)
+    if (data[i] > init)
+      init = data[i];
+
+  return init;
+}
+
+/// Find the index of the first of @a n floats that is larger than @a value.
+/// Returns @a n if there is no such element.
+inline size_t vectorFindAbove(const float* data, size_t n, float value)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  const __m128 v = _mm_set1_ps(value);
+  for (; i + 4 <= n; i += 4)
+    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(data + i), v)) != 0)
+      break;
+#endif
+  for (; i < n; ++i)
+    if (data[i] > value)
+      break;
+
+  return i;
+}
+
+/// Find the index of the first of @a n floats that is smaller than @a value.
+/// Returns @a n if there is no such element.
+inline size_t vectorFindBelow(const float* data, size_t n, float value)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  const __m128 v = _mm_set1_ps(value);
+  for (; i + 4 <= n; i += 4)
+    if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(data + i), v)) != 0)
+      break;
+#endif
+  for (; i < n; ++i)
+    if (data[i] < value)
+      break;
+
+  return i;
+}
+
+/// Calculate the dot product of two arrays of @a n floats.
+inline float vectorDot(const float* a, const float* b, size_t n)
+{
+  size_t i = 0;
+  float res = 0;
+#ifdef __SSE__
+  if (n >= 8) {
+    // two accumulators, to hide the latency of the additions
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+      s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i),
+        _mm_loadu_ps(b + i)));
+      s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+        _mm_loadu_ps(b + i + 4)));
+    }
+    float tmp[4];
+    _mm_storeu_ps(tmp, _mm_add_ps(s0, s1));
+    res = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+  }
+#endif
+  for (; i < n; ++i)
+    res += a[i]*b[i];
+
+  return res;
+}
+
+/// Find the squared magnitudes of @a n complex numbers, stored as pairs of
+/// real and imaginary parts.
+inline void vectorNorm(const float* data, size_t n, float* out)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= n; i += 4) {
+    const __m128 a = _mm_loadu_ps(data + 2*i);
+    const __m128 b = _mm_loadu_ps(data + 2*i + 4);
+    const __m128 a2 = _mm_mul_ps(a, a);
+    const __m128 b2 = _mm_mul_ps(b, b);
+    // add the squares of the real parts to those of the imaginary parts
+    _mm_storeu_ps(out + i, _mm_add_ps(
+      _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)),
+      _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1))));
+  }
+#endif
+  for (; i < n; ++i)
+    out[i] = data[2*i]*data[2*i] + data[2*i + 1]*data[2*i + 1];
+}
+
+/// Move each of @a n floats in @a acc a fraction @a a of the way towards
+/// the corresponding element of @a data.
+inline void vectorMix(float* acc, const float* data, size_t n, float a)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  const __m128 va = _mm_set1_ps(a);
+  for (; i + 4 <= n; i += 4) {
+    const __m128 x = _mm_loadu_ps(acc + i);
+    _mm_storeu_ps(acc + i, _mm_add_ps(x, _mm_mul_ps(va,
+      _mm_sub_ps(_mm_loadu_ps(data + i), x))));
+  }
+#endif
+  for (; i < n; ++i)
+    acc[i] += a*(data[i] - acc[i]);
+}
+
+/// Add @a n floats from @a data to @a acc.
+inline void vectorAdd(float* acc, const float* data, size_t n)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i),
+      _mm_loadu_ps(data + i)));
+#endif
+  for (; i < n; ++i)
+    acc[i] += data[i];
+}
+
+/// Add @a n floats from @a add to @a acc, and subtract those from @a sub.
+inline void vectorAddSub(float* acc, const float* add, const float* sub,
+  size_t n)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i),
+      _mm_sub_ps(_mm_loadu_ps(add + i), _mm_loadu_ps(sub + i))));
+#endif
+  for (; i < n; ++i)
+    acc[i] += add[i] - sub[i];
+}
+
+/// Multiply each of @a n floats in @a held by @a factor, and raise it to
+/// the corresponding element of @a data, if that is larger.
+inline void vectorHoldMax(float* held, const float* data, size_t n,
+  float factor)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  const __m128 f = _mm_set1_ps(factor);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(held + i, _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(held + i), f),
+      _mm_loadu_ps(data + i)));
+#endif
+  for (; i < n; ++i) {
+    const float x = held[i]*factor;
+    held[i] = (data[i] > x)?data[i]:x;
+  }
+}
+
+/// Multiply each of @a n floats in @a held by @a factor, and lower it to
+/// the corresponding element of @a data, if that is smaller.
+inline void vectorHoldMin(float* held, const float* data, size_t n,
+  float factor)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  const __m128 f = _mm_set1_ps(factor);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(held + i, _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(held + i), f),
+      _mm_loadu_ps(data + i)));
+#endif
+  for (; i < n; ++i) {
+    const float x = held[i]*factor;
+    held[i] = (data[i] < x)?data[i]:x;
+  }
+}
+
+#endif
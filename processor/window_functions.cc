@@ -1,43 +1,93 @@
 #include "processor/window_functions.h"
 
+#include <algorithm>
 #include <cmath>
 
+#include <boost/thread/locks.hpp>
+
 #include "input/base_input.h"
 
 int GenericWindow::execute()
 {
-  const std::vector<float>& data = *boost::any_cast<const std::vector<float>*>
-    (inputs_["input"] -> getOutput());
-  unsigned sz = data.size();
-
-  if (windowed_.size() != sz) {
+  const std::vector<float>& data = input_.get();
+  const unsigned sz = (size_ > 0)?size_:data.size();
+  const std::vector<float>& window = getWindow(sz);
+  if (windowed_.size() != sz)
     windowed_.resize(sz);
-    precalculateWindow();
-  }
 
-  for (unsigned i = 0; i < sz; ++i) {
-    windowed_[i] = data[i]*window_[i];
+  // align the ends of the input and of the window
+  const unsigned n = std::min<size_t>(sz, data.size());
+  const unsigned pad = sz - n;
+  const float* src = &data[0] + data.size() - n;
+  std::fill(windowed_.begin(), windowed_.begin() + pad, 0);
+  for (unsigned i = 0; i < n; ++i) {
+    windowed_[pad + i] = src[i]*window[pad + i];
   }
 
   markValid();
   return 0;
 }
 
+int GenericWindow::init()
+{
+  if (properties_)
+    setSize(properties_ -> get("size", size_));
+
+  return 0;
+}
+
+void GenericWindow::updateProperties()
+{
+  if (properties_)
+    properties_ -> put("size", size_);
+}
+
+const std::vector<float>& GenericWindow::getWindow(unsigned size)
+{
+  // the entries of a map stay where they are when others are added
+  boost::lock_guard<boost::mutex> lock(windows_mutex_);
+  std::vector<float>& window = windows_[size];
+  if (window.size() != size)
+    precalculateWindow(size, window);
+
+  return window;
+}
+
+void GenericWindow::clearWindows()
+{
+  boost::lock_guard<boost::mutex> lock(windows_mutex_);
+  windows_.clear();
+}
+
 template <class T>
 inline T sqr(T x)
 {
   return x*x;
 }
 
-void GaussianWindow::precalculateWindow()
+int GaussianWindow::init()
+{
+  if (properties_)
+    setStd(properties_ -> get("sigma", sigma_));
+
+  return GenericWindow::init();
+}
+
+void GaussianWindow::updateProperties()
+{
+  GenericWindow::updateProperties();
+  if (properties_)
+    properties_ -> put("sigma", sigma_);
+}
+
+void GaussianWindow::precalculateWindow(unsigned size,
+  std::vector<float>& window) const
 {
-  unsigned sz = getSize();
-  if (window_.size() != sz)
-    window_.resize(sz);
+  window.resize(size);
 
-  float sz2 = sz/2.0;
-  for (unsigned i = 0; i < sz; ++i) {
+  float sz2 = size/2.0;
+  for (unsigned i = 0; i < size; ++i) {
     float x = ((float)i - sz2) / sz2;
-    window_[i] = std::exp(-0.5*sqr(x/sigma_));
+    window[i] = std::exp(-0.5*sqr(x/sigma_));
   }
 }
@@ -7,43 +7,69 @@
 #ifndef WINDOW_FUNCTIONS_H_
 #define WINDOW_FUNCTIONS_H_
 
+#include <map>
 #include <vector>
 
+#include <boost/thread/mutex.hpp>
+
 #include "processor/base_processor.h"
 #include "processor/grabber.h"
 
 /** @brief Defines a generic window function.
  *
- *  This takes its input from the input module called "input".
+ *  This takes its input from the input port called "input", and makes the
+ *  windowed data available on the "output" port. If a size is set, only the
+ *  most recent samples of the input are used, with zeros in front of them if
+ *  the input is too short; otherwise the whole input is used.
  */
 class GenericWindow : public BaseProcessor {
  public:
-  typedef Grabber::Details Details;
-  typedef const std::vector<float>* Output;
+  /// Constructor.
+  GenericWindow() : size_(0), output_(this, windowed_) {
+    registerInput_("input", &input_);
+    registerOutput_("output", &output_);
+  }
+
+  /// Set the number of samples to use; zero to use the whole input.
+  void setSize(unsigned n) { size_ = n; }
+  /// Get the number of samples to use, or zero if the whole input is used.
+  unsigned getSize() const { return size_; }
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+  /// Get the window function for inputs of the given size, calculating it
+  /// if needed. The windows for each size are kept, so asking for several
+  /// sizes doesn't recalculate them, and doesn't touch the output.
+  const std::vector<float>& getWindow(unsigned size);
 
  protected:
   /// Calculate the windowed result.
   virtual int execute();
 
-  /// Get access to the windowed result.
-  boost::any getOutput_() const { return &windowed_; }
-
-  boost::any getDetails_() const {
-    Inputs::const_iterator i = inputs_.find("input");
-    return i -> second -> getDetails();
-  }
-
+  /// Calculate the window function for @a size samples into @a window.
   /// This should be implemented by descendants.
-  virtual void precalculateWindow() = 0;
-
-  // a precalculated window function
-  std::vector<float>      window_;
+  virtual void precalculateWindow(unsigned size, std::vector<float>& window)
+    const = 0;
 
-  size_t getSize() const { return windowed_.size(); }
+  /// Forget the windows calculated so far. Descendants should call this
+  /// when the shape of the window changes.
+  void clearWindows();
 
  private:
+  // number of samples to use
+  unsigned                            size_;
   // the windowed output
-  std::vector<float>      windowed_;
+  std::vector<float>                  windowed_;
+  // the precalculated window functions, by size
+  std::map<unsigned, std::vector<float> >  windows_;
+  boost::mutex                        windows_mutex_;
+
+  InputPort<std::vector<float> >      input_;
+  OutputPort<std::vector<float> >     output_;
 };
 
 class GaussianWindow : public GenericWindow {
@@ -52,10 +78,19 @@ class GaussianWindow : public GenericWindow {
   explicit GaussianWindow(float s = 0.5) : sigma_(s) {}
 
   /// Set the standard deviation for the gaussian.
-  void setStd(float s) { sigma_ = s; }
+  void setStd(float s) { sigma_ = s; clearWindows(); }
+  /// Get the standard deviation for the gaussian.
+  float getStd() const { return sigma_; }
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
 
  protected:
-  virtual void precalculateWindow();
+  virtual void precalculateWindow(unsigned size, std::vector<float>& window)
+    const;
 
  private:
   float         sigma_;
@@ -0,0 +1,300 @@
+#include "processor/zoom_fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/fft_plan_cache.h"
+#include "processor/filter_design.h"
+#include "processor/vector_ops.h"
+
+namespace {
+
+/// Smallest power of two that is at least @a x.
+unsigned nextPowerOfTwo(double x)
+{
+  unsigned n = 1;
+  while (n < x && n < (1u << 30))
+    n *= 2;
+  return n;
+}
+
+const double kPi = 3.14159265358979323846;
+
+} // anonymous namespace
+
+const float ZoomFft::kOversampling = 1.6;
+
+ZoomFft::ZoomFft() : low_(0), high_(0), resolution_(0), min_size_(256),
+    max_size_(8192), max_samples_(262144), reference_size_(0),
+    taps_per_phase_(16), sigma_(0.5), plan_cache_(new FftPlanCache),
+    complex_size_(0), complex_in_(0), complex_out_(0), complex_plan_(0),
+    filter_decimation_(0), scale_(1), decimation_(1), output_(),
+    output_port_(this, output_)
+{
+  real_fft_.setPlanCache(plan_cache_.get());
+
+  registerInput_("history", &history_);
+  registerInput_("details", &details_);
+  registerOutput_("output", &output_port_);
+}
+
+ZoomFft::~ZoomFft()
+{
+  // the plans belong to the cache, so the buffers can go first
+  freeComplex_();
+}
+
+void ZoomFft::setBand(float low, float high, float resolution)
+{
+  if (low == low_ && high == high_ && resolution == resolution_)
+    return;
+
+  low_ = low;
+  high_ = high;
+  resolution_ = resolution;
+  markStale();
+}
+
+void ZoomFft::setSizeRange(unsigned min_size, unsigned max_size)
+{
+  min_size_ = nextPowerOfTwo(std::max(min_size, 2u));
+  max_size_ = std::max(nextPowerOfTwo(max_size), min_size_);
+}
+
+void ZoomFft::setPlanCache(const FftPlanCachePtr& cache)
+{
+  freeComplex_();
+  plan_cache_ = cache?cache:FftPlanCachePtr(new FftPlanCache);
+  real_fft_.setPlanCache(plan_cache_.get());
+}
+
+int ZoomFft::init()
+{
+  if (properties_) {
+    setSizeRange(properties_ -> get("min_size", min_size_),
+      properties_ -> get("max_size", max_size_));
+    setMaxSamples(properties_ -> get("max_samples", max_samples_));
+    setReferenceSize(properties_ -> get("reference_size", reference_size_));
+    setTapsPerPhase(properties_ -> get("taps_per_phase", taps_per_phase_));
+    sigma_ = properties_ -> get("sigma", sigma_);
+  }
+
+  // the window and the filter depend on the settings
+  window_.clear();
+  filter_decimation_ = 0;
+  return 0;
+}
+
+void ZoomFft::updateProperties()
+{
+  if (properties_) {
+    properties_ -> put("min_size", min_size_);
+    properties_ -> put("max_size", max_size_);
+    properties_ -> put("max_samples", max_samples_);
+    properties_ -> put("reference_size", reference_size_);
+    properties_ -> put("taps_per_phase", taps_per_phase_);
+    properties_ -> put("sigma", sigma_);
+  }
+}
+
+int ZoomFft::execute()
+{
+  const SampleHistory& history = history_.get();
+  const Grabber::DetailsStruct& details = details_.get();
+  const float rate = details.samplingFrequency;
+
+  const unsigned long long end = history.getEnd();
+  const unsigned long long available = std::min<unsigned long long>(
+    end - history.getBegin(), max_samples_);
+  if (rate <= 0 || available == 0) {
+    output_.n_bins = 0;
+    markValid();
+    return 0;
+  }
+
+  // the band that is visible, defaulting to the whole spectrum
+  float low = std::max(low_, 0.0f);
+  float high = std::min(high_, rate/2);
+  if (high <= low) {
+    low = 0;
+    high = rate/2;
+  }
+  const float span = high - low;
+  const float resolution = (resolution_ > 0)?resolution_:(span/512);
+
+  // decimate only if the band is narrow enough for it to help, but no more
+  // than what leaves enough samples for the smallest FFT and its filter; for
+  // narrower bands, the resolution degrades instead
+  const double max_decimation = (double)available/
+    (min_size_ - 1 + taps_per_phase_);
+  const unsigned decimation = (unsigned)std::min<double>(
+    rate/(kOversampling*span), max_decimation);
+  if (decimation < 2) {
+    unsigned size = nextPowerOfTwo(rate/resolution);
+    size = std::max(std::min(size, max_size_), min_size_);
+    while (size > available && size > min_size_)
+      size /= 2;
+
+    runReal_(history, size, end);
+  } else {
+    unsigned size = nextPowerOfTwo(rate/decimation/resolution);
+    size = std::max(std::min(size, max_size_), min_size_);
+    // the filter needs some samples before the first output
+    const unsigned n_taps = taps_per_phase_*decimation;
+    while ((size - 1)*(unsigned long long)decimation + n_taps > available &&
+           size > min_size_)
+      size /= 2;
+
+    runZoom_(history, rate, (low + high)/2, size, decimation, end);
+  }
+
+  markValid();
+  return 0;
+}
+
+void ZoomFft::runReal_(const SampleHistory& history, unsigned size,
+  unsigned long long end)
+{
+  decimation_ = 1;
+  if (real_fft_.getSize() != size)
+    real_fft_.setSize(size);
+  if (!real_fft_.isInited())
+    real_fft_.init();
+  makeWindow_(size);
+
+  // use the newest samples, padding with zeros in front if there are too few
+  const size_t n = std::min<unsigned long long>(size,
+    end - history.getBegin());
+  float* buffer = real_fft_.getBuffer();
+  std::fill(buffer, buffer + size - n, 0);
+  history.copy(end - n, n, buffer + size - n);
+  for (unsigned i = size - n; i < size; ++i)
+    buffer[i] *= window_[i];
+
+  real_fft_.exec();
+
+  const unsigned n_bins = size/2 + 1;
+  const Complex* out = real_fft_.getOutput();
+  bins_.resize(n_bins);
+  for (unsigned i = 0; i < n_bins; ++i)
+    bins_[i] = out[i]*scale_;
+
+  output_.fft = &bins_[0];
+  output_.size = size;
+  output_.n_bins = n_bins;
+  output_.start = 0;
+  output_.step = 1.0/size;
+}
+
+void ZoomFft::runZoom_(const SampleHistory& history, float rate, float center,
+  unsigned size, unsigned decimation, unsigned long long end)
+{
+  decimation_ = decimation;
+  if (filter_decimation_ != decimation)
+    designFilter_(decimation);
+  if (complex_size_ != size)
+    allocComplex_(size);
+  makeWindow_(size);
+
+  const unsigned n_taps = filter_.size();
+  const size_t n_needed = (size - 1)*(size_t)decimation + n_taps;
+  const size_t n = std::min<unsigned long long>(n_needed,
+    end - history.getBegin());
+  const unsigned long long start = (end > n_needed)?(end - n_needed):0;
+
+  samples_.resize(n_needed);
+  std::fill(samples_.begin(), samples_.begin() + n_needed - n, 0);
+  history.copy(end - n, n, &samples_[n_needed - n]);
+
+  // mix the center of the band down to zero frequency; the phase is tied to
+  // the absolute sample index, so that it doesn't jump between cycles
+  mixed_re_.resize(n_needed);
+  mixed_im_.resize(n_needed);
+  const double omega = 2*kPi*center/rate;
+  const double phase0 = std::fmod(omega*(double)start, 2*kPi);
+  const Complex step(std::cos(omega), -std::sin(omega));
+  Complex rotator(std::cos(phase0), -std::sin(phase0));
+  for (size_t i = 0; i < n_needed; ++i) {
+    mixed_re_[i] = samples_[i]*rotator.real();
+    mixed_im_[i] = samples_[i]*rotator.imag();
+    rotator *= step;
+    // keep the rounding errors from changing the amplitude
+    if ((i & 255) == 255)
+      rotator /= std::abs(rotator);
+  }
+
+  // low-pass filter and decimate in one go: only the outputs that are kept
+  // are calculated, which is what the polyphase form of the filter does
+  const float* h = &filter_[0];
+  for (unsigned m = 0; m < size; ++m) {
+    const float* re = &mixed_re_[m*(size_t)decimation];
+    const float* im = &mixed_im_[m*(size_t)decimation];
+    complex_in_[m] = Complex(vectorDot(h, re, n_taps)*window_[m],
+      vectorDot(h, im, n_taps)*window_[m]);
+  }
+
+  fftwf_execute_dft(complex_plan_, (fftwf_complex*)complex_in_,
+    (fftwf_complex*)complex_out_);
+
+  // put the negative frequencies first
+  bins_.resize(size);
+  const unsigned half = size/2;
+  for (unsigned i = 0; i < size; ++i)
+    bins_[i] = complex_out_[(i + half) % size]*scale_;
+
+  output_.fft = &bins_[0];
+  output_.size = size;
+  output_.n_bins = size;
+  output_.start = center/rate - 0.5/decimation;
+  output_.step = 1.0/((double)decimation*size);
+}
+
+void ZoomFft::designFilter_(unsigned decimation)
+{
+  // the cutoff is at the new Nyquist frequency; the band takes up at most
+  // 1/kOversampling of the new sampling rate, so what aliases in from the
+  // transition band lands outside it
+  filter_ = designLowPass(taps_per_phase_*decimation, 0.5/decimation);
+  filter_decimation_ = decimation;
+}
+
+void ZoomFft::makeWindow_(unsigned size)
+{
+  if (window_.size() == size)
+    return;
+
+  // the same gaussian as GaussianWindow
+  window_.resize(size);
+  const float size2 = size/2.0;
+  for (unsigned i = 0; i < size; ++i) {
+    const float x = ((float)i - size2)/size2/sigma_;
+    window_[i] = std::exp(-0.5*x*x);
+  }
+
+  // the window sums up to roughly a fixed fraction of the size
+  scale_ = (reference_size_ > 0)?((float)reference_size_/size):1;
+}
+
+void ZoomFft::allocComplex_(unsigned size)
+{
+  freeComplex_();
+
+  // the plans from the cache need the alignment given by fftwf_malloc
+  complex_in_ = (Complex*)fftwf_malloc(sizeof(Complex)*size);
+  complex_out_ = (Complex*)fftwf_malloc(sizeof(Complex)*size);
+  complex_plan_ = plan_cache_ -> getComplex(size);
+  complex_size_ = size;
+}
+
+void ZoomFft::freeComplex_()
+{
+  if (complex_in_)
+    fftwf_free(complex_in_);
+  if (complex_out_)
+    fftwf_free(complex_out_);
+
+  complex_in_ = 0;
+  complex_out_ = 0;
+  complex_plan_ = 0;
+  complex_size_ = 0;
+}
@@ -0,0 +1,141 @@
+/** @file zoom_fft.h
+ *  @brief Defines a processor calculating the spectrum over a band of
+ *  frequencies, with a resolution that follows the band.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef ZOOM_FFT_H_
+#define ZOOM_FFT_H_
+
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/fft.h"
+#include "processor/fftwrapper.h"
+#include "processor/grabber.h"
+#include "processor/sample_history.h"
+#include "utils/forward_defs.h"
+
+/** @brief Calculate the spectrum over a band, at a given resolution.
+ *
+ *  The samples are read from the "history" port, usually connected to a
+ *  @a SampleRing, and their details from the "details" port. The spectrum is
+ *  available on the "output" port.
+ *
+ *  For wide bands, this runs a real FFT whose size is the smallest power of
+ *  two giving the requested resolution, so no time is spent on bins that are
+ *  too fine to be seen. For narrow bands, it uses a zoom FFT: the samples
+ *  are mixed down so that the center of the band is at zero frequency,
+ *  low-pass filtered and decimated in one polyphase step, and passed through
+ *  a complex FFT. This gives fine resolution around any frequency for a
+ *  fraction of the cost of a long FFT over the whole spectrum.
+ *
+ *  The magnitudes are scaled to match those of an FFT of
+ *  @a reference_size samples, so they don't change when the size of the FFT
+ *  does. The FFT size is limited by @a max_size, and the span of samples
+ *  used is limited by @a max_samples and by the length of the history. The
+ *  decimation is limited so that this span is enough for an FFT of
+ *  @a min_size, so for very narrow bands the resolution is coarser than
+ *  asked for.
+ */
+class ZoomFft : public BaseProcessor {
+ public:
+  /// Constructor.
+  ZoomFft();
+  /// Destructor.
+  ~ZoomFft();
+
+  /** @brief Set the band of frequencies, and the resolution, in Hz.
+   *
+   *  A resolution of zero means that 512 bins are used for the band. The
+   *  new band is used starting with the next cycle.
+   */
+  void setBand(float low, float high, float resolution);
+
+  /// Set the range of FFT sizes that can be used.
+  void setSizeRange(unsigned min_size, unsigned max_size);
+  /// Set the maximum number of samples that can be used for one spectrum.
+  void setMaxSamples(unsigned n) { max_samples_ = n; }
+  /// Set the number of samples with which the magnitudes are consistent.
+  void setReferenceSize(unsigned n) {
+    reference_size_ = n;
+    // the scaling is calculated together with the window
+    window_.clear();
+  }
+  /// Set the number of filter coefficients per polyphase branch.
+  void setTapsPerPhase(unsigned n) { taps_per_phase_ = (n > 0)?n:1; }
+
+  /// Take the FFT plans from a shared cache.
+  void setPlanCache(const FftPlanCachePtr& cache);
+
+  /// Get the size of the last FFT.
+  unsigned getSize() const { return output_.size; }
+  /// Get the decimation used for the last spectrum; 1 for a real FFT.
+  unsigned getDecimation() const { return decimation_; }
+
+  /// Read the settings.
+  virtual int init();
+
+  /// Update the settings.
+  virtual void updateProperties();
+
+ protected:
+  /// Calculate the spectrum.
+  virtual int execute();
+
+ private:
+  /// Ratio between the decimated sampling rate and the band's width.
+  static const float kOversampling;
+
+  /// Calculate a real FFT of @a size samples ending at @a end.
+  void runReal_(const SampleHistory& history, unsigned size,
+    unsigned long long end);
+  /// Calculate a zoom FFT centered at @a center, with the given size and
+  /// decimation.
+  void runZoom_(const SampleHistory& history, float rate, float center,
+    unsigned size, unsigned decimation, unsigned long long end);
+  /// Design the anti-aliasing filter for the given decimation.
+  void designFilter_(unsigned decimation);
+  /// Calculate the window, and the factor scaling the magnitudes.
+  void makeWindow_(unsigned size);
+  /// Allocate the buffers for a complex FFT of the given size.
+  void allocComplex_(unsigned size);
+  void freeComplex_();
+
+  float                               low_;
+  float                               high_;
+  float                               resolution_;
+  unsigned                            min_size_;
+  unsigned                            max_size_;
+  unsigned                            max_samples_;
+  unsigned                            reference_size_;
+  unsigned                            taps_per_phase_;
+  float                               sigma_;
+
+  FftPlanCachePtr                     plan_cache_;
+  RealFft                             real_fft_;
+  unsigned                            complex_size_;
+  Complex*                            complex_in_;
+  Complex*                            complex_out_;
+  fftwf_plan                          complex_plan_;
+
+  /// Coefficients of the anti-aliasing filter; these are symmetric.
+  std::vector<float>                  filter_;
+  unsigned                            filter_decimation_;
+  std::vector<float>                  window_;
+  float                               scale_;
+
+  std::vector<float>                  samples_;
+  std::vector<float>                  mixed_re_;
+  std::vector<float>                  mixed_im_;
+  std::vector<Complex>                bins_;
+  unsigned                            decimation_;
+
+  FftProcessor::OutputStruct          output_;
+
+  InputPort<SampleHistory>            history_;
+  InputPort<Grabber::DetailsStruct>   details_;
+  OutputPort<FftProcessor::OutputStruct>  output_port_;
+};
+
+#endif
@@ -18,6 +18,8 @@ int SdlGlApp::execute()
     while (SDL_PollEvent(&event)) {
       handleEvent(&event);
     }
+    if (resize_pending_ && !applyResize_())
+      running_ = false;
 
     // run the loop
     loop();
@@ -51,7 +53,8 @@ bool SdlGlApp::init()
 
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
-  display_ = SDL_SetVideoMode(scr_w_, scr_h_, 0, SDL_OPENGL);
+  display_ = SDL_SetVideoMode(scr_w_, scr_h_, 0,
+    SDL_OPENGL | (resizable_?SDL_RESIZABLE:0));
   if (!display_) {
     std::cerr << "Couldn't get screen. SDL error: " << SDL_GetError()
               << std::endl;
@@ -113,5 +116,33 @@ void SdlGlApp::handleEvent(SDL_Event* event)
 {
   if (event -> type == SDL_QUIT) {
     running_ = false;
+  } else if (event -> type == SDL_VIDEORESIZE) {
+    // the resize is done after all the pending events were handled
+    resize_pending_ = true;
+    new_w_ = event -> resize.w;
+    new_h_ = event -> resize.h;
   }
 }
+
+bool SdlGlApp::applyResize_()
+{
+  resize_pending_ = false;
+  if (new_w_ == scr_w_ && new_h_ == scr_h_)
+    return true;
+
+  // XXX with SDL 1.2 this keeps the OpenGL context on X11, but not on all
+  // platforms
+  display_ = SDL_SetVideoMode(new_w_, new_h_, 0,
+    SDL_OPENGL | (resizable_?SDL_RESIZABLE:0));
+  if (!display_) {
+    std::cerr << "Couldn't resize screen. SDL error: " << SDL_GetError()
+              << std::endl;
+    return false;
+  }
+
+  scr_w_ = new_w_;
+  scr_h_ = new_h_;
+  resizeGl();
+
+  return true;
+}
@@ -22,7 +22,8 @@
 class SdlGlApp {
  public:
   /// Construct.
-  SdlGlApp() : running_(false), display_(0), scr_w_(640), scr_h_(480) {}
+  SdlGlApp() : running_(false), display_(0), scr_w_(640), scr_h_(480),
+    resizable_(false), resize_pending_(false), new_w_(0), new_h_(0) {}
   /// Virtual destructor, needed for proper inheritance.
   virtual ~SdlGlApp() {}
 
@@ -36,6 +37,11 @@ class SdlGlApp {
    *  Should be called before @a init.
    */
   void            setHeight(int h) { scr_h_ = h; }
+  /** @brief Set whether the user can resize the application window.
+   *
+   *  Should be called before @a init.
+   */
+  void            setResizable(bool r) { resizable_ = r; }
 
   /** @brief Run the application.
    *
@@ -60,6 +66,14 @@ class SdlGlApp {
    *  Should return true upon success, false otherwise.
    */
   virtual bool    initGl() { return true; }
+  /** @brief React to a change in the size of the window.
+   *
+   *  This is called after the video mode was changed, with the new size
+   *  already stored in @a scr_w_ and @a scr_h_. Resize events that arrive
+   *  together are merged, so this is called at most once per cycle. By
+   *  default, this only updates the viewport.
+   */
+  virtual void    resizeGl() { glViewport(0, 0, scr_w_, scr_h_); }
   /** @brief Clean up.
    *
    *  Override this to perform additional cleanup.
@@ -69,8 +83,8 @@ class SdlGlApp {
   /** @brief Handle the event.
    *
    *  By default, this only handles the @a SDL_QUIT event which is generated
-   *  when you try to close the application. Override this method to handle more
-   *  events.
+   *  when you try to close the application, and the @a SDL_VIDEORESIZE event.
+   *  Override this method to handle more events.
    */
   virtual void    handleEvent(SDL_Event* event);
 
@@ -99,9 +113,15 @@ class SdlGlApp {
     boost::posix_time::microseconds(micro)); }
 
  protected:
+  /// Change the video mode to the size requested by the last resize event.
+  bool            applyResize_();
+
   bool            running_;
   SDL_Surface*    display_;
   int             scr_w_, scr_h_;
+  bool            resizable_;
+  bool            resize_pending_;
+  int             new_w_, new_h_;
 };
 
 #endif
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "processor/band_levels.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// bins 10 Hz apart
+const unsigned kSize = 4096;
+const float kRate = 40960;
+
+float toDb(float power_gain)
+{
+  return 10*std::log10(power_gain);
+}
+
+// sum the weighted power over all the bins, one band at a time
+std::vector<float> directLevels(const std::vector<Complex>& spectrum,
+  const std::vector<OctaveBand>& bands, BandLevels::Weighting weighting)
+{
+  const double width = kRate/kSize;
+  const double norm = 2.0/((double)kSize*kSize);
+  std::vector<float> levels(bands.size(), 0);
+  for (size_t i = 0; i < bands.size(); ++i) {
+    double sum = 0;
+    for (size_t k = 0; k < spectrum.size(); ++k) {
+      const double f = k*width;
+      const double overlap = std::min<double>(f + width/2, bands[i].high) -
+        std::max<double>(f - width/2, bands[i].low);
+      if (overlap > 0) {
+        sum += overlap/width*BandLevels::getWeightingGain(weighting, f)*
+          std::norm(spectrum[k])*norm;
+      }
+    }
+    levels[i] = sum;
+  }
+
+  return levels;
+}
+
+} // anonymous namespace
+
+int main()
+{
+  // the weightings are normalized at 1 kHz, and match the tables in
+  // IEC 61672 elsewhere
+  check(std::abs(toDb(BandLevels::getWeightingGain(BandLevels::A_WEIGHTING,
+    1000))) < 0.05, "A-weighting is 0 dB at 1 kHz");
+  check(std::abs(toDb(BandLevels::getWeightingGain(BandLevels::C_WEIGHTING,
+    1000))) < 0.05, "C-weighting is 0 dB at 1 kHz");
+  check(std::abs(toDb(BandLevels::getWeightingGain(BandLevels::A_WEIGHTING,
+    100)) + 19.1) < 0.1, "A-weighting is -19.1 dB at 100 Hz");
+  check(std::abs(toDb(BandLevels::getWeightingGain(BandLevels::A_WEIGHTING,
+    10000)) + 2.5) < 0.1, "A-weighting is -2.5 dB at 10 kHz");
+  check(std::abs(toDb(BandLevels::getWeightingGain(BandLevels::C_WEIGHTING,
+    31.5)) + 3.0) < 0.1, "C-weighting is -3.0 dB at 31.5 Hz");
+  check(BandLevels::getWeightingGain(BandLevels::Z_WEIGHTING, 20) == 1,
+    "Z-weighting is flat");
+
+  FakeFft fft(kSize, kRate);
+  BandLevels levels;
+  levels.connect("fft", fft, "output");
+  levels.connect("details", fft, "details");
+  FakeSink<std::vector<float> > sink("levels");
+  sink.connect("levels", levels, "levels");
+  levels.setBands(3, 25, 12500);
+  const std::vector<OctaveBand>& bands = levels.getBands();
+
+  // a unit sine at 1 kHz, right on a bin, has a mean square of one half,
+  // all of it in the band centered at 1 kHz
+  fft.spectrum[(size_t)(1000*kSize/kRate)] = Complex(0, -(float)kSize/2);
+  levels.setWeighting(BandLevels::A_WEIGHTING);
+  fft.invalidateCache();
+  levels.invalidateCache();
+  const std::vector<float>& sine = sink.input.get();
+  for (size_t i = 0; i < bands.size(); ++i) {
+    if (bands[i].low < 1000 && bands[i].high > 1000)
+      check(std::abs(sine[i] - 0.5) < 1e-4, "the 1 kHz band has the sine");
+    else
+      check(sine[i] == 0, "the other bands are empty");
+  }
+
+  // for any spectrum, the sparse sums match a sum over all the bins
+  for (size_t k = 0; k < fft.spectrum.size(); ++k) {
+    fft.spectrum[k] = Complex(std::rand() - RAND_MAX/2,
+      std::rand() - RAND_MAX/2)*(10.0f/RAND_MAX);
+  }
+  const BandLevels::Weighting weightings[] = { BandLevels::Z_WEIGHTING,
+    BandLevels::A_WEIGHTING, BandLevels::C_WEIGHTING };
+  for (size_t w = 0; w < 3; ++w) {
+    levels.setWeighting(weightings[w]);
+    fft.invalidateCache();
+    levels.invalidateCache();
+    const std::vector<float>& sparse = sink.input.get();
+    const std::vector<float> direct = directLevels(fft.spectrum, bands,
+      weightings[w]);
+
+    check(sparse.size() == bands.size(), "there is a level for every band");
+    float max_error = 0;
+    for (size_t i = 0; i < bands.size() && i < sparse.size(); ++i)
+      max_error = std::max(max_error, std::abs(sparse[i]/direct[i] - 1));
+    check(max_error < 1e-4, "the band levels match a direct sum, with " +
+      BandLevels::getWeightingName(weightings[w]) + "-weighting");
+  }
+
+  return reportChecks();
+}
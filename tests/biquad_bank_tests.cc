@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "processor/biquad_bank.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+const float kRate = 48000;
+
+// filter the input in blocks of random sizes up to max_block (or all at
+// once, if max_block is zero), keeping the outputs of the chosen band
+std::vector<float> filter(BiquadBank& bank, const std::vector<float>& x,
+  size_t max_block)
+{
+  bank.reset();
+  std::vector<float> y(x.size());
+  size_t done = 0;
+  while (done < x.size()) {
+    size_t n = x.size() - done;
+    if (max_block > 0)
+      n = std::min<size_t>(n, 1 + std::rand() % max_block);
+    bank.process(&x[done], n, &y[done]);
+    done += n;
+  }
+
+  return y;
+}
+
+std::vector<float> sine(float f, size_t n)
+{
+  std::vector<float> x(n);
+  for (size_t i = 0; i < n; ++i)
+    x[i] = std::sin(2*M_PI*f*i/kRate);
+  return x;
+}
+
+// the largest absolute value in the second half of a signal, once the
+// filters have settled
+float steadyPeak(const std::vector<float>& y)
+{
+  float peak = 0;
+  for (size_t i = y.size()/2; i < y.size(); ++i)
+    peak = std::max(peak, std::abs(y[i]));
+  return peak;
+}
+
+} // anonymous namespace
+
+int main()
+{
+  // five bands, so that the last group of four is padded, with different
+  // numbers of sections
+  BiquadBank bank;
+  bank.setSamplingFrequency(kRate);
+  bank.setTimeConstant(0.1);
+  const float centers[] = { 250, 500, 1000, 2000, 4000 };
+  for (unsigned i = 0; i < 5; ++i) {
+    BiquadCascade cascade(1 + i % 2,
+      BiquadSpec(BiquadSpec::BANDPASS, centers[i], 2));
+    bank.addBand(cascade);
+  }
+  check(bank.getBandCount() == 5, "all the bands were added");
+
+  const size_t n = 24000;
+  for (unsigned i = 0; i < 5; ++i) {
+    bank.setOutputBand(i);
+
+    // a band-pass lets its center frequency through unchanged
+    const std::vector<float> y = filter(bank, sine(centers[i], n), 0);
+    check(std::abs(steadyPeak(y) - 1) < 0.01,
+      "a band-pass has unit gain at its center");
+
+    // the mean square of a unit sine is one half
+    check(std::abs(bank.getLevels()[i] - 0.5) < 0.01,
+      "the level of a band is the mean square of its output");
+
+    // two octaves away, it doesn't
+    const float other = (i < 2)?(4*centers[i]):(centers[i]/4);
+    check(steadyPeak(filter(bank, sine(other, n), 0)) < 0.3,
+      "a band-pass attenuates frequencies away from its center");
+  }
+
+  // the state of the filters carries over between blocks, so the block
+  // sizes don't matter
+  std::vector<float> noise(n);
+  for (size_t i = 0; i < n; ++i)
+    noise[i] = 2.0f*std::rand()/RAND_MAX - 1;
+  for (unsigned i = 0; i < 5; ++i) {
+    bank.setOutputBand(i);
+    const std::vector<float> whole = filter(bank, noise, 0);
+    const std::vector<float> small = filter(bank, noise, 5);
+    const std::vector<float> large = filter(bank, noise, 2000);
+    check(small == whole && large == whole,
+      "the output doesn't depend on the block sizes");
+  }
+
+  return reportChecks();
+}
@@ -0,0 +1,81 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "processor/filter_bank.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+const float kRate = 48000;
+const unsigned kOctaves = 4;
+
+// feed a unit sine at frequency f through a filter bank, in blocks like
+// those coming from the input, and find the magnitudes at the end
+std::vector<float> analyze(FilterBank& bank, float f)
+{
+  const size_t block = 1024;
+  const size_t total = 48*block;
+  std::vector<float> x(total);
+  for (size_t i = 0; i < total; ++i)
+    x[i] = std::sin(2*M_PI*f*i/kRate);
+
+  for (size_t end = block; end <= total; end += block)
+    bank.append(&x[end - block], block, end, kRate);
+
+  std::vector<float> magnitudes;
+  check(bank.calculate(total, magnitudes), "all the windows are available");
+  return magnitudes;
+}
+
+} // anonymous namespace
+
+// sweep a sine over the bands on both sides of the boundary between the
+// undecimated stage and the first decimated one; a band should see the same
+// magnitude whichever stage it comes from, and tones that the decimators
+// should remove must not alias into the lower bands
+int main()
+{
+  FilterBank bank;
+  bank.setBands(FilterBank::CONSTANT_Q, 109, 27.5, 14080);
+  bank.setFftSize(1024);
+  bank.setOctaves(kOctaves);
+
+  // a tone at the center of a band gives the reference magnitude
+  analyze(bank, 1000);
+  const std::vector<float> centers = *bank.getFrequencies();
+  size_t ref_band = 0;
+  for (size_t i = 1; i < centers.size(); ++i) {
+    if (std::abs(centers[i] - 1000) < std::abs(centers[ref_band] - 1000))
+      ref_band = i;
+  }
+  const std::vector<float> at_center = analyze(bank, centers[ref_band]);
+  const float expected = at_center[ref_band];
+  check(expected > 0, "the reference band sees the tone");
+
+  for (size_t i = 0; i < centers.size(); ++i) {
+    const float f = centers[i];
+    if (f < 2000 || f > 8000)
+      continue;
+
+    const std::vector<float> magnitudes = analyze(bank, f);
+    const float ratio_db = 20*std::log10(magnitudes[i]/expected);
+    if (std::abs(ratio_db) > 0.5) {
+      std::cout << f << " Hz: " << ratio_db << " dB" << std::endl;
+      check(false, "the band gain is the same on both sides of the boundary");
+    }
+  }
+
+  // above three quarters of the input rate, a tone folds below the top of
+  // the first decimated stage
+  const std::vector<float> aliased = analyze(bank, 0.45*kRate);
+  for (size_t i = 0; i < centers.size(); ++i) {
+    if (centers[i] < 4000 && aliased[i] > 1e-3*expected) {
+      std::cout << centers[i] << " Hz: "
+                << 20*std::log10(aliased[i]/expected) << " dB" << std::endl;
+      check(false, "the decimators remove what would alias");
+    }
+  }
+
+  return reportChecks();
+}
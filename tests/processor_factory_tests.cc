@@ -0,0 +1,139 @@
+#include <sstream>
+#include <string>
+
+#include "processor/processor_factory.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// a processor that passes its input through, scaled by a setting
+class ScaleNode : public BaseProcessor {
+ public:
+  ScaleNode() : factor_(1), value_(0), output_(this, value_) {
+    registerInput_("input", &input_);
+    registerOutput_("output", &output_);
+  }
+
+  virtual int init() {
+    if (properties_)
+      factor_ = properties_ -> get("factor", factor_);
+    return 0;
+  }
+
+ protected:
+  virtual int execute() {
+    value_ = factor_*input_.get();
+    markValid();
+    return 0;
+  }
+
+ private:
+  float                   factor_;
+  float                   value_;
+  InputPort<float>        input_;
+  OutputPort<float>       output_;
+};
+
+// a processor standing in for the grabber
+class SourceNode : public BaseProcessor {
+ public:
+  SourceNode() : value_(1), output_(this, value_)
+    { registerOutput_("output", &output_); }
+
+ protected:
+  virtual int execute() { markValid(); return 0; }
+
+ private:
+  float                   value_;
+  OutputPort<float>       output_;
+};
+
+BaseProcessor* createScale() { return new ScaleNode; }
+
+// build the graph described by the given XML, on top of a source called
+// "grabber"; returns the error message, if any
+std::string build(const std::string& xml, Processors& processors)
+{
+  ProcessorFactory factory;
+  factory.add("scale", createScale);
+
+  processors.clear();
+  processors["grabber"] = BaseProcessorPtr(new SourceNode);
+
+  std::istringstream in("<graph>" + xml + "</graph>");
+  Properties desc;
+  read_xml(in, desc);
+  try {
+    factory.build(desc.get_child("graph"), processors);
+  }
+  catch (const Exception& e) {
+    return e.what();
+  }
+
+  return std::string();
+}
+
+} // anonymous namespace
+
+int main()
+{
+  Processors processors;
+
+  // the same type, the same settings, and the same inputs give the same
+  // processor, and so do the nodes using them in the same way; comments and
+  // the order of the nodes don't matter
+  std::string error = build(
+    "<node><name>d</name><type>scale</type><input>b</input>"
+    "  <settings><factor>3</factor></settings></node>"
+    "<node><name>a</name><type>scale</type><input>grabber</input>"
+    "  <settings><factor>2</factor></settings></node>"
+    "<node><name>b</name><type>scale</type><input>grabber</input>"
+    "  <settings><!-- double --><factor>2</factor></settings></node>"
+    "<node><name>c</name><type>scale</type><input>a.output</input>"
+    "  <settings><factor>3</factor></settings></node>"
+    "<node><name>e</name><type>scale</type><input>grabber</input>"
+    "  <settings><factor>5</factor></settings></node>"
+    "<node><name>f</name><type>scale</type><input>a</input>"
+    "  <settings><factor>5</factor></settings></node>",
+    processors);
+  check(error.empty(), "a valid description builds: " + error);
+  if (error.empty()) {
+    check(processors.size() == 7, "there is an entry for every node");
+    check(processors["a"] == processors["b"], "identical nodes are merged");
+    check(processors["c"] == processors["d"],
+      "nodes using merged nodes in the same way are merged");
+    check(processors["a"] != processors["e"],
+      "nodes with different settings are distinct");
+    check(processors["e"] != processors["f"],
+      "nodes with different inputs are distinct");
+    check(processors["c"] -> getSources().front() == processors["a"].get(),
+      "merged nodes are connected to the shared processor");
+  }
+
+  // connections that go around in a circle are rejected
+  error = build(
+    "<node><name>a</name><type>scale</type><input>c</input></node>"
+    "<node><name>b</name><type>scale</type><input>a</input></node>"
+    "<node><name>c</name><type>scale</type><input>b</input></node>",
+    processors);
+  check(error.find("cycle") != std::string::npos,
+    "a cycle is reported: " + error);
+
+  error = build(
+    "<node><name>a</name><type>scale</type><input>a</input></node>",
+    processors);
+  check(error.find("cycle") != std::string::npos,
+    "a node using itself is reported: " + error);
+
+  // and so are unknown nodes and types
+  error = build(
+    "<node><name>a</name><type>scale</type><input>nowhere</input></node>",
+    processors);
+  check(!error.empty(), "an unknown source is reported");
+
+  error = build("<node><name>a</name><type>nothing</type></node>",
+    processors);
+  check(!error.empty(), "an unknown type is reported");
+
+  return reportChecks();
+}
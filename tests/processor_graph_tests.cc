@@ -0,0 +1,165 @@
+#include <string>
+#include <vector>
+
+#include "processor/processor_graph.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// a processor adding up its inputs, which counts how many times it ran; a
+// processor without inputs counts the cycles in which it was told to change,
+// and any processor can be told to fail
+class CountingNode : public BaseProcessor {
+ public:
+  explicit CountingNode(unsigned n_inputs = 0) : changing(true),
+    failing(false), runs(0), value(0), inputs_(n_inputs),
+    output_(this, value)
+  {
+    for (unsigned i = 0; i < n_inputs; ++i)
+      registerInput_(std::string(1, 'a' + i), &inputs_[i]);
+    registerOutput_("output", &output_);
+  }
+
+  bool                            changing;
+  bool                            failing;
+  unsigned long                   runs;
+  unsigned long                   value;
+
+ protected:
+  virtual int execute() {
+    ++runs;
+    if (failing)
+      return 1;
+    if (inputs_.empty()) {
+      if (changing)
+        ++value;
+      else
+        markUnchanged();
+    } else {
+      value = 0;
+      for (size_t i = 0; i < inputs_.size(); ++i)
+        value += inputs_[i].get();
+    }
+    markValid();
+    return 0;
+  }
+
+ private:
+  std::vector<InputPort<unsigned long> >  inputs_;
+  OutputPort<unsigned long>               output_;
+};
+
+} // anonymous namespace
+
+int main()
+{
+  // a diamond: the source feeds two processors, which both feed the sink
+  CountingNode source;
+  CountingNode left(1);
+  CountingNode right(1);
+  CountingNode sink(2);
+  left.connect("a", source, "output");
+  right.connect("a", source, "output");
+  sink.connect("a", left, "output");
+  sink.connect("b", right, "output");
+
+  ProcessorGraph graph;
+  graph.add("sink", &sink);
+  graph.add("right", &right);
+  graph.add("left", &left);
+  graph.add("source", &source);
+  graph.setThreads(3);
+  graph.build();
+
+  check(graph.getStageCount() == 3, "the diamond has three stages");
+  const std::vector<std::string> order = graph.getOrder();
+  check(order.size() == 4 && order.front() == "source" &&
+    order.back() == "sink", "the source runs first and the sink last");
+
+  // every processor runs exactly once per cycle, even though the two in the
+  // middle run on different threads and both pull from the source
+  const unsigned n_cycles = 50;
+  for (unsigned i = 0; i < n_cycles; ++i) {
+    graph.run();
+    if (sink.value != 2*source.value) {
+      check(false, "the sink sees the outputs of the current cycle");
+      break;
+    }
+  }
+
+  const char* names[] = { "source", "left", "right", "sink" };
+  const CountingNode* nodes[] = { &source, &left, &right, &sink };
+  for (size_t i = 0; i < 4; ++i) {
+    check(graph.getExecutionCount(names[i]) == n_cycles &&
+      nodes[i] -> runs == n_cycles,
+      std::string(names[i]) + " ran once per cycle");
+    check(graph.getSkipCount(names[i]) == 0,
+      std::string(names[i]) + " wasn't skipped while the source changed");
+  }
+
+  // when the source stops changing, everything after it is skipped
+  source.changing = false;
+  const unsigned n_quiet = 10;
+  for (unsigned i = 0; i < n_quiet; ++i)
+    graph.run();
+
+  check(source.runs == n_cycles + n_quiet,
+    "processors without inputs always run");
+  for (size_t i = 1; i < 4; ++i) {
+    check(nodes[i] -> runs == n_cycles &&
+      graph.getSkipCount(names[i]) == n_quiet,
+      std::string(names[i]) + " was skipped when its inputs didn't change");
+  }
+  check(sink.value == 2*source.value, "skipped processors keep their output");
+
+  // a processor that fails holds back the processors using it, and is run
+  // again in the next cycle even though its inputs didn't change
+  source.changing = true;
+  left.failing = true;
+  graph.run();
+  check(left.runs == n_cycles + 1 && right.runs == n_cycles + 1,
+    "a change in the source runs the processors using it");
+  check(sink.runs == n_cycles, "processors using a failed one don't run");
+  source.changing = false;
+  left.failing = false;
+  graph.run();
+  check(left.runs == n_cycles + 2 && sink.runs == n_cycles + 1,
+    "a failed processor and its users run again in the next cycle");
+  check(right.runs == n_cycles + 1, "the other processors are skipped");
+  check(sink.value == 2*source.value, "the sink recovers after a failure");
+  graph.run();
+  check(left.runs == n_cycles + 2 && sink.runs == n_cycles + 1,
+    "once it succeeded, the processor is skipped again");
+
+  // a cycle can't be scheduled
+  CountingNode first(1);
+  CountingNode second(1);
+  first.connect("a", second, "output");
+  second.connect("a", first, "output");
+
+  ProcessorGraph cyclic;
+  cyclic.add("first", &first);
+  cyclic.add("second", &second);
+  bool threw = false;
+  try {
+    cyclic.build();
+  }
+  catch (const PortError&) {
+    threw = true;
+  }
+  check(threw, "a cycle throws PortError");
+
+  // neither can a processor whose source is not in the graph
+  ProcessorGraph partial;
+  partial.add("left", &left);
+  threw = false;
+  try {
+    partial.build();
+  }
+  catch (const PortError&) {
+    threw = true;
+  }
+  check(threw, "a missing source throws PortError");
+
+  return reportChecks();
+}
@@ -0,0 +1,39 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "processor/resampler.h"
+#include "utils/misc.h"
+
+// measure how many input samples per second the resampler gets through, for
+// some typical ratios, working on blocks like those coming from the input
+int main()
+{
+  const unsigned ratios[][2] = { {1, 2}, {1, 4}, {1, 12}, {2, 3},
+                                 {147, 160}, {160, 147}, {3, 1} };
+  const size_t n_ratios = sizeof(ratios)/sizeof(ratios[0]);
+  const size_t block = 1024;
+  const size_t n_blocks = 2000;
+
+  std::vector<float> input(block);
+  for (size_t i = 0; i < block; ++i)
+    input[i] = std::sin(0.01*i) + 0.5*std::sin(0.3*i);
+
+  for (size_t i = 0; i < n_ratios; ++i) {
+    Resampler resampler;
+    resampler.setRatio(ratios[i][0], ratios[i][1]);
+    std::vector<float> output(resampler.getMaxOutputs(block));
+
+    Timer timer;
+    size_t n_out = 0;
+    for (size_t j = 0; j < n_blocks; ++j)
+      n_out += resampler.process(&input[0], block, &output[0]);
+    const double elapsed = timer.getElapsed();
+
+    std::cout << ratios[i][0] << "/" << ratios[i][1] << ": "
+              << block*n_blocks/elapsed/1e6 << " Msamples/s in, "
+              << n_out/elapsed/1e6 << " Msamples/s out" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "processor/resampler.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// run the resampler over the whole signal, in blocks of random sizes up to
+// max_block (or all at once, if max_block is zero)
+std::vector<float> resample(Resampler& resampler, const std::vector<float>& x,
+  size_t max_block)
+{
+  resampler.reset();
+  std::vector<float> y;
+  std::vector<float> out;
+  size_t done = 0;
+  while (done < x.size()) {
+    size_t n = x.size() - done;
+    if (max_block > 0)
+      n = std::min<size_t>(n, 1 + std::rand() % max_block);
+    out.resize(resampler.getMaxOutputs(n));
+    const size_t n_out = resampler.process(&x[done], n, &out[0]);
+    y.insert(y.end(), out.begin(), out.begin() + n_out);
+    done += n;
+  }
+
+  return y;
+}
+
+} // anonymous namespace
+
+int main()
+{
+  const unsigned ratios[][2] = { {1, 2}, {1, 4}, {2, 3}, {147, 160},
+                                 {160, 147}, {3, 1} };
+  const size_t n_ratios = sizeof(ratios)/sizeof(ratios[0]);
+  const size_t n = 10000;
+
+  std::vector<float> x(n);
+  for (size_t i = 0; i < n; ++i)
+    x[i] = std::sin(0.01*i) + 0.5*std::sin(0.3*i);
+  const std::vector<float> dc(n, 1);
+
+  for (size_t i = 0; i < n_ratios; ++i) {
+    const unsigned up = ratios[i][0];
+    const unsigned down = ratios[i][1];
+    std::ostringstream name;
+    name << up << "/" << down << ": ";
+
+    Resampler resampler;
+    resampler.setRatio(up, down);
+
+    // the state carried between blocks makes the splits invisible
+    const std::vector<float> whole = resample(resampler, x, 0);
+    const std::vector<float> small = resample(resampler, x, 7);
+    const std::vector<float> large = resample(resampler, x, 1500);
+    check(small == whole && large == whole,
+      name.str() + "the output doesn't depend on the block sizes");
+
+    // n inputs give n*up/down outputs, give or take one
+    const double expected = (double)n*up/down;
+    check(std::abs(whole.size() - expected) <= 1,
+      name.str() + "the number of outputs follows the ratio");
+
+    // once the filter is full, a constant goes through unchanged
+    const std::vector<float> dc_out = resample(resampler, dc, 100);
+    const size_t settled = dc_out.size()/2;
+    float max_error = 0;
+    for (size_t j = settled; j < dc_out.size(); ++j)
+      max_error = std::max(max_error, std::abs(dc_out[j] - 1));
+    check(max_error < 1e-3, name.str() + "the gain at DC is one");
+  }
+
+  // as a processor, the end of the output window counts the outputs, and
+  // starts again when the input restarts
+  FakeSource<std::vector<float> > source;
+  Resampler resampler;
+  resampler.setRatio(1, 2);
+  resampler.connect("input", source, "output");
+  resampler.connect("details", source, "details");
+  FakeSink<Grabber::DetailsStruct> sink("details");
+  sink.connect("details", resampler, "details");
+
+  source.data.assign(1024, 0);
+  source.details.samplingFrequency = 48000;
+  source.details.size = 1024;
+  unsigned long long expected_end = 0;
+  for (unsigned k = 0; k < 10; ++k) {
+    // the first window is new, then a quarter of it is new at each cycle
+    source.details.end = 1024 + 256*k;
+    expected_end += (k == 0)?512:128;
+    source.invalidateCache();
+    resampler.invalidateCache();
+    check(sink.input.get().end == expected_end,
+      "the end of the output counts the outputs");
+  }
+
+  source.details.end += 4096;
+  source.invalidateCache();
+  resampler.invalidateCache();
+  check(sink.input.get().end == 512,
+    "the output count restarts with the filter");
+
+  return reportChecks();
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "processor/sample_history.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// the extrema of all[a, b), clipped to the last samples still in the history
+bool scanMinMax(const std::vector<float>& all, const SampleHistory& history,
+  unsigned long long a, unsigned long long b, float& mn, float& mx)
+{
+  a = std::max(a, history.getBegin());
+  b = std::min(b, history.getEnd());
+  if (a >= b)
+    return false;
+
+  mn = *std::min_element(all.begin() + a, all.begin() + b);
+  mx = *std::max_element(all.begin() + a, all.begin() + b);
+  return true;
+}
+
+float uniform(float lo, float hi)
+{
+  return lo + (hi - lo)*std::rand()/RAND_MAX;
+}
+
+} // anonymous namespace
+
+// feed random samples in blocks of random sizes, so that the ring wraps
+// around many times, and compare the queries with a direct scan over
+// everything that was appended
+int main()
+{
+  SampleHistory history(1000);
+  check(history.getCapacity() >= 1000, "the capacity is at least as asked");
+  check(history.getCapacity() % (SampleHistory::kFanout*
+    SampleHistory::kFanout) == 0, "the capacity is a multiple of the blocks");
+  check(history.getBegin() == 0 && history.getEnd() == 0,
+    "the history starts empty");
+
+  std::vector<float> all;
+  std::vector<float> block;
+  unsigned n_minmax_errors = 0;
+  unsigned n_envelope_errors = 0;
+  for (unsigned k = 0; k < 200; ++k) {
+    // every now and then, a block longer than the whole history
+    const size_t n = (k % 50 == 49)?(history.getCapacity() + 123):
+      (1 + std::rand() % 300);
+    block.resize(n);
+    for (size_t i = 0; i < n; ++i)
+      block[i] = uniform(-1, 1);
+    history.append(&block[0], n);
+    all.insert(all.end(), block.begin(), block.end());
+
+    const unsigned long long end = history.getEnd();
+    const unsigned long long begin = history.getBegin();
+    if (end != all.size() || end - begin != std::min<unsigned long long>(
+      all.size(), history.getCapacity()))
+    {
+      check(false, "the history keeps the last samples");
+      break;
+    }
+
+    // ranges of random lengths, some of them hanging off the ends
+    for (unsigned j = 0; j < 20; ++j) {
+      const unsigned long long a = (begin > 50)?(begin - 50 +
+        std::rand() % (end - begin + 100)):(std::rand() % (end + 50));
+      const unsigned long long b = a + std::rand() %
+        ((j % 2 == 0)?10:history.getCapacity());
+      float mn, mx;
+      float scan_mn, scan_mx;
+      const bool found = history.getMinMax(a, b, mn, mx);
+      const bool scan_found = scanMinMax(all, history, a, b, scan_mn,
+        scan_mx);
+      if (found != scan_found || (found && (mn != scan_mn || mx != scan_mx)))
+        ++n_minmax_errors;
+    }
+
+    // an envelope over fractional positions, covering more or less than
+    // one sample per bin
+    const unsigned n_bins = 1 + std::rand() % 200;
+    const double start = begin + uniform(-100, history.getCapacity());
+    const double stop = start + uniform(1, 2*history.getCapacity());
+    std::vector<float> mins(n_bins);
+    std::vector<float> maxs(n_bins);
+    history.getEnvelope(start, stop, n_bins, &mins[0], &maxs[0]);
+    const double w = (stop - start)/n_bins;
+    for (unsigned i = 0; i < n_bins; ++i) {
+      const double a = start + i*w;
+      const unsigned long long ia = (a > 0)?std::floor(a):0;
+      const unsigned long long ib = std::max<unsigned long long>(
+        std::floor(a + w), ia + 1);
+      float mn, mx;
+      if (a + w <= 0 || !scanMinMax(all, history, ia, ib, mn, mx)) {
+        if (mins[i] <= maxs[i])
+          ++n_envelope_errors;
+      } else if (mins[i] != mn || maxs[i] != mx) {
+        ++n_envelope_errors;
+      }
+    }
+  }
+  check(n_minmax_errors == 0, "the extrema match a direct scan");
+  check(n_envelope_errors == 0, "the envelope matches a direct scan");
+
+  // a single sample, and nothing at all
+  float mn, mx;
+  const unsigned long long last = history.getEnd() - 1;
+  check(history.getMinMax(last, last + 1, mn, mx) && mn == all[last] &&
+    mx == all[last], "the extrema of one sample are the sample");
+  check(!history.getMinMax(last, last, mn, mx),
+    "an empty range has no extrema");
+  check(!history.getMinMax(0, history.getBegin(), mn, mx),
+    "samples that fell out of the history have no extrema");
+
+  return reportChecks();
+}
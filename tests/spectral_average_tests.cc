@@ -0,0 +1,99 @@
+#include <cmath>
+#include <vector>
+
+#include "processor/spectral_average.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+const unsigned kBins = 37;
+const float kRate = 48000;
+// samples between frames, a tenth of a second
+const unsigned kHop = 4800;
+
+// start a new frame with the given power in all the bins, and new samples
+// unless repeat is true
+void setFrame(FakeFft& fft, float power, bool repeat = false)
+{
+  for (unsigned i = 0; i < kBins; ++i)
+    fft.spectrum[i] = Complex(0, std::sqrt(power));
+  if (!repeat)
+    fft.details.end += kHop;
+  fft.invalidateCache();
+}
+
+// the averaged power, which should be the same in all the bins
+float getPower(SpectralAverage& average,
+  const FakeSink<FftProcessor::OutputStruct>& sink)
+{
+  average.invalidateCache();
+  const FftProcessor::OutputStruct& output = sink.input.get();
+  const float power = std::norm(output.fft[0]);
+  for (unsigned i = 1; i < output.n_bins; ++i) {
+    if (std::norm(output.fft[i]) != power)
+      return -1;
+  }
+  return power;
+}
+
+bool near(float x, float y)
+{
+  return std::abs(x - y) <= 1e-4*std::abs(y);
+}
+
+} // anonymous namespace
+
+int main()
+{
+  FakeFft fft(2*(kBins - 1), kRate);
+  SpectralAverage average;
+  average.connect("fft", fft, "output");
+  average.connect("details", fft, "details");
+  FakeSink<FftProcessor::OutputStruct> sink;
+  sink.connect("input", average, "output");
+
+  // the linear mean is over the last few frames, also after the ring wraps
+  // around, several times
+  const unsigned n_frames = 4;
+  average.setMode(SpectralAverage::LINEAR);
+  average.setFrames(n_frames);
+  for (unsigned k = 1; k <= 11; ++k) {
+    setFrame(fft, k);
+    const unsigned first = (k > n_frames)?(k - n_frames + 1):1;
+    const float expected = (first + k)/2.0f;
+    if (!near(getPower(average, sink), expected)) {
+      check(false, "the linear average is the mean of the last frames");
+      break;
+    }
+  }
+
+  // frames without new samples don't count
+  setFrame(fft, 100, true);
+  check(near(getPower(average, sink), 9.5), "repeated frames are ignored");
+
+  // a held peak falls by the decay rate, and is replaced by higher peaks
+  average.setMode(SpectralAverage::PEAK_MAX);
+  average.setDecay(10);
+  setFrame(fft, 1);
+  check(near(getPower(average, sink), 1), "the first frame is held");
+  for (unsigned k = 0; k < 10; ++k) {
+    setFrame(fft, 1e-6);
+    getPower(average, sink);
+  }
+  check(near(getPower(average, sink), 0.1),
+    "the peak falls by 10 dB in a second");
+  setFrame(fft, 0.5);
+  check(near(getPower(average, sink), 0.5), "a higher peak replaces it");
+
+  // the exponential average moves towards each frame according to the time
+  // constant
+  average.setMode(SpectralAverage::EXPONENTIAL);
+  average.setTimeConstant(0.1);
+  setFrame(fft, 1);
+  getPower(average, sink);
+  setFrame(fft, 2);
+  check(near(getPower(average, sink), 2 - std::exp(-1.0f)),
+    "the exponential average follows its time constant");
+
+  return reportChecks();
+}
@@ -0,0 +1,112 @@
+/** @file test_utils.h
+ *  @brief Defines helpers shared by the tests.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef TEST_UTILS_H_
+#define TEST_UTILS_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "processor/base_processor.h"
+#include "processor/fft.h"
+#include "processor/grabber.h"
+
+/// Get the number of checks that failed so far.
+inline int& getFailureCount()
+{
+  static int n_failures = 0;
+  return n_failures;
+}
+
+/// Report a failure if the condition doesn't hold.
+inline void check(bool condition, const std::string& what)
+{
+  if (!condition) {
+    std::cout << "FAILED: " << what << std::endl;
+    ++getFailureCount();
+  }
+}
+
+/// Print a summary of the checks, and return the exit code for @a main.
+inline int reportChecks()
+{
+  if (getFailureCount() > 0) {
+    std::cout << getFailureCount() << " check(s) failed." << std::endl;
+    return 1;
+  }
+
+  std::cout << "All checks passed." << std::endl;
+  return 0;
+}
+
+/** @brief A processor standing in for the grabber.
+ *
+ *  The test sets @a data and @a details directly, and then invalidates the
+ *  cache of the processor.
+ */
+template <class T>
+class FakeSource : public BaseProcessor {
+ public:
+  /// Constructor.
+  FakeSource() : data(), details(), output_(this, data),
+    details_output_(this, details)
+  {
+    registerOutput_("output", &output_);
+    registerOutput_("details", &details_output_);
+  }
+
+  /// The data on the "output" port.
+  T                                   data;
+  /// The data on the "details" port.
+  Grabber::DetailsStruct              details;
+
+ protected:
+  virtual int execute() { markValid(); return 0; }
+
+ private:
+  OutputPort<T>                       output_;
+  OutputPort<Grabber::DetailsStruct>  details_output_;
+};
+
+/// A processor with one input, on which the test can read the results.
+template <class T>
+class FakeSink : public BaseProcessor {
+ public:
+  /// Constructor.
+  explicit FakeSink(const std::string& name = "input")
+    { registerInput_(name, &input); }
+
+  /// The input port.
+  InputPort<T>                        input;
+
+ protected:
+  virtual int execute() { markValid(); return 0; }
+};
+
+/** @brief A processor standing in for the FFT.
+ *
+ *  The spectrum starts at zero frequency and has @a size/2 + 1 bins, all of
+ *  them zero, which the test can change through @a spectrum.
+ */
+class FakeFft : public FakeSource<FftProcessor::OutputStruct> {
+ public:
+  /// Constructor.
+  FakeFft(unsigned size, float rate) : spectrum(size/2 + 1) {
+    data.fft = &spectrum[0];
+    data.size = size;
+    data.n_bins = spectrum.size();
+    data.start = 0;
+    data.step = 1.0/size;
+    details.samplingFrequency = rate;
+    details.size = size;
+    details.end = size;
+  }
+
+  /// The frequency bins.
+  std::vector<Complex>                spectrum;
+};
+
+#endif
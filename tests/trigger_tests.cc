@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "processor/trigger.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+// scan the whole signal in blocks of random sizes up to max_block (or all at
+// once, if max_block is zero)
+std::deque<double> scan(Trigger& trigger, const std::vector<float>& x,
+  size_t max_block)
+{
+  trigger.reset();
+  size_t done = 0;
+  while (done < x.size()) {
+    size_t n = x.size() - done;
+    if (max_block > 0)
+      n = std::min<size_t>(n, 1 + std::rand() % max_block);
+    trigger.scan(&x[done], n, done);
+    done += n;
+  }
+
+  return trigger.getEvents();
+}
+
+float noise(float amplitude)
+{
+  return amplitude*(2.0f*std::rand()/RAND_MAX - 1);
+}
+
+} // anonymous namespace
+
+int main()
+{
+  Trigger trigger;
+  trigger.setLevel(0);
+  trigger.setHysteresis(0.1);
+
+  // a crossing between two blocks is interpolated from the last sample of
+  // the first block
+  const float first[] = { -1, -1, -1, -0.5 };
+  const float second[] = { 0.5, 1, 1 };
+  trigger.scan(first, 4, 0);
+  trigger.scan(second, 3, 4);
+  check(trigger.getEvents().size() == 1 &&
+    std::abs(trigger.getEvents().front() - 3.5) < 1e-6,
+    "a crossing at the start of a block is found where it happened");
+
+  // but not if there is a gap between the blocks
+  trigger.reset();
+  trigger.scan(first, 4, 0);
+  trigger.scan(second, 3, 10);
+  check(trigger.getEvents().empty(), "a gap disarms the trigger");
+
+  // a sine with a period of 100 samples crosses zero upwards just before
+  // each multiple of 100; with a holdoff of 2.5 periods, only every third
+  // crossing counts, wherever the blocks end
+  const double phase = 0.3;
+  std::vector<float> sine(5000);
+  for (size_t i = 0; i < sine.size(); ++i)
+    sine[i] = std::sin(2*M_PI*(i + phase)/100);
+
+  const std::deque<double> all = scan(trigger, sine, 0);
+  check(all.size() == 49, "the trigger fires at every period");
+  trigger.setHoldoff(250);
+  const std::deque<double> whole = scan(trigger, sine, 0);
+  const std::deque<double> small = scan(trigger, sine, 37);
+  const std::deque<double> large = scan(trigger, sine, 700);
+  check(whole.size() == 17, "the holdoff skips crossings");
+  check(small == whole && large == whole,
+    "the holdoff carries over between blocks");
+  bool exact = true;
+  for (size_t i = 0; i < whole.size(); ++i)
+    exact = exact && std::abs(whole[i] - (100 - phase + 300*i)) < 1e-3;
+  check(exact, "the events are interpolated between samples");
+  trigger.setHoldoff(0);
+
+  // noise around the level doesn't arm the trigger if the hysteresis is
+  // larger than the noise
+  std::vector<float> quiet(2000);
+  for (size_t i = 0; i < quiet.size(); ++i)
+    quiet[i] = noise(0.2);
+  trigger.setHysteresis(0);
+  check(scan(trigger, quiet, 64).size() > 100,
+    "without hysteresis, noise triggers");
+  trigger.setHysteresis(0.5);
+  check(scan(trigger, quiet, 64).empty(),
+    "the hysteresis ignores noise");
+
+  // noisy edges of a square wave give a single event each, at either slope
+  std::vector<float> square(1600);
+  for (size_t i = 0; i < square.size(); ++i)
+    square[i] = ((i/200) % 2 == 0?-1:1) + noise(0.3);
+  const std::deque<double> rising = scan(trigger, square, 64);
+  check(rising.size() == 4, "one event for every rising edge");
+  for (size_t i = 0; i < rising.size(); ++i) {
+    check(std::abs(rising[i] - (199.5 + 400*i)) < 1,
+      "rising events are at the edges");
+  }
+  trigger.setSlope(Trigger::FALLING);
+  const std::deque<double> falling = scan(trigger, square, 64);
+  check(falling.size() == 3, "one event for every falling edge");
+  for (size_t i = 0; i < falling.size(); ++i) {
+    check(std::abs(falling[i] - (399.5 + 400*i)) < 1,
+      "falling events are at the edges");
+  }
+
+  return reportChecks();
+}
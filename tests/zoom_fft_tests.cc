@@ -0,0 +1,112 @@
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "processor/zoom_fft.h"
+#include "tests/test_utils.h"
+
+namespace {
+
+const float kRate = 48000;
+
+// the frequency of the largest bin of the spectrum, and its magnitude
+float findPeak(const FftProcessor::OutputStruct& spectrum, float& magnitude)
+{
+  unsigned peak = 0;
+  for (unsigned i = 1; i < spectrum.n_bins; ++i) {
+    if (std::abs(spectrum.fft[i]) > std::abs(spectrum.fft[peak]))
+      peak = i;
+  }
+
+  magnitude = std::abs(spectrum.fft[peak]);
+  return (spectrum.start + peak*spectrum.step)*kRate;
+}
+
+} // anonymous namespace
+
+// mix a tone into a long history, and check that the spectrum of bands
+// around it has its peak in the right bin
+int main()
+{
+  const size_t n = 1 << 21;
+  const float tone = 1003.3;
+  FakeSource<SampleHistory> source;
+  source.data.setCapacity(n);
+  std::vector<float> x(n);
+  for (size_t i = 0; i < n; ++i)
+    x[i] = std::cos(2*M_PI*tone*i/kRate);
+  source.data.append(&x[0], n);
+  source.details.samplingFrequency = kRate;
+  source.details.size = n;
+  source.details.end = n;
+
+  ZoomFft zoom;
+  zoom.connect("history", source, "output");
+  zoom.connect("details", source, "details");
+  zoom.setMaxSamples(n);
+  zoom.setReferenceSize(1024);
+  FakeSink<FftProcessor::OutputStruct> sink;
+  sink.connect("input", zoom, "output");
+
+  // the whole spectrum goes through a real FFT, narrow bands through a zoom
+  // FFT, and the narrowest ones are limited by the number of samples
+  const float bands[][2] = { {0, 24000}, {900, 1100}, {990, 1010},
+                             {1003, 1004} };
+  const unsigned n_bands = sizeof(bands)/sizeof(bands[0]);
+  for (unsigned i = 0; i < n_bands; ++i) {
+    std::ostringstream name;
+    name << bands[i][0] << "-" << bands[i][1] << " Hz: ";
+
+    zoom.setBand(bands[i][0], bands[i][1], 0);
+    zoom.invalidateCache();
+    const FftProcessor::OutputStruct& spectrum = sink.input.get();
+    const unsigned decimation = zoom.getDecimation();
+    check(spectrum.n_bins > 0 && spectrum.size == zoom.getSize(),
+      name.str() + "there is a spectrum");
+    if (spectrum.n_bins == 0)
+      continue;
+
+    // the bins cover the band
+    const float low = spectrum.start*kRate;
+    const float high = (spectrum.start + spectrum.n_bins*spectrum.step)*kRate;
+    check(low <= bands[i][0] && high >= bands[i][1],
+      name.str() + "the bins cover the band");
+    check(std::abs(spectrum.step - 1.0/((double)decimation*spectrum.size)) <
+      1e-12, name.str() + "the bins are spaced by the decimated rate");
+
+    float magnitude;
+    const float peak = findPeak(spectrum, magnitude);
+    check(std::abs(peak - tone) <= spectrum.step*kRate,
+      name.str() + "the tone lands in its bin");
+
+    // the filter and the smallest FFT fit in the samples that can be used
+    check((zoom.getSize() - 1 + 16)*(unsigned long long)decimation <= n,
+      name.str() + "the decimation is limited by the samples");
+  }
+  check(zoom.getDecimation() > 1, "narrow bands are decimated");
+
+  // the magnitudes follow the reference size, even when only it changes
+  float magnitude;
+  findPeak(sink.input.get(), magnitude);
+  zoom.setReferenceSize(2048);
+  zoom.invalidateCache();
+  float doubled;
+  findPeak(sink.input.get(), doubled);
+  check(std::abs(doubled/magnitude - 2) < 1e-3,
+    "the magnitudes follow the reference size");
+
+  // very narrow bands with few samples don't need a huge filter
+  zoom.setMaxSamples(100000);
+  zoom.setBand(1003, 1004, 0);
+  zoom.invalidateCache();
+  float limited;
+  const float peak = findPeak(sink.input.get(), limited);
+  check((255 + 16)*(unsigned long long)zoom.getDecimation() <= 100000,
+    "the decimation leaves enough samples for the smallest FFT");
+  check(std::abs(peak - tone) <= sink.input.get().step*kRate,
+    "the tone lands in its bin at the limited resolution");
+
+  return reportChecks();
+}
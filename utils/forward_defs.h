@@ -40,6 +40,26 @@ typedef boost::shared_ptr<BaseProcessor> BaseProcessorPtr;
 /// A map from names to processing modules.
 typedef std::map<std::string, BaseProcessorPtr> Processors;
 
+class FftPlanCache;
+/// Smart pointer to a cache of FFT plans.
+typedef boost::shared_ptr<FftPlanCache> FftPlanCachePtr;
+
+class Vbo;
+/// Smart pointer to a vertex buffer object.
+typedef boost::shared_ptr<Vbo> VboPtr;
+
+class FboPool;
+/// Smart pointer to a pool of render targets.
+typedef boost::shared_ptr<FboPool> FboPoolPtr;
+
+class GraphProgram;
+/// Smart pointer to a shader program mapping graph space to the screen.
+typedef boost::shared_ptr<GraphProgram> GraphProgramPtr;
+
+class MarkerProgram;
+/// Smart pointer to a shader program for drawing markers.
+typedef boost::shared_ptr<MarkerProgram> MarkerProgramPtr;
+
 class TransitionStore;
 /// Smart pointer to the transition store.
 typedef boost::shared_ptr<TransitionStore> TransitionStorePtr;
@@ -47,4 +47,10 @@ typedef std::vector<std::string> StringVector;
 /// Split a space-separated string into a vector of strings.
 StringVector splitString(const std::string& s, bool trim_ws = true);
 
+/// A deleter that does nothing, for shared pointers to objects that are owned
+/// by someone else.
+struct NullDeleter {
+  void operator()(const void*) const {}
+};
+
 #endif // MISC_H_
@@ -0,0 +1,178 @@
+#include "utils/png_writer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/// Table for the CRC-32 used by PNG chunks, built once at startup.
+class CrcTable {
+ public:
+  CrcTable() {
+    for (unsigned long n = 0; n < 256; ++n) {
+      unsigned long c = n;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1)?(0xedb88320UL ^ (c >> 1)):(c >> 1);
+      table_[n] = c;
+    }
+  }
+
+  unsigned long update(unsigned long crc, const unsigned char* data,
+    size_t n) const
+  {
+    for (size_t i = 0; i < n; ++i)
+      crc = table_[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+  }
+
+ private:
+  unsigned long table_[256];
+};
+
+const CrcTable crc_table;
+
+void putBigEndian(std::vector<unsigned char>& v, unsigned long x)
+{
+  v.push_back((x >> 24) & 0xff);
+  v.push_back((x >> 16) & 0xff);
+  v.push_back((x >> 8) & 0xff);
+  v.push_back(x & 0xff);
+}
+
+/// Append a deflate stored block header for @a n bytes.
+void putStoredHeader(std::vector<unsigned char>& v, size_t n, bool final)
+{
+  v.push_back(final?1:0);
+  v.push_back(n & 0xff);
+  v.push_back((n >> 8) & 0xff);
+  v.push_back(~n & 0xff);
+  v.push_back((~n >> 8) & 0xff);
+}
+
+/// Largest amount of data in a stored block.
+const size_t kMaxStored = 65535;
+
+}
+
+void PngWriter::open(const std::string& fname, unsigned width,
+  unsigned height)
+{
+  if (isOpen())
+    close();
+
+  out_.open(fname.c_str(), std::ios::out | std::ios::binary);
+  if (!out_)
+    throw PngError("Can't open " + fname + " for writing (PngWriter::open).");
+
+  fname_ = fname;
+  width_ = width;
+  height_ = height;
+  rows_ = 0;
+  adler_a_ = 1;
+  adler_b_ = 0;
+
+  static const unsigned char signature[8] =
+    { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  out_.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+  // 8-bit RGB, no interlacing
+  std::vector<unsigned char> header;
+  putBigEndian(header, width_);
+  putBigEndian(header, height_);
+  const unsigned char rest[5] = { 8, 2, 0, 0, 0 };
+  header.insert(header.end(), rest, rest + 5);
+  writeChunk_("IHDR", &header[0], header.size());
+
+  // the zlib header; the image data follows in stored blocks
+  const unsigned char zlib_header[2] = { 0x78, 0x01 };
+  writeChunk_("IDAT", zlib_header, 2);
+}
+
+void PngWriter::writeRow(const unsigned char* rgb)
+{
+  if (!isOpen() || rows_ >= height_)
+    return;
+
+  // each row starts with the filter type, which is always "none"
+  const size_t row_size = 3*(size_t)width_;
+  std::vector<unsigned char> row(row_size + 1, 0);
+  if (rgb)
+    std::copy(rgb, rgb + row_size, row.begin() + 1);
+  updateAdler_(&row[0], row.size());
+
+  std::vector<unsigned char> data;
+  data.reserve(row.size() + 5*(row.size()/kMaxStored + 1));
+  for (size_t i = 0; i < row.size(); i += kMaxStored) {
+    const size_t n = std::min(kMaxStored, row.size() - i);
+    putStoredHeader(data, n, false);
+    data.insert(data.end(), row.begin() + i, row.begin() + i + n);
+  }
+  writeChunk_("IDAT", &data[0], data.size());
+  ++rows_;
+}
+
+void PngWriter::close()
+{
+  if (!isOpen())
+    return;
+
+  while (rows_ < height_)
+    writeRow(0);
+
+  // an empty final block ends the deflate stream
+  std::vector<unsigned char> data;
+  putStoredHeader(data, 0, true);
+  putBigEndian(data, (adler_b_ << 16) | adler_a_);
+  writeChunk_("IDAT", &data[0], data.size());
+  writeChunk_("IEND", 0, 0);
+
+  const bool failed = !out_;
+  out_.close();
+  if (failed)
+    throw PngError("Error writing " + fname_ + " (PngWriter::close).");
+}
+
+void PngWriter::write(const std::string& fname, unsigned width,
+  unsigned height, const unsigned char* rgb)
+{
+  PngWriter writer;
+  writer.open(fname, width, height);
+  for (unsigned i = 0; i < height; ++i)
+    writer.writeRow(rgb + 3*(size_t)width*i);
+  writer.close();
+}
+
+void PngWriter::writeChunk_(const char* type, const unsigned char* data,
+  size_t n)
+{
+  std::vector<unsigned char> length;
+  putBigEndian(length, n);
+  out_.write(reinterpret_cast<const char*>(&length[0]), 4);
+  out_.write(type, 4);
+  if (n > 0)
+    out_.write(reinterpret_cast<const char*>(data), n);
+
+  unsigned long crc = crc_table.update(0xffffffffUL,
+    reinterpret_cast<const unsigned char*>(type), 4);
+  crc = crc_table.update(crc, data, n) ^ 0xffffffffUL;
+  std::vector<unsigned char> tail;
+  putBigEndian(tail, crc);
+  out_.write(reinterpret_cast<const char*>(&tail[0]), 4);
+}
+
+void PngWriter::updateAdler_(const unsigned char* data, size_t n)
+{
+  const unsigned long kMod = 65521;
+  // the sums can be allowed to grow for a while before taking the modulus
+  while (n > 0) {
+    const size_t m = std::min<size_t>(n, 5552);
+    for (size_t i = 0; i < m; ++i) {
+      adler_a_ += data[i];
+      adler_b_ += adler_a_;
+    }
+    adler_a_ %= kMod;
+    adler_b_ %= kMod;
+    data += m;
+    n -= m;
+  }
+}
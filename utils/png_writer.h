@@ -0,0 +1,71 @@
+/** @file png_writer.h
+ *  @brief Defines a writer for uncompressed PNG images that works row by row.
+ *
+ *  @author Tiberiu Tesileanu
+ */
+#ifndef PNG_WRITER_H_
+#define PNG_WRITER_H_
+
+#include <fstream>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "utils/exception.h"
+
+/// Exception thrown when a PNG file can't be written.
+class PngError : public Exception {
+ public:
+  /// Constructor.
+  explicit PngError(const std::string& what) : Exception(what) {}
+};
+
+/** @brief Write 8-bit RGB PNG files, one row at a time.
+ *
+ *  The image data is stored with deflate's "stored" blocks, i.e., without
+ *  compression, so that no external libraries are needed and writing is
+ *  fast. Rows go from top to bottom, and each of them is written out
+ *  straight away, so the memory used does not depend on the size of the
+ *  image.
+ */
+class PngWriter : boost::noncopyable {
+ public:
+  /// Constructor.
+  PngWriter() : width_(0), height_(0), rows_(0), adler_a_(1), adler_b_(0) {}
+
+  /// Destructor. Closes the file, if it's still open.
+  ~PngWriter() { try { close(); } catch (const PngError&) {} }
+
+  /// Start writing an image to the file @a fname. Throws on errors.
+  void open(const std::string& fname, unsigned width, unsigned height);
+
+  /// Write the next row, made of @a width RGB triplets.
+  void writeRow(const unsigned char* rgb);
+
+  /** @brief Finish the image and close the file.
+   *
+   *  Rows that were not written are filled with black.
+   */
+  void close();
+
+  /// Find out whether an image is being written.
+  bool isOpen() const { return out_.is_open(); }
+
+  /// Write a whole image, with rows going from top to bottom.
+  static void write(const std::string& fname, unsigned width, unsigned height,
+    const unsigned char* rgb);
+
+ private:
+  void writeChunk_(const char* type, const unsigned char* data, size_t n);
+  void updateAdler_(const unsigned char* data, size_t n);
+
+  std::ofstream   out_;
+  std::string     fname_;
+  unsigned        width_;
+  unsigned        height_;
+  unsigned        rows_;
+  unsigned long   adler_a_;
+  unsigned long   adler_b_;
+};
+
+#endif